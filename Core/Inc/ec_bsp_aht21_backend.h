@@ -0,0 +1,37 @@
+/**
+ * @file ec_bsp_aht21_backend.h
+ * @brief AHT21 驱动静态分派模式的目标板后端
+ *
+ * 以AHT21_CFG_STATIC_DISPATCH=1、AHT21_CFG_BACKEND_HEADER="ec_bsp_aht21_backend.h"
+ * 编译驱动时由ec_bsp_aht21_driver.h引入：事务由HAL顺序DMA后端完成，等待由
+ * FreeRTOS vTaskDelayUntil完成(调度器启动前退化为WFI)。
+ *
+ * @version 1.0
+ * @date 2024-07-26
+ *
+ * @note
+ * - 使用前需调用iic_hal_seq_attach绑定IIC外设，接口表参数可为临时变量。
+ * - 事务超时由iic_hal_seq_transfer保证(每段IIC_HAL_SEQ_TIMEOUT_MS)。
+ *
+ * @par 依赖项
+ * - ec_bsp_iic_hal_seq.h
+ * - ec_bsp_aht21_wait.h
+ *
+ * @par 版本历史
+ * - 1.0 初始版本
+ *
+ * @par 作者
+ * - liyijie
+ */
+
+#ifndef __EC_BSP_AHT21_BACKEND_H__
+#define __EC_BSP_AHT21_BACKEND_H__
+
+#include "ec_bsp_iic_hal_seq.h"
+#include "ec_bsp_aht21_wait.h"
+
+#define AHT21_CFG_IIC_TRANSFER(xfer)   iic_hal_seq_transfer(xfer)
+#define AHT21_CFG_GET_TICK()           HAL_GetTick()
+#define AHT21_CFG_WAIT_UNTIL(deadline) aht21_wait_until_rtos(deadline)
+
+#endif //__EC_BSP_AHT21_BACKEND_H__
@@ -0,0 +1,98 @@
+/**
+ * @file ec_bsp_aht21_bus.h
+ * @brief 多AHT21总线管理头文件
+ *
+ * AHT21地址固定为0x38，同一总线上的多个传感器需通过TCA9548类IIC mux分通道挂载。
+ * 总线管理器持有N个bsp_aht21_t实例(由调用者提供存储)，先逐个触发测量，
+ * 再在一次扫描中收集全部结果，N个传感器的采样时间约等于一次转换时间。
+ *
+ * @version 1.0
+ * @date 2024-06-20
+ *
+ * @note
+ * - 节点数组与传感器实例由调用者分配，管理器不使用静态变量和动态内存。
+ * - 同一mux下各通道的传感器共享mux所在的iic_driver_interface_t。
+ * - 存在多个mux时，切换到另一个mux前会关闭当前mux的全部通道，避免地址冲突。
+ * - mux通道寄存器经aht21_iic_transfer写入，借用该mux下第一个节点的传感器实例，
+ *   与传感器事务相同地检查返回值、超时、退避重试和解锁总线，故障计入该实例。
+ *
+ * @par 依赖项
+ * - ec_bsp_aht21_driver.h : AHT21驱动。
+ *
+ * @par 版本历史
+ * - 1.0 初始版本
+ * - 1.1 mux写入经驱动的重试与恢复流程
+ *
+ * @par 作者
+ * - liyijie
+ */
+
+#ifndef __EC_BSP_AHT21_BUS_H__
+#define __EC_BSP_AHT21_BUS_H__
+
+#include "ec_bsp_aht21_driver.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "error_codes.h"
+
+#define AHT21_BUS_MUX_ADDR_DEFAULT   0x70   // TCA9548 A2..A0接地时的地址
+#define AHT21_BUS_MUX_CHANNEL_NUM    8      // TCA9548通道数
+#define AHT21_BUS_MUX_CHANNEL_NONE   0x00   // 关闭全部通道
+
+// TCA9548类IIC mux
+typedef struct
+{
+	iic_driver_interface_t *iic_driver_interface; // mux所在的IIC总线
+	uint8_t                 addr;                 // mux 7位地址
+	uint8_t                 channel_mask;         // 当前打开的通道 缓存以省去重复写
+	bsp_aht21_t            *aht21_instance;       // 执行mux事务的实例 为第一个加入的节点
+}aht21_iic_mux_t;
+
+// 总线上的一个传感器节点
+typedef struct
+{
+	bsp_aht21_t     *aht21_instance;              // 已完成aht21_inst的传感器实例
+	aht21_iic_mux_t *mux;                         // 所在mux NULL表示直连
+	uint8_t          channel;                     // mux通道号 0~7
+	int8_t           code;                        // 最近一次采样结果码
+	float            temp;                        // 最近一次温度
+	float            humi;                        // 最近一次湿度
+	uint8_t          health;                      // 最近一次采样后的健康状态 aht21_health_state_t
+}aht21_bus_node_t;
+
+// 总线管理器
+typedef struct
+{
+	aht21_bus_node_t *nodes;                      // 节点数组(调用者提供)
+	uint8_t           capacity;                   // 节点数组容量
+	uint8_t           count;                      // 已添加节点数
+	aht21_iic_mux_t  *active_mux;                 // 当前打开通道的mux
+}bsp_aht21_bus_t;
+
+/**
+ * 初始化mux描述
+ */
+int8_t aht21_bus_mux_inst(aht21_iic_mux_t *mux, iic_driver_interface_t *iic_instance, uint8_t addr);
+/**
+ * 构造总线管理器
+ */
+int8_t aht21_bus_inst(bsp_aht21_bus_t *bus, aht21_bus_node_t *nodes, uint8_t capacity);
+/**
+ * 添加传感器节点
+ */
+int8_t aht21_bus_add(bsp_aht21_bus_t *bus, bsp_aht21_t *aht21_instance, aht21_iic_mux_t *mux, uint8_t channel);
+/**
+ * 依次触发全部传感器测量
+ */
+int8_t aht21_bus_trigger_all(bsp_aht21_bus_t *bus);
+/**
+ * 收集全部传感器结果 转换未完成时让出cpu
+ */
+int8_t aht21_bus_collect_all(bsp_aht21_bus_t *bus);
+/**
+ * 触发并收集全部传感器
+ */
+int8_t aht21_bus_sample_all(bsp_aht21_bus_t *bus);
+
+#endif //__EC_BSP_AHT21_BUS_H__
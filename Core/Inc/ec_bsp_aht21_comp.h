@@ -0,0 +1,104 @@
+/******************************************************************************
+ * Copyright (C) 2024 EternalChip, Inc.(Gmbh) or its affiliates.
+ *
+ * All Rights Reserved.
+ *
+ * File name: ec_bsp_aht21_comp.h
+ *
+ * Description: Calibration and derived quantities for AHT21 readings.
+ *
+ * Processing flow:
+ *
+ *   frame decode -> 0.01 units -> per-sensor gain/offset -> dew point,
+ *                                                          absolute humidity,
+ *                                                          heat index
+ *
+ * All values are integers in 0.01 units. ln/exp are evaluated with 33-entry
+ * tables and linear interpolation, no libm and no FPU is needed.
+ *
+ * Formulas:
+ *   Magnus (b = 17.62, c = 243.12 C):
+ *     g  = ln(RH/100) + b*T/(c+T)
+ *     Td = c*g/(b-g)
+ *     AH = 6.112*exp(b*T/(c+T))*RH*2.1674/(273.15+T)    [g/m3]
+ *   Heat index: NOAA Rothfusz regression with Steadman's simple formula
+ *   below 80 F and the NOAA low/high humidity adjustments.
+ *
+ * Version: V1.0
+ *
+ * Modifications:
+ *
+ *
+ * Note: 1 tab == 4 spaces!
+ *
+ *****************************************************************************/
+
+#ifndef __EC_BSP_AHT21_COMP_H__
+#define __EC_BSP_AHT21_COMP_H__
+
+#include <stdint.h>
+
+#define AHT21_COMP_GAIN_ONE      16384 // Q14格式的1.0
+
+//单个传感器的校准参数 out = in * gain / 16384 + offset
+typedef struct
+{
+	int16_t  temp_offset;            // 温度偏移(0.01摄氏度)
+	int16_t  humi_offset;            // 湿度偏移(0.01%RH)
+	uint16_t temp_gain;              // 温度增益(Q14)
+	uint16_t humi_gain;              // 湿度增益(Q14)
+}aht21_calib_t;
+
+//补偿结果
+typedef struct
+{
+	int16_t  temp;                   // 校准后温度(0.01摄氏度)
+	uint16_t humi;                   // 校准后湿度(0.01%RH)
+	int16_t  dew_point;              // 露点(0.01摄氏度)
+	uint16_t abs_humi;               // 绝对湿度(0.01g/m3)
+	int16_t  heat_index;             // 体感温度(0.01摄氏度)
+}aht21_comp_t;
+
+/**
+ * @brief 填充默认校准参数(增益1 偏移0)
+ */
+void aht21_comp_calib_default(aht21_calib_t *calib);
+
+/**
+ * @brief 应用校准 湿度限制在0~100%RH
+ *
+ * @param calib     校准参数 NULL时不校准
+ * @param temp      温度输入(0.01摄氏度)
+ * @param humi      湿度输入(0.01%RH)
+ * @param temp_out  温度输出
+ * @param humi_out  湿度输出
+ */
+void aht21_comp_calibrate(const aht21_calib_t *calib, int16_t temp, uint16_t humi,
+                          int16_t *temp_out, uint16_t *humi_out);
+
+/**
+ * @brief 露点(0.01摄氏度)
+ */
+int16_t aht21_comp_dew_point(int16_t temp, uint16_t humi);
+
+/**
+ * @brief 绝对湿度(0.01g/m3)
+ */
+uint16_t aht21_comp_abs_humi(int16_t temp, uint16_t humi);
+
+/**
+ * @brief 体感温度(0.01摄氏度)
+ */
+int16_t aht21_comp_heat_index(int16_t temp, uint16_t humi);
+
+/**
+ * @brief 校准并计算全部派生量
+ *
+ * @param calib  校准参数 NULL时不校准
+ * @param temp   温度输入(0.01摄氏度)
+ * @param humi   湿度输入(0.01%RH)
+ * @param out    补偿结果
+ */
+void aht21_comp_process(const aht21_calib_t *calib, int16_t temp, uint16_t humi, aht21_comp_t *out);
+
+#endif //__EC_BSP_AHT21_COMP_H__
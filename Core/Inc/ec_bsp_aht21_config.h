@@ -0,0 +1,79 @@
+/**
+ * @file ec_bsp_aht21_config.h
+ * @brief AHT21 驱动编译期配置
+ *
+ * 默认(运行时模式)下驱动通过实例中的iic_driver_interface_t、
+ * system_timebase_interface_t和pfyield函数指针访问总线与时基，同一固件
+ * 可挂载不同的后端。
+ *
+ * 定义AHT21_CFG_STATIC_DISPATCH为1时进入静态分派模式：IIC事务、时基和等待
+ * 函数在编译期绑定为下列宏，驱动不再经由函数指针调用，编译器可把整条读
+ * 路径内联；字节级IIC路径和实例方法表一并编译掉。
+ *
+ *   AHT21_CFG_IIC_TRANSFER(xfer)   执行iic_transaction_t 返回0成功     必需 须自带超时
+ *   AHT21_CFG_GET_TICK()           返回毫秒tick                        必需
+ *   AHT21_CFG_WAIT_UNTIL(deadline) 睡眠到绝对tick                      与YIELD二选一
+ *   AHT21_CFG_YIELD()              让出cpu 未定义WAIT_UNTIL时循环调用  与WAIT_UNTIL二选一
+ *   AHT21_CFG_IIC_INIT()           IIC初始化 返回0成功                 可选
+ *   AHT21_CFG_IIC_DEINIT()         IIC逆初始化 返回0成功               可选
+ *   AHT21_CFG_IIC_BUS_RECOVER()    总线解锁 返回0成功                  可选
+ *
+ * 上述宏引用的函数声明放在AHT21_CFG_BACKEND_HEADER指定的头文件中。该头文件由
+ * ec_bsp_aht21_driver.h在IIC事务和时基类型定义之后引入，可直接使用iic_transaction_t
+ * 等类型，也可以包含ec_bsp_aht21_driver.h(此时不会重复展开)。
+ * 建议在工程的预处理宏中定义，例如使用HAL顺序DMA后端和FreeRTOS：
+ *
+ *   AHT21_CFG_STATIC_DISPATCH=1
+ *   AHT21_CFG_BACKEND_HEADER="ec_bsp_aht21_backend.h"
+ *
+ * 其中ec_bsp_aht21_backend.h(工程已提供)：
+ *
+ *   #include "ec_bsp_iic_hal_seq.h"
+ *   #include "ec_bsp_aht21_wait.h"
+ *   #define AHT21_CFG_IIC_TRANSFER(xfer)   iic_hal_seq_transfer(xfer)
+ *   #define AHT21_CFG_GET_TICK()           HAL_GetTick()
+ *   #define AHT21_CFG_WAIT_UNTIL(deadline) aht21_wait_until_rtos(deadline)
+ *
+ * @version 1.0
+ * @date 2024-07-08
+ *
+ * @note
+ * - 静态分派模式下aht21_inst的iic_instance/timebase/rtos_yeild参数可为NULL，
+ *   只初始化实例状态。
+ * - 静态分派模式下实例方法表(pfinit、pffetch等)默认不生成，直接调用aht21_*函数；
+ *   需要时定义AHT21_CFG_METHOD_TABLE为1。
+ * - ec_bsp_aht21_sim.c依赖运行时模式。
+ * - AHT21_CFG_TRACE为1时驱动在各阶段写入追踪事件，参考ec_bsp_aht21_trace.h。
+ * - AHT21_CFG_HEALTH为1(默认)时每次测量结束更新实例的健康状态，参考ec_bsp_aht21_health.h。
+ *
+ * @par 版本历史
+ * - 1.0 初始版本
+ *
+ * @par 作者
+ * - liyijie
+ */
+
+#ifndef __EC_BSP_AHT21_CONFIG_H__
+#define __EC_BSP_AHT21_CONFIG_H__
+
+#ifndef AHT21_CFG_STATIC_DISPATCH
+#define AHT21_CFG_STATIC_DISPATCH    0
+#endif
+
+// 静态分派模式的后端头文件与宏检查见ec_bsp_aht21_driver.h
+
+// 分阶段耗时追踪 参考ec_bsp_aht21_trace.h
+#ifndef AHT21_CFG_TRACE
+#define AHT21_CFG_TRACE              0
+#endif
+
+// 传感器健康监测 参考ec_bsp_aht21_health.h
+#ifndef AHT21_CFG_HEALTH
+#define AHT21_CFG_HEALTH             1
+#endif
+
+#ifndef AHT21_CFG_METHOD_TABLE
+#define AHT21_CFG_METHOD_TABLE       (!AHT21_CFG_STATIC_DISPATCH)
+#endif
+
+#endif //__EC_BSP_AHT21_CONFIG_H__
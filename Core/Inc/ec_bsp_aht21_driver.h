@@ -12,8 +12,11 @@
  * 
  * @note
  * - 确保I2C库已经初始化并配置正确。
- * - 所有函数都假定传感器的I2C地址为0x38（默认地址）。
+ * - 传感器I2C地址保存在实例dev_addr中，默认0x38；多个传感器经mux挂载时见ec_bsp_aht21_bus.h。
  * - 读取数据函数返回的温湿度值为浮点数，单位分别是摄氏度和百分比。
+ * - 不使用FPU的任务可通过aht21_fetch_raw/aht21_fetch_centi获取原始码或0.01单位整数。
+ * - 除aht21_fetch_raw外 输出均已应用实例的校准参数；露点等派生量由aht21_fetch_comp计算。
+ * - 每次测量结束更新实例的健康状态(卡死、量程、变化率、CRC/NACK率)，随样本一起输出。
  * 
  * @par 依赖项
  * - i2c.h : 包含I2C通信函数的头文件。
@@ -28,7 +31,12 @@
 #ifndef __EC_BSP_AHT21_DRIVER_H__
 #define __EC_BSP_AHT21_DRIVER_H__
 
+#include "ec_bsp_aht21_config.h"
 #include "ec_bsp_aht21_reg.h"
+#include "ec_bsp_aht21_frame.h"
+#include "ec_bsp_aht21_comp.h"
+#include "ec_bsp_aht21_trace.h"
+#include "ec_bsp_aht21_health.h"
 
 #include <stdio.h>
 #include <stdint.h>
@@ -36,9 +44,52 @@
 #include "error_codes.h"
 
 // AHT21 延时时间定义
-#define AHT21_INIT_DELAY_MS          40
+#define AHT21_INIT_DELAY_MS          40    // 上电后可通信的时间
+#define AHT21_CAL_DELAY_MS           10    // 发送校准命令后的等待
 #define AHT21_MEASUREMENT_DELAY_MS   75
 #define AHT21_RESET_DELAY_MS         20
+#define AHT21_BUSY_RETRY_DELAY_MS    5     // 取数时仍忙,再次等待的时间
+
+// 自适应等待参数
+#define AHT21_MEASUREMENT_TIMEOUT_MS 150   // 触发后超过该时间仍忙视为超时
+#define AHT21_POLL_FIRST_DEFAULT_MS  40    // 无统计数据时首次查询状态的时间
+#define AHT21_POLL_BACKOFF_INIT_MS   2     // 首次查询仍忙后的等待间隔
+#define AHT21_POLL_BACKOFF_MAX_MS    16    // 查询间隔上限
+#define AHT21_CONV_STATS_WARMUP      4     // 统计样本数达到该值后使用统计值预测
+#define AHT21_CRC_RETRY_DEFAULT      2     // CRC错误时默认重读次数
+
+// 总线故障恢复参数
+#define AHT21_IIC_XFER_TIMEOUT_MS    10    // 单次IIC事务超时 后端返回后判定 不打断后端
+#define AHT21_IIC_RETRY_MAX          3     // 事务失败后的重试次数
+#define AHT21_IIC_BACKOFF_INIT_MS    1     // 首次重试前的等待 之后每次翻倍
+
+// 判断时基是否已到达deadline(兼容计数回绕)
+#define AHT21_TICK_REACHED(now, deadline) \
+	((int32_t)((uint32_t)(now) - (uint32_t)(deadline)) >= 0)
+// 判断时基是否已越过deadline 恰好到达不算(兼容计数回绕)
+#define AHT21_TICK_PASSED(now, deadline) \
+	((int32_t)((uint32_t)(now) - (uint32_t)(deadline)) > 0)
+
+//IIC事务段标志
+#define IIC_SEG_WRITE                0x00  // 写段
+#define IIC_SEG_READ                 0x01  // 读段 最后一个字节回复NACK
+#define IIC_SEG_RESTART              0x02  // 本段前强制重复起始(方向改变时总会重复起始)
+
+//IIC事务段
+typedef struct
+{
+	uint8_t *pdata;                  // 数据缓冲区
+	uint16_t size;                   // 长度
+	uint8_t  flags;                  // IIC_SEG_xxx
+}iic_segment_t;
+
+//IIC事务 起始-段1-(重复起始)-段2...-停止 由后端一次完成
+typedef struct
+{
+	uint8_t        addr;             // 7位从机地址
+	uint8_t        seg_num;          // 段数
+	iic_segment_t *segs;             // 段数组
+}iic_transaction_t;
 
 //IIC函数指针结构体
 typedef struct{
@@ -55,13 +106,93 @@ typedef struct{
 
 	int8_t (*pfWriteReg)(uint8_t addr, uint8_t *pdata, uint8_t size);
 	int8_t (*pfReadReg)(uint8_t addr, uint8_t *pdata, uint8_t size);
+	//事务接口 非NULL时驱动优先使用 可不提供字节级接口 阻塞时长须由后端自行限制
+	int8_t (*pfTransfer)(const iic_transaction_t *xfer);
+	//总线恢复(九时钟解锁+停止信号) 可为NULL 参考ec_bsp_iic_recovery.h
+	int8_t (*pfBusRecover)(void);
 }iic_driver_interface_t;
 
 //定义时基
+//等待接口 阻塞当前任务直到deadline_tick(与mcu_get_systick_count同一时基)
+//可提前返回 驱动会重新检查时刻并再次调用
+typedef void (*aht21_wait_until_t)(uint32_t deadline_tick);
+
 typedef struct 
 {
 	uint32_t (*mcu_get_systick_count)(void);
+	aht21_wait_until_t pfwait_until;          // 睡眠到绝对时刻 NULL时循环调用pfyield 参考ec_bsp_aht21_wait.h
 }system_timebase_interface_t;
+
+//静态分派模式的后端 在IIC事务和时基类型之后引入 后端头文件可直接使用这些类型
+#if AHT21_CFG_STATIC_DISPATCH
+
+#ifdef AHT21_CFG_BACKEND_HEADER
+#include AHT21_CFG_BACKEND_HEADER
+#endif
+
+#if !defined(AHT21_CFG_IIC_TRANSFER) || !defined(AHT21_CFG_GET_TICK) || \
+    (!defined(AHT21_CFG_WAIT_UNTIL) && !defined(AHT21_CFG_YIELD))
+#error "AHT21_CFG_STATIC_DISPATCH requires AHT21_CFG_IIC_TRANSFER, AHT21_CFG_GET_TICK and AHT21_CFG_WAIT_UNTIL or AHT21_CFG_YIELD"
+#endif
+
+#ifndef AHT21_CFG_IIC_INIT
+#define AHT21_CFG_IIC_INIT()         0
+#endif
+
+#ifndef AHT21_CFG_IIC_DEINIT
+#define AHT21_CFG_IIC_DEINIT()       0
+#endif
+
+#endif //AHT21_CFG_STATIC_DISPATCH
+
+//非阻塞测量状态
+typedef enum
+{
+	AHT21_MEAS_STATE_IDLE = 0,       // 空闲 未触发测量
+	AHT21_MEAS_STATE_CONVERTING,     // 已触发 等待转换完成
+	AHT21_MEAS_STATE_READY,          // 转换完成 等待取数
+}aht21_meas_state_t;
+
+//转换等待方式
+typedef enum
+{
+	AHT21_WAIT_MODE_FIXED = 0,       // 固定等待AHT21_MEASUREMENT_DELAY_MS
+	AHT21_WAIT_MODE_ADAPTIVE,        // 轮询状态字节busy位 清零即完成
+}aht21_wait_mode_t;
+
+//转换时间统计(仅自适应模式下记录)
+typedef struct
+{
+	uint32_t count;                  // 统计样本数
+	uint16_t min_ms;                 // 最短转换时间
+	uint16_t max_ms;                 // 最长转换时间
+	uint16_t avg_q4;                 // 滑动平均(1/16 ms)
+}aht21_conv_stats_t;
+
+//带时间戳的样本记录 按值传递
+typedef struct
+{
+	uint32_t seq;                    // 发布序号 由最新样本槽写入 驱动直接产生的样本为0
+	uint32_t timestamp;              // 触发测量时刻(时基计数)
+	float    temp;                   // 温度(摄氏度)
+	float    humi;                   // 湿度(百分比)
+	int8_t   code;                   // 本样本结果码 非0时温湿度无效
+	uint8_t  health;                 // 本样本后的健康状态 aht21_health_state_t
+	uint8_t  health_flags;           // AHT21_HEALTH_F_xxx
+}aht21_sample_t;
+
+//总线故障统计
+typedef struct
+{
+	uint32_t nack;                   // 无应答/后端出错次数
+	uint32_t timeout;                // 事务超时次数
+	uint32_t retry;                  // 退避重试次数
+	uint32_t bus_recover;            // 总线解锁次数
+	uint32_t soft_reset;             // 软复位次数
+	uint32_t recovered;              // 重试或解锁后恢复成功次数
+	uint32_t fatal;                  // 全部恢复手段失败次数
+}aht21_fault_stats_t;
+
 //提前定义aht21_instance防止报错
 typedef struct  bsp_aht21_t bsp_aht21_t;
 //AHT21函数指针结构体
@@ -69,7 +200,9 @@ struct bsp_aht21_t{
 
 	iic_driver_interface_t	*iic_driver_interface_t;  						// IIC接口
 	system_timebase_interface_t   *pftimebase_interface;         			// 时基接口
+	uint8_t                        dev_addr;                                // 7位IIC地址
 
+#if AHT21_CFG_METHOD_TABLE
 	int8_t (*pfInst)(                                             // #1 初始化函数
 					bsp_aht21_t * 			      aht21_instance, // AHT21的实体实例
 
@@ -83,12 +216,66 @@ struct bsp_aht21_t{
 	int8_t (*pfaht21_read_id)(bsp_aht21_t *aht21_instance);
 	int8_t (*pfstartMeasurement)(bsp_aht21_t *aht21_instance);
 	int8_t (*pfaht21_read_data)(bsp_aht21_t *aht21_instance,float *temp,float *humi);
-	int8_t (*pfsoftReset)(void);
-	int8_t (*pfsleep)(void);
-	int8_t (*pfwakeup)(void);
+	int8_t (*pfpoll_ready)(bsp_aht21_t *aht21_instance);
+	int8_t (*pffetch)(bsp_aht21_t *aht21_instance,float *temp,float *humi);
+	int8_t (*pfread_burst)(bsp_aht21_t *aht21_instance,aht21_sample_t *out,uint16_t n,uint32_t period_ms);
+	int8_t (*pfsoftReset)(bsp_aht21_t *aht21_instance);
+	int8_t (*pfsleep)(bsp_aht21_t *aht21_instance);
+	int8_t (*pfwakeup)(bsp_aht21_t *aht21_instance);
+#endif
 	int8_t (*pfyield)(bsp_aht21_t *aht21_instance);
+
+	//非阻塞测量状态
+	aht21_meas_state_t meas_state;                               // 当前测量状态
+	uint32_t           meas_start_tick;                          // 触发测量时刻
+	uint32_t           meas_deadline;                            // 预计转换完成时刻
+	//自适应等待
+	aht21_wait_mode_t  wait_mode;                                // 转换等待方式
+	uint16_t           poll_backoff_init_ms;                     // 初始查询间隔
+	uint16_t           poll_backoff_max_ms;                      // 查询间隔上限
+	uint16_t           poll_backoff_ms;                          // 当前查询间隔
+	aht21_conv_stats_t conv_stats;                               // 转换时间统计
+	//CRC校验
+	bool               crc_enable;                               // 读7字节并校验CRC
+	uint8_t            crc_retry_max;                            // CRC错误时重读次数
+	uint32_t           crc_fail_count;                           // CRC错误帧计数
+	uint32_t           crc_reject_count;                         // 重读后仍错误被丢弃的测量计数
+	uint8_t (*pfcrc8)(const uint8_t *pdata, uint8_t size);       // 硬件CRC 为NULL时查表计算
+	//低功耗
+	bool               sleeping;                                 // 已进入休眠
+	uint32_t           wake_deadline;                            // 唤醒后可开始测量的时刻
+	int8_t (*pfpower)(bool on);                                  // 传感器供电开关 NULL表示常供电
+	//总线故障
+	aht21_fault_stats_t fault_stats;                             // 故障统计
+	//校准
+	aht21_calib_t      calib;                                    // 本传感器的增益/偏移
+#if AHT21_CFG_HEALTH
+	//健康监测
+	aht21_health_t     health;                                   // 健康跟踪
+#endif
+#if AHT21_CFG_TRACE
+	uint32_t           trace_wait_start;                         // 触发完成时刻(追踪时钟)
+#endif
 };
 
+/*
+ * 时基的分派 静态分派模式下直接调用编译期绑定的函数
+ */
+#if AHT21_CFG_STATIC_DISPATCH
+#define AHT21_GET_TICK(inst)         ((uint32_t)AHT21_CFG_GET_TICK())
+#else
+#define AHT21_GET_TICK(inst)         ((inst)->pftimebase_interface->mcu_get_systick_count())
+#endif
+
+//周期采样
+typedef struct
+{
+	uint32_t period_ms;                                          // 采样周期
+	uint32_t next_deadline;                                      // 下一次采样的绝对时刻
+	uint32_t missed;                                             // 因超时跳过的周期数
+	aht21_wait_until_t pfsleep_until;                            // 任务睡眠到绝对时刻 NULL时用aht21_wait_until
+}aht21_periodic_t;
+
 /**
  * AHT21传感器初始化函数
  */
@@ -122,12 +309,139 @@ int8_t aht21_read_id(bsp_aht21_t *aht21_instance);
  * 读取温度/温度
  */
 int8_t aht21_read_data(bsp_aht21_t *aht21_instance,float *temp,float *humi);					      
+/**
+ * 按固定周期采集n个带时间戳的样本
+ */
+int8_t aht21_read_burst(bsp_aht21_t *aht21_instance,aht21_sample_t *out,uint16_t n,uint32_t period_ms);
+/**
+ * 触发一次测量 立即返回
+ */
+int8_t aht21_start(bsp_aht21_t *aht21_instance);
+/**
+ * 查询转换是否完成 0完成 RET_CODE_AHT21_BUSY未完成
+ */
+int8_t aht21_poll_ready(bsp_aht21_t *aht21_instance);
+/**
+ * 读取已完成转换的温度/湿度
+ */
+int8_t aht21_fetch(bsp_aht21_t *aht21_instance,float *temp,float *humi);
+/**
+ * 读取已完成转换的数据到带时间戳的样本
+ */
+int8_t aht21_fetch_sample(bsp_aht21_t *aht21_instance,aht21_sample_t *sample);
+/**
+ * 读取已完成转换的原始数据 不使用浮点
+ */
+int8_t aht21_fetch_raw(bsp_aht21_t *aht21_instance,aht21_raw_data_t *raw);
+/**
+ * 读取已完成转换的温度(0.01摄氏度)/湿度(0.01%RH)
+ */
+int8_t aht21_fetch_centi(bsp_aht21_t *aht21_instance,int16_t *temp_centi,uint16_t *humi_centi);
+
+/*
+ * 原始码转换 只用乘法和移位
+ * T = raw * 200 / 2^20 - 50   =>  0.01摄氏度 = raw * 625 / 2^15 - 5000
+ * RH = raw * 100 / 2^20       =>  0.01%RH    = raw * 625 / 2^16
+ * raw最大0xFFFFF 乘625后不超过32位
+ */
+static inline int16_t aht21_raw_to_temp_centi(uint32_t raw)
+{
+	return (int16_t)((int32_t)(((raw & 0xFFFFF) * 625U + (1U << 14)) >> 15) - 5000);
+}
+static inline uint16_t aht21_raw_to_humi_centi(uint32_t raw)
+{
+	return (uint16_t)(((raw & 0xFFFFF) * 625U + (1U << 15)) >> 16);
+}
+/*
+ * 满量程比例 与arm_math.h的q31_t/q15_t兼容
+ * 湿度 = q * 100%RH   温度 = q * 200 - 50 摄氏度
+ */
+static inline int32_t aht21_raw_to_q31(uint32_t raw)
+{
+	return (int32_t)((raw & 0xFFFFF) << 11);
+}
+static inline int16_t aht21_raw_to_q15(uint32_t raw)
+{
+	return (int16_t)((raw & 0xFFFFF) >> 5);
+}
+/*
+ * 浮点转换 仅在需要浮点结果时调用
+ */
+static inline float aht21_raw_to_temp_float(uint32_t raw)
+{
+	return (float)raw * (200.0f / 1048576.0f) - 50.0f;
+}
+static inline float aht21_raw_to_humi_float(uint32_t raw)
+{
+	return (float)raw * (100.0f / 1048576.0f);
+}
+
+/**
+ * 设置转换等待方式及查询退避参数
+ */
+int8_t aht21_set_wait_mode(bsp_aht21_t *aht21_instance,aht21_wait_mode_t mode,
+                           uint16_t backoff_init_ms,uint16_t backoff_max_ms);
+/**
+ * 设置CRC校验
+ */
+int8_t aht21_set_crc(bsp_aht21_t *aht21_instance,bool enable,uint8_t retry_max);
+/**
+ * 获取转换时间统计
+ */
+int8_t aht21_get_conv_stats(bsp_aht21_t *aht21_instance,aht21_conv_stats_t *stats);
+/**
+ * 设置校准参数 calib为NULL时恢复默认(不校准)
+ */
+int8_t aht21_set_calib(bsp_aht21_t *aht21_instance,const aht21_calib_t *calib);
+/**
+ * 读取已完成转换的数据 输出校准后的温湿度及露点、绝对湿度、体感温度
+ */
+int8_t aht21_fetch_comp(bsp_aht21_t *aht21_instance,aht21_comp_t *comp);
+#if AHT21_CFG_HEALTH
+/**
+ * 设置健康检测阈值 cfg为NULL时恢复默认 同时清除健康统计
+ */
+int8_t aht21_set_health_cfg(bsp_aht21_t *aht21_instance,const aht21_health_cfg_t *cfg);
+/**
+ * 获取健康状态及统计
+ */
+int8_t aht21_get_health(bsp_aht21_t *aht21_instance,aht21_health_t *health);
+#endif
+/**
+ * 睡眠到绝对时刻deadline_tick 优先使用时基的pfwait_until 否则循环pfyield
+ */
+void aht21_wait_until(bsp_aht21_t *aht21_instance,uint32_t deadline_tick);
 /**
  * @brief 使AHT21传感器进入软件复位状态
  */
-void aht21_softReset(void);
-// 进入休眠模式
-int8_t aht21_sleep(void);
-// 唤醒WT588F
-int8_t aht21_wakeup(void);
+int8_t aht21_softReset(bsp_aht21_t *aht21_instance);
+/**
+ * 经实例的IIC接口向同一总线上的任意从机执行事务 带超时、重试和总线解锁
+ */
+int8_t aht21_iic_transfer(bsp_aht21_t *aht21_instance,uint8_t addr,uint8_t *pdata,uint8_t size,bool read);
+/**
+ * 获取总线故障统计
+ */
+int8_t aht21_get_fault_stats(bsp_aht21_t *aht21_instance,aht21_fault_stats_t *stats);
+/**
+ * 进入休眠模式
+ */
+int8_t aht21_sleep(bsp_aht21_t *aht21_instance);
+/**
+ * 唤醒AHT21
+ */
+int8_t aht21_wakeup(bsp_aht21_t *aht21_instance);
+/**
+ * 设置传感器供电开关
+ */
+int8_t aht21_set_power_hook(bsp_aht21_t *aht21_instance,int8_t (*pfpower)(bool on));
+/**
+ * 启动周期采样
+ */
+int8_t aht21_periodic_start(bsp_aht21_t *aht21_instance,aht21_periodic_t *periodic,
+                            uint32_t period_ms,aht21_wait_until_t pfsleep_until);
+/**
+ * 执行一个采样周期 睡眠到本周期时刻 采集一个样本后传感器休眠
+ */
+int8_t aht21_periodic_step(bsp_aht21_t *aht21_instance,aht21_periodic_t *periodic,aht21_sample_t *sample);
 #endif
@@ -0,0 +1,83 @@
+/******************************************************************************
+ * Copyright (C) 2024 EternalChip, Inc.(Gmbh) or its affiliates.
+ *
+ * All Rights Reserved.
+ *
+ * File name: ec_bsp_aht21_frame.h
+ *
+ * Description: Decode the AHT21 measurement frame.
+ *
+ * Frame layout (byte 6 only present in the 7-byte CRC read):
+ *
+ *   byte0     byte1     byte2     byte3       byte4     byte5     byte6
+ *   status    H[19:12]  H[11:4]   H[3:0]T[19:16] T[15:8] T[7:0]    CRC-8
+ *
+ * The decoder only uses shifts and masks, has no branches and does not
+ * depend on the driver instance, so it can be used on buffered frames too.
+ *
+ * Version: V1.0
+ *
+ * Modifications:
+ *
+ *
+ * Note: 1 tab == 4 spaces!
+ *
+ *****************************************************************************/
+
+#ifndef __EC_BSP_AHT21_FRAME_H__
+#define __EC_BSP_AHT21_FRAME_H__
+
+#include <stdint.h>
+
+#define AHT21_FRAME_LEN          6     // 不带CRC的测量帧长度
+#define AHT21_FRAME_CRC_LEN      7     // 带CRC的测量帧长度
+#define AHT21_STATUS_BUSY_MASK   0x80  // 状态字节busy位
+#define AHT21_STATUS_CAL_MASK    0x08  // 状态字节校准使能位
+#define AHT21_CRC8_POLY          0x31  // CRC-8多项式 x^8+x^5+x^4+1
+#define AHT21_CRC8_INIT          0xFF  // CRC-8初值
+
+//原始测量数据
+typedef struct
+{
+	uint32_t humi_raw;               // 20位湿度码
+	uint32_t temp_raw;               // 20位温度码
+	uint8_t  status;                 // 状态字节
+}aht21_raw_data_t;
+
+/**
+ * @brief 解码一帧测量数据 无分支
+ *
+ * @param frame 至少AHT21_FRAME_LEN字节
+ * @param raw   解码输出
+ */
+void aht21_frame_decode(const uint8_t *frame, aht21_raw_data_t *raw);
+
+/**
+ * @brief 批量解码连续存放的测量帧
+ *
+ * @param frames  第一帧起始地址
+ * @param stride  相邻两帧间隔 AHT21_FRAME_LEN 或 AHT21_FRAME_CRC_LEN
+ * @param count   帧数
+ * @param raw     输出数组 至少count个元素
+ * @return 状态字节busy位为0(转换完成)的帧数
+ */
+uint32_t aht21_frame_decode_batch(const uint8_t *frames, uint32_t stride, uint32_t count, aht21_raw_data_t *raw);
+
+/**
+ * @brief 计算CRC-8(查表) 多项式0x31 初值0xFF
+ *
+ * @param pdata 数据
+ * @param size  长度
+ * @return CRC值
+ */
+uint8_t aht21_frame_crc8(const uint8_t *pdata, uint8_t size);
+
+/**
+ * @brief 状态字节busy位 1表示仍在转换
+ */
+static inline uint8_t aht21_frame_is_busy(uint8_t status)
+{
+	return (uint8_t)((status & AHT21_STATUS_BUSY_MASK) >> 7);
+}
+
+#endif //__EC_BSP_AHT21_FRAME_H__
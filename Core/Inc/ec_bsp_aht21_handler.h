@@ -12,6 +12,24 @@
  * - 确保I2C库和操作系统已经初始化并配置正确。
  * - 所有函数都假定传感器的I2C地址为0x38（默认地址）。
  * - 读取数据函数返回的温湿度值为浮点数，单位分别是摄氏度和百分比。
+ * - 采样线程把最新样本发布到无锁样本槽(ec_bsp_aht21_latest.h)，请求方按值读取，不经过互斥量；
+ *   也可按序号借用样本，不复制。
+ * - 请求结果以aht21_sample_t(温湿度、时间戳、结果码、序号)按值写入调用方的记录，
+ *   回调得到const指针。
+ * - handler线程阻塞在queue_event上，空闲及转换期间均不占用cpu。
+ * - 缓存样本不满足请求的lifetime时请求进入queue_event，返回RET_CODE_AHT21_PENDING；
+ *   时效窗口重叠的请求合并为一次转换，转换完成后按最早时限优先(时限相同按
+ *   priority)写出数据并回调；赶不上时限的请求以RET_CODE_AHT21_DEADLINE拒绝。
+ * - 请求数、缓存命中、转换数、队列深度、交付延迟直方图和IIC错误由
+ *   temp_humi_handler_metrics_snapshot编码为变长整数二进制快照(ec_bsp_aht21_metrics.h)。
+ * - 周期性数据通过temp_humi_handler_subscribe订阅，全部订阅共用一个采样计划，
+ *   结果投递到队列、流缓冲区或回调。
+ * - 成功的样本同时写入历史存储(ec_bsp_aht21_history.h)，可按时间窗口查询原始样本
+ *   和分钟/小时汇总。
+ * - AHT21_HANDLER_STATIC_ALLOC为1时队列、互斥量和handler任务由调用方提供的
+ *   temp_humi_handler_storage_t静态创建，启动后不使用FreeRTOS堆；
+ *   通过temp_humi_handler_start启动。需要FreeRTOSConfig.h中
+ *   configSUPPORT_STATIC_ALLOCATION为1。
  *
  * @par 依赖项
  * - aht21.h : 包含AHT21传感器驱动的头文件。
@@ -28,6 +46,8 @@
 #define EC_BSP_AHT21_HANDLER_H
 
 #include "ec_bsp_aht21_driver.h"
+#include "ec_bsp_aht21_history.h"
+#include "ec_bsp_aht21_metrics.h"
 
 #include <stdint.h>
 #include <stdbool.h>
@@ -35,6 +55,28 @@
 #include <stdlib.h>
 #include <string.h>
 #include "error_codes.h"
+
+#define AHT21_HANDLER_QUEUE_LEN      10    // 待处理请求队列深度
+#define AHT21_HANDLER_CONVERT_RETRY  3     // 连续转换失败达到该次数后本批请求以失败码结束
+#define AHT21_HANDLER_SUB_MAX        8     // 订阅数上限
+#define AHT21_HANDLER_SUB_SLACK_MS   20    // 在该时间内即将到期的订阅共用本次转换
+#define AHT21_HANDLER_QUEUE_RESERVE  2     // 请求队列最后几个位置只接受priority非0的请求
+#define AHT21_HANDLER_SOFT_DEADLINE_MS 1000 // 未设时限的请求按该时限参与排序 不会被拒绝
+
+#ifndef AHT21_HANDLER_STATIC_ALLOC
+#define AHT21_HANDLER_STATIC_ALLOC   0     // 1: 队列、互斥量和任务静态创建
+#endif
+#ifndef AHT21_HANDLER_STACK_DEPTH
+#define AHT21_HANDLER_STACK_DEPTH    256   // handler任务栈深度(StackType_t个数)
+#endif
+
+#if AHT21_HANDLER_STATIC_ALLOC
+#include "FreeRTOS.h"
+#if !configSUPPORT_STATIC_ALLOCATION
+#error "AHT21_HANDLER_STATIC_ALLOC requires configSUPPORT_STATIC_ALLOCATION"
+#endif
+#endif
+
 // 请求数据类型枚举
 typedef enum
 {
@@ -43,17 +85,51 @@ typedef enum
     TEMP_HUMI_EVENT_TYPE_BOTH,
 } temp_humi_t;
 
-// 请求事件结构体
+#define TEMP_HUMI_LIFETIME_ANY       UINT32_MAX // 接受任意已有样本
+
+// 请求事件结构体 结果按值交付
 typedef struct
 {
-    float *temp;
-    float *humi;
-    uint32_t *lifetime;
-    uint32_t *timestamp;
-    temp_humi_t type_of_data;
-    void (*callback)(float *, float *);
+    aht21_sample_t *sample;   // 调用方拥有的样本记录 结果复制到此处 可为NULL
+    uint32_t lifetime;        // 可接受的样本年龄(ms) TEMP_HUMI_LIFETIME_ANY表示任意
+    uint32_t deadline;        // 从发送起的完成时限(ms) 0表示不限
+    uint8_t priority;         // 时限相同时数值大的先回调 非0可使用队列保留位置
+    temp_humi_t type_of_data; // 未请求的一项为0
+    void (*callback)(const aht21_sample_t *sample, void *arg); // 可为NULL sample为NULL时借用handler的样本
+    void *arg;                // 回调参数
 } temp_humi_event_t;
 
+// 排队中的请求 not_before之后触发的转换满足该请求
+typedef struct
+{
+    temp_humi_event_t *event;  // 请求事件 回调完成前调用者需保持有效
+    uint32_t not_before;       // 请求时刻 - min(lifetime, INT32_MAX)
+    uint32_t deadline;         // 绝对完成时限 按此排序(最早时限优先)
+    uint8_t priority;
+    uint8_t hard;              // 1: 调用方设置了时限 赶不上时拒绝
+    uint8_t any;               // 1: lifetime为TEMP_HUMI_LIFETIME_ANY 任意样本都满足
+    uint32_t arrival;          // 发送时刻 用于统计交付延迟
+} temp_humi_request_t;
+
+// 订阅结果投递方式
+typedef enum
+{
+    TEMP_HUMI_SINK_QUEUE = 0, // xQueueSend 元素大小sizeof(aht21_sample_t)
+    TEMP_HUMI_SINK_STREAM,    // xStreamBufferSend 每个样本sizeof(aht21_sample_t)字节
+    TEMP_HUMI_SINK_CALLBACK,  // 在handler线程中回调
+} temp_humi_sink_t;
+
+// 订阅配置
+typedef struct
+{
+    uint32_t period_ms;        // 投递周期
+    temp_humi_t type_of_data;  // 订阅的数据类型
+    temp_humi_sink_t sink;     // 投递方式
+    void *target;              // QueueHandle_t 或 StreamBufferHandle_t
+    void (*callback)(const aht21_sample_t *sample, void *arg); // sink为回调时使用
+    void *arg;                 // 回调参数
+} temp_humi_subscribe_t;
+
 // 提供给RTOS初始化结构体参数
 typedef struct
 {
@@ -64,6 +140,21 @@ typedef struct
     void *rtos_yeild; // 操作系统切换
 } bsp_AHT21_handler_arg_struct;
 
+#if AHT21_HANDLER_STATIC_ALLOC
+// handler的全部RTOS对象 由调用方以静态变量提供 任务运行期间不能释放
+typedef struct
+{
+    StaticTask_t task;
+    StackType_t stack[AHT21_HANDLER_STACK_DEPTH];
+    StaticQueue_t queue;
+    uint8_t queue_storage[AHT21_HANDLER_QUEUE_LEN * sizeof(temp_humi_request_t)];
+    StaticSemaphore_t init_lock;
+} temp_humi_handler_storage_t;
+
+// 调用方提供的RTOS对象占用的RAM(字节)
+#define AHT21_HANDLER_STORAGE_RAM    (sizeof(temp_humi_handler_storage_t))
+#endif
+
 // 提前定义bsp_aht21_handler_t防止报错
 typedef struct bsp_aht21_handler_t bsp_aht21_handler_t;
 /**
@@ -102,6 +193,8 @@ struct bsp_aht21_handler_t
     void * lifetimes_humi;
     void * queue_event;
     void * thread_os;
+    // 运行指标 请求方任务与handler线程在临界区内更新
+    aht21_metrics_t metrics;
 };
 
 /**
@@ -178,11 +271,97 @@ static int8_t inst_BSP_driver_instance(bsp_aht21_handler_t *aht21_handler_instan
  */
 void temp_humi_handler_thread(bsp_AHT21_handler_arg_struct *bsp_AHT21_handler_arg_instance); // 被操作系统调用的
 
+#if AHT21_HANDLER_STATIC_ALLOC
 /**
- * @param event  temp_humi_event_t 实例
- * @attention 接收参数来提供温湿度
+ * @param bsp_AHT21_handler_arg_instance  handler参数 任务运行期间不能释放
+ * @param storage                         RTOS对象存储 任务运行期间不能释放
+ * @param priority                        任务优先级
+ * @attention 以静态存储创建handler任务 只能调用一次
  * @return 0 表示成功，其他值表示失败
  */
+int8_t temp_humi_handler_start(bsp_AHT21_handler_arg_struct *bsp_AHT21_handler_arg_instance,
+                               temp_humi_handler_storage_t *storage, UBaseType_t priority);
+#endif
+
+/**
+ * 本模块占用的RAM(字节) 不含调用方提供的存储和handler任务栈
+ */
+extern const uint32_t g_temp_humi_handler_ram;
+
+/**
+ * @param event  temp_humi_event_t 实例
+ * @attention 接收参数来提供温湿度 缓存不满足时效时排队等待转换
+ * @return 0 表示成功，已回调
+ *         RET_CODE_AHT21_PENDING  已排队 转换完成后写出数据并回调
+ *         RET_CODE_AHT21_DEADLINE 时限短于一次转换 未排队
+ *         其他值表示失败
+ */
 int8_t temp_humi_event_handler_send(temp_humi_event_t *event);
 
+/**
+ * @param sample  样本输出
+ * @param seq     样本序号输出 可为NULL 序号变化表示有新样本
+ * @attention 按值读取最新样本 不加锁 可在任务或中断中调用
+ * @return 0 表示成功，其他值表示失败
+ */
+int8_t temp_humi_handler_read_latest(aht21_sample_t *sample, uint32_t *seq);
+
+/**
+ * @param seq  借用的序号输出
+ * @attention 借用最新样本 不复制 读完后需调用temp_humi_handler_borrow_valid
+ * @return 样本 尚无样本时为NULL
+ */
+const aht21_sample_t *temp_humi_handler_borrow_latest(uint32_t *seq);
+
+/**
+ * @param seq  借用的序号
+ * @attention 借用期间样本是否未被改写
+ * @return true 有效
+ */
+bool temp_humi_handler_borrow_valid(uint32_t seq);
+
+/**
+ * @param from  起始时刻(含)
+ * @param to    结束时刻(含)
+ * @param out   输出
+ * @param max   out容量
+ * @attention 复制原始样本窗口 不加锁
+ * @return 复制数
+ */
+uint16_t temp_humi_handler_history_raw(uint32_t from, uint32_t to, aht21_history_raw_t *out, uint16_t max);
+
+/**
+ * @param level  汇总级别
+ * @param from   桶起始时刻下限(含)
+ * @param to     桶起始时刻上限(含)
+ * @param out    输出
+ * @param max    out容量
+ * @attention 复制分钟/小时汇总窗口 不加锁
+ * @return 复制数
+ */
+uint16_t temp_humi_handler_history_rollup(aht21_history_level_t level, uint32_t from, uint32_t to,
+                                          aht21_history_rollup_t *out, uint16_t max);
+
+/**
+ * @param buf   输出 AHT21_METRICS_SNAPSHOT_MAX字节总是足够
+ * @param size  buf容量
+ * @attention 把运行指标编码为二进制快照 不清零计数
+ * @return 写入字节数 handler未运行或buf不足时为0
+ */
+uint16_t temp_humi_handler_metrics_snapshot(uint8_t *buf, uint16_t size);
+
+/**
+ * @param sub  订阅配置
+ * @attention 订阅周期性温湿度 多个订阅共用一次转换
+ * @return >=0 订阅号，其他值表示失败
+ */
+int8_t temp_humi_handler_subscribe(const temp_humi_subscribe_t *sub);
+
+/**
+ * @param id  订阅号
+ * @attention 取消订阅 正在进行的投递仍会完成 订阅号由handler线程回收后才会被复用
+ * @return 0 表示成功，其他值表示失败
+ */
+int8_t temp_humi_handler_unsubscribe(int8_t id);
+
 #endif
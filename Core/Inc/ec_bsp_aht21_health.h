@@ -0,0 +1,158 @@
+/******************************************************************************
+ * Copyright (C) 2024 EternalChip, Inc.(Gmbh) or its affiliates.
+ *
+ * All Rights Reserved.
+ *
+ * File name: ec_bsp_aht21_health.h
+ *
+ * Description: Per-instance health tracking for AHT21 sensors.
+ *
+ * Processing flow:
+ *
+ *   measurement outcome -> stuck run / saturation / range / rate checks
+ *                       -> CRC and NACK rate (EWMA)
+ *                       -> flags -> health state
+ *
+ * Every check keeps only the previous sample and a few counters, one update
+ * is O(1) in time and memory; no history buffer is scanned.
+ *
+ * State derivation (evaluated after every measurement):
+ *   FAILED    stuck run >= stuck_limit, raw code saturated, fail_limit
+ *             measurements in a row failed, or CRC/NACK rate >= rate_fail
+ *   DEGRADED  out of range, rate of change exceeded, or
+ *             CRC/NACK rate >= rate_warn
+ *   OK        none of the above
+ *   UNKNOWN   no measurement yet
+ *
+ * Version: V1.0
+ *
+ * Modifications:
+ *
+ *
+ * Note: 1 tab == 4 spaces!
+ *
+ *****************************************************************************/
+
+#ifndef __EC_BSP_AHT21_HEALTH_H__
+#define __EC_BSP_AHT21_HEALTH_H__
+
+#include <stdint.h>
+
+#define AHT21_HEALTH_EWMA_SHIFT      4     // 错误率滑动平均系数1/16
+#define AHT21_HEALTH_RAW_FULL        0xFFFFF // 20位原始码满量程
+
+//健康状态标志
+#define AHT21_HEALTH_F_STUCK         0x01  // 连续相同原始码达到阈值
+#define AHT21_HEALTH_F_SATURATED     0x02  // 原始码为0或满量程
+#define AHT21_HEALTH_F_RANGE         0x04  // 超出配置的量程
+#define AHT21_HEALTH_F_RATE          0x08  // 变化率超限
+#define AHT21_HEALTH_F_CRC           0x10  // CRC错误率超限
+#define AHT21_HEALTH_F_COMM          0x20  // NACK/超时率超限
+#define AHT21_HEALTH_F_NO_DATA       0x40  // 连续测量失败达到阈值
+
+//健康状态
+typedef enum
+{
+	AHT21_HEALTH_UNKNOWN = 0,        // 尚无测量
+	AHT21_HEALTH_OK,                 // 正常
+	AHT21_HEALTH_DEGRADED,           // 数据可用但可疑
+	AHT21_HEALTH_FAILED,             // 数据不可信
+}aht21_health_state_t;
+
+//检测阈值 0表示不检测该项
+typedef struct
+{
+	uint16_t stuck_limit;            // 连续相同原始码(温湿度同时不变)的次数
+	int16_t  temp_min;               // 温度下限(0.01摄氏度)
+	int16_t  temp_max;               // 温度上限(0.01摄氏度)
+	uint16_t humi_min;               // 湿度下限(0.01%RH)
+	uint16_t humi_max;               // 湿度上限(0.01%RH)
+	uint16_t temp_rate_max;          // 温度变化率上限(0.01摄氏度/s)
+	uint16_t humi_rate_max;          // 湿度变化率上限(0.01%RH/s)
+	uint16_t rate_warn;              // CRC/NACK率告警阈值(千分比)
+	uint16_t rate_fail;              // CRC/NACK率失效阈值(千分比)
+	uint8_t  fail_limit;             // 连续测量失败次数
+}aht21_health_cfg_t;
+
+//一次测量的结果 由驱动填写
+typedef struct
+{
+	uint32_t tick;                   // 测量时刻(毫秒)
+	int8_t   code;                   // 测量结果码 非0时下列数据无效
+	uint32_t temp_raw;               // 20位温度码
+	uint32_t humi_raw;               // 20位湿度码
+	int16_t  temp;                   // 校准后温度(0.01摄氏度)
+	uint16_t humi;                   // 校准后湿度(0.01%RH)
+	uint32_t comm_errors;            // 累计NACK+超时次数
+	uint32_t crc_errors;             // 累计CRC错误帧数
+}aht21_health_input_t;
+
+//健康统计
+typedef struct
+{
+	uint32_t samples;                // 成功测量数
+	uint32_t failures;               // 失败测量数
+	uint32_t stuck_events;           // 进入卡死的次数
+	uint32_t range_violations;       // 超量程次数
+	uint32_t rate_violations;        // 变化率超限次数
+	uint16_t max_stuck_run;          // 最长相同原始码连续次数
+}aht21_health_stats_t;
+
+//单个传感器的健康跟踪
+typedef struct
+{
+	aht21_health_cfg_t   cfg;
+	aht21_health_stats_t stats;
+	uint32_t last_tick;              // 上一个成功样本时刻
+	uint32_t last_temp_raw;          // 上一个成功样本原始码
+	uint32_t last_humi_raw;
+	int16_t  last_temp;              // 上一个成功样本(0.01单位)
+	uint16_t last_humi;
+	uint32_t last_comm_errors;       // 上一次的累计计数 用于求增量
+	uint32_t last_crc_errors;
+	uint32_t crc_rate_q16;           // 含CRC错误的测量比例(Q16 滑动平均)
+	uint32_t comm_rate_q16;          // 含NACK/超时的测量比例(Q16 滑动平均)
+	uint16_t stuck_run;              // 当前相同原始码连续次数
+	uint8_t  fail_run;               // 当前连续失败次数
+	uint8_t  has_last;               // last_*有效
+	uint8_t  flags;                  // AHT21_HEALTH_F_xxx
+	uint8_t  state;                  // aht21_health_state_t
+}aht21_health_t;
+
+/**
+ * @brief 默认阈值
+ *
+ * 卡死8次 -40~120摄氏度 0~100%RH 2摄氏度/s 10%RH/s
+ * CRC/NACK率告警10% 失效25% 连续失败3次
+ * 告警阈值高于一次错误的滑动平均步长(1/16=6.25%) 偶发单次错误不告警
+ *
+ * @param cfg 输出
+ */
+void aht21_health_cfg_default(aht21_health_cfg_t *cfg);
+
+/**
+ * @brief 复位健康跟踪
+ *
+ * @param health 跟踪状态
+ * @param cfg    阈值 NULL时使用默认值
+ */
+void aht21_health_reset(aht21_health_t *health, const aht21_health_cfg_t *cfg);
+
+/**
+ * @brief 记录一次测量结果 O(1)
+ *
+ * @param health 跟踪状态
+ * @param in     测量结果
+ * @return aht21_health_state_t
+ */
+uint8_t aht21_health_update(aht21_health_t *health, const aht21_health_input_t *in);
+
+/**
+ * @brief 错误率Q16转千分比
+ */
+static inline uint16_t aht21_health_rate_permille(uint32_t rate_q16)
+{
+	return (uint16_t)((rate_q16 * 1000U + (1U << 15)) >> 16);
+}
+
+#endif //__EC_BSP_AHT21_HEALTH_H__
@@ -0,0 +1,128 @@
+/**
+ * @file ec_bsp_aht21_history.h
+ * @brief AHT21 多分辨率历史数据头文件
+ *
+ * 固定内存的历史存储，三级分辨率：
+ * - 原始样本  最近AHT21_HISTORY_RAW_LEN个样本
+ * - 分钟汇总  最近AHT21_HISTORY_MINUTE_LEN分钟的min/mean/max
+ * - 小时汇总  最近AHT21_HISTORY_HOUR_LEN小时的min/mean/max
+ *
+ * 每写入一个样本只更新当前分钟的累加器，分钟结束时写入分钟环并累加到当前
+ * 小时，不回扫历史。
+ *
+ * 读取不阻塞写入：每个环有单调递增的写入计数，写入者先写记录再发布计数；
+ * 读者按计数复制窗口，复制后重新读取计数，把复制期间可能被覆盖的最旧记录
+ * 从结果中去掉。读取耗时只与环长度有关，不重试。环中最旧的一条随时可能被下一次
+ * 写入覆盖，不返回，因此每个环最多返回长度减1条。
+ *
+ * @version 1.0
+ * @date 2024-07-20
+ *
+ * @note
+ * - 单写入者，多读者。读者可以在任意任务中调用，不应在中断中复制大窗口。
+ * - 汇总桶从第一个样本时刻开始按固定长度对齐，时间戳与驱动时基相同(毫秒)。
+ * - 查询只返回已结束的汇总桶。
+ *
+ * @par 依赖项
+ * - ec_bsp_aht21_driver.h : aht21_sample_t定义。
+ *
+ * @par 版本历史
+ * - 1.0 初始版本
+ *
+ * @par 作者
+ * - liyijie
+ */
+
+#ifndef __EC_BSP_AHT21_HISTORY_H__
+#define __EC_BSP_AHT21_HISTORY_H__
+
+#include "ec_bsp_aht21_driver.h"
+
+#include <stdint.h>
+
+#ifndef AHT21_HISTORY_RAW_LEN
+#define AHT21_HISTORY_RAW_LEN        256   // 原始样本数 1Hz采样约4分钟
+#endif
+#ifndef AHT21_HISTORY_MINUTE_LEN
+#define AHT21_HISTORY_MINUTE_LEN     60    // 分钟汇总数
+#endif
+#ifndef AHT21_HISTORY_HOUR_LEN
+#define AHT21_HISTORY_HOUR_LEN       48    // 小时汇总数
+#endif
+
+#define AHT21_HISTORY_MINUTE_MS      60000U
+#define AHT21_HISTORY_HOUR_MS        3600000U
+
+// 汇总级别
+typedef enum
+{
+	AHT21_HISTORY_MINUTE = 0,
+	AHT21_HISTORY_HOUR,
+	AHT21_HISTORY_LEVEL_NUM,
+}aht21_history_level_t;
+
+// 原始样本
+typedef struct
+{
+	uint32_t timestamp;              // 触发时刻
+	int16_t  temp;                   // 温度(0.01摄氏度)
+	uint16_t humi;                   // 湿度(0.01%RH)
+}aht21_history_raw_t;
+
+// 汇总桶
+typedef struct
+{
+	uint32_t start;                  // 桶起始时刻
+	uint32_t count;                  // 样本数
+	int16_t  temp_min;               // 温度(0.01摄氏度)
+	int16_t  temp_mean;
+	int16_t  temp_max;
+	uint16_t humi_min;               // 湿度(0.01%RH)
+	uint16_t humi_mean;
+	uint16_t humi_max;
+}aht21_history_rollup_t;
+
+// 当前桶累加器 只由写入者访问
+typedef struct
+{
+	uint32_t start;
+	uint32_t count;
+	int32_t  temp_sum;
+	uint32_t humi_sum;
+	int16_t  temp_min;
+	int16_t  temp_max;
+	uint16_t humi_min;
+	uint16_t humi_max;
+}aht21_history_acc_t;
+
+// 历史存储
+typedef struct
+{
+	aht21_history_raw_t    raw[AHT21_HISTORY_RAW_LEN];
+	aht21_history_rollup_t minute[AHT21_HISTORY_MINUTE_LEN];
+	aht21_history_rollup_t hour[AHT21_HISTORY_HOUR_LEN];
+	volatile uint32_t      raw_head;                       // 累计写入数
+	volatile uint32_t      rollup_head[AHT21_HISTORY_LEVEL_NUM];
+	aht21_history_acc_t    acc[AHT21_HISTORY_LEVEL_NUM];   // 当前分钟/小时
+}aht21_history_t;
+
+/**
+ * 清空历史
+ */
+void aht21_history_init(aht21_history_t *history);
+/**
+ * 写入一个成功的样本 O(1)
+ */
+void aht21_history_push(aht21_history_t *history, const aht21_sample_t *sample);
+/**
+ * 复制时间戳在[from, to]内的原始样本 按时间顺序 返回复制数
+ */
+uint16_t aht21_history_read_raw(const aht21_history_t *history, uint32_t from, uint32_t to,
+                                aht21_history_raw_t *out, uint16_t max);
+/**
+ * 复制起始时刻在[from, to]内的汇总桶 按时间顺序 返回复制数
+ */
+uint16_t aht21_history_read_rollup(const aht21_history_t *history, aht21_history_level_t level,
+                                   uint32_t from, uint32_t to, aht21_history_rollup_t *out, uint16_t max);
+
+#endif //__EC_BSP_AHT21_HISTORY_H__
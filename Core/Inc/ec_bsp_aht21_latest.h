@@ -0,0 +1,73 @@
+/**
+ * @file ec_bsp_aht21_latest.h
+ * @brief AHT21 最新样本缓存头文件
+ *
+ * 单生产者、多读者的最新样本槽：采样任务调用aht21_latest_publish发布样本，
+ * 任意数量的任务或中断调用aht21_latest_read按值取出一个一致的
+ * (温度, 湿度, 时间戳)元组，不使用互斥量也不关中断。
+ *
+ * 实现为双缓冲序号锁(seqlock latch)：
+ * - 发布者写入buf[(seq + 1) & 1]，屏障后seq加1，读者看到的缓冲区在发布期间不被改写
+ * - 读者读取seq，复制buf[seq & 1]，屏障后重新读取seq，不变即复制有效
+ * - 中断中的读者抢占发布者时seq不会变化，读到上一个完整样本，无需重试；
+ *   只有读者在复制期间被发布打断才会重试，重试次数有上限
+ * - 不需要副本的读者用aht21_latest_borrow直接引用缓冲区，用完后调用
+ *   aht21_latest_valid确认序号未变，否则丢弃读到的数据
+ * - 发布时把序号写入样本的seq，请求方可据此判断样本是否更新
+ *
+ * @version 1.0
+ * @date 2024-07-16
+ *
+ * @note
+ * - 同一个槽只能有一个发布者。
+ * - 读者不写槽，可在任意优先级的中断中调用。
+ *
+ * @par 依赖项
+ * - ec_bsp_aht21_driver.h : aht21_sample_t定义。
+ *
+ * @par 版本历史
+ * - 1.0 初始版本
+ *
+ * @par 作者
+ * - liyijie
+ */
+
+#ifndef __EC_BSP_AHT21_LATEST_H__
+#define __EC_BSP_AHT21_LATEST_H__
+
+#include "ec_bsp_aht21_driver.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define AHT21_LATEST_READ_RETRY      4     // 读者最多重试次数
+
+// 最新样本槽
+typedef struct
+{
+	volatile uint32_t seq;           // 已发布样本数 0表示尚无样本
+	aht21_sample_t    buf[2];        // 双缓冲 当前样本为buf[seq & 1]
+}aht21_latest_t;
+
+/**
+ * 初始化最新样本槽
+ */
+void aht21_latest_init(aht21_latest_t *latest);
+/**
+ * 发布一个样本 只能由唯一的发布者调用
+ */
+void aht21_latest_publish(aht21_latest_t *latest, aht21_sample_t *sample);
+/**
+ * 按值读取最新样本 seq可为NULL
+ */
+int8_t aht21_latest_read(const aht21_latest_t *latest, aht21_sample_t *sample, uint32_t *seq);
+/**
+ * 借用最新样本 尚无样本时返回NULL
+ */
+const aht21_sample_t *aht21_latest_borrow(const aht21_latest_t *latest, uint32_t *seq);
+/**
+ * 借用期间样本是否未被改写
+ */
+bool aht21_latest_valid(const aht21_latest_t *latest, uint32_t seq);
+
+#endif //__EC_BSP_AHT21_LATEST_H__
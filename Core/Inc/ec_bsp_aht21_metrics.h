@@ -0,0 +1,95 @@
+/**
+ * @file ec_bsp_aht21_metrics.h
+ * @brief AHT21 handler运行指标头文件
+ *
+ * 计数器与请求延迟直方图，以及紧凑的二进制快照编码。
+ *
+ * 快照格式：首字节为AHT21_METRICS_VERSION，之后按下表顺序依次为
+ * 无符号LEB128变长整数(每字节低7位有效，最高位为1表示后面还有字节)：
+ *
+ *   requests          收到的请求数
+ *   served            成功交付的请求数(含缓存命中)
+ *   cache_hits        由缓存样本直接满足的请求数
+ *   conversions       触发的转换数(含订阅)
+ *   conv_failures     失败的转换数
+ *   rejected_deadline 因时限拒绝的请求数
+ *   rejected_busy     因队列已满拒绝的请求数
+ *   queue_hwm         请求队列深度最大值
+ *   batch_hwm         批次中待转换请求数最大值
+ *   iic_nack          IIC无应答/后端出错次数
+ *   iic_timeout       IIC事务超时次数
+ *   iic_bus_recover   总线解锁次数
+ *   crc_fail          CRC错误帧数
+ *   latency_buckets   直方图桶数N
+ *   latency[0..N-1]   各桶计数
+ *   failed            因连续转换失败以失败码结束的请求数
+ *
+ * 延迟为请求发送到回调的毫秒数，桶0为0ms，桶i(i>=1)为[2^(i-1), 2^i)ms，
+ * 最后一桶包含更大的值。
+ *
+ * 新增字段只追加在末尾并增加版本号，解析方按版本读取已知字段。
+ *
+ * @version 1.0
+ * @date 2024-07-24
+ *
+ * @par 依赖项
+ * - ec_bsp_aht21_driver.h : aht21_fault_stats_t定义。
+ *
+ * @par 版本历史
+ * - 1.0 初始版本
+ *
+ * @par 作者
+ * - liyijie
+ */
+
+#ifndef __EC_BSP_AHT21_METRICS_H__
+#define __EC_BSP_AHT21_METRICS_H__
+
+#include "ec_bsp_aht21_driver.h"
+
+#include <stdint.h>
+
+#define AHT21_METRICS_VERSION        1
+#define AHT21_METRICS_LATENCY_BUCKETS 12   // 0ms 1ms 2~3ms ... 512~1023ms >=1024ms
+#define AHT21_METRICS_FIELD_NUM      14    // 直方图之前的字段数(含桶数)
+#define AHT21_METRICS_TAIL_NUM       1     // 直方图之后追加的字段数
+// 快照最大字节数 每个uint32变长整数最多5字节
+#define AHT21_METRICS_SNAPSHOT_MAX   \
+	(1 + (AHT21_METRICS_FIELD_NUM + AHT21_METRICS_LATENCY_BUCKETS + AHT21_METRICS_TAIL_NUM) * 5)
+
+// handler运行指标
+typedef struct
+{
+	uint32_t requests;
+	uint32_t served;
+	uint32_t cache_hits;
+	uint32_t conversions;
+	uint32_t conv_failures;
+	uint32_t rejected_deadline;
+	uint32_t rejected_busy;
+	uint32_t queue_hwm;
+	uint32_t batch_hwm;
+	uint32_t latency[AHT21_METRICS_LATENCY_BUCKETS];
+	uint32_t failed;
+}aht21_metrics_t;
+
+/**
+ * 清零
+ */
+void aht21_metrics_reset(aht21_metrics_t *metrics);
+/**
+ * 记录一次交付延迟(ms)
+ */
+void aht21_metrics_latency(aht21_metrics_t *metrics, uint32_t latency_ms);
+/**
+ * 更新最大值
+ */
+void aht21_metrics_hwm(uint32_t *hwm, uint32_t value);
+/**
+ * 编码快照 fault/crc_fail为驱动的IIC统计 fault可为NULL
+ * 返回写入字节数 buf不足时返回0
+ */
+uint16_t aht21_metrics_encode(const aht21_metrics_t *metrics, const aht21_fault_stats_t *fault,
+                              uint32_t crc_fail, uint8_t *buf, uint16_t size);
+
+#endif //__EC_BSP_AHT21_METRICS_H__
@@ -33,6 +33,8 @@
 #define AHT21_AC_1 		0x33
 #define AHT21_AC_2 		0x0
 
+#define AHT21_SOFT_RESET 	0xBA
+
 
 
 #endif //__EC_BSP_AHT21_REG_H__
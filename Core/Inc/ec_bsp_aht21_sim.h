@@ -0,0 +1,122 @@
+/**
+ * @file ec_bsp_aht21_sim.h
+ * @brief AHT21 软件仿真后端头文件
+ *
+ * 在PC上模拟一颗AHT21，通过iic_driver_interface_t(字节级或事务接口)和
+ * system_timebase_interface_t(虚拟时钟)与驱动对接，无需开发板即可编译、
+ * 运行和评测ec_bsp_aht21_driver.c的功能与时序。
+ *
+ * 支持：
+ * - 可配置的转换延时与抖动，转换期间状态字节busy位置1
+ * - 7字节读带CRC-8
+ * - 按间隔注入地址NACK和数据位翻转
+ * - 注入SDA卡死 直到pfBusRecover解锁
+ * - 通过回调脚本化温度/湿度波形
+ *
+ * @version 1.0
+ * @date 2024-07-02
+ *
+ * @note
+ * - 仅用于主机构建，不加入MDK工程。
+ * - 接口回调不带上下文，同一时间只有一个仿真实例被绑定。
+ * - 虚拟时钟只在aht21_sim_advance、aht21_sim_yield或aht21_sim_wait_until中前进。
+ *
+ * @par 依赖项
+ * - ec_bsp_aht21_driver.h
+ *
+ * @par 版本历史
+ * - 1.0 初始版本
+ *
+ * @par 作者
+ * - liyijie
+ */
+
+#ifndef __EC_BSP_AHT21_SIM_H__
+#define __EC_BSP_AHT21_SIM_H__
+
+#include "ec_bsp_aht21_driver.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define AHT21_SIM_CMD_MAX            4     // 单次写入命令最大长度
+
+// 波形回调 返回now_ms时刻的温度(0.01摄氏度)或湿度(0.01%RH)
+typedef int32_t (*aht21_sim_wave_t)(uint32_t now_ms, void *arg);
+
+// 仿真统计
+typedef struct
+{
+	uint32_t triggers;               // 收到的测量命令数
+	uint32_t frames;                 // 完成的读事务数
+	uint32_t busy_reads;             // busy期间的读事务数
+	uint32_t nacks;                  // 注入的NACK数
+	uint32_t bit_flips;              // 注入的位翻转数
+	uint32_t soft_resets;            // 收到的软复位命令数
+	uint32_t bus_recovers;           // pfBusRecover调用次数
+}aht21_sim_stats_t;
+
+// 仿真实例
+typedef struct
+{
+	//配置
+	uint8_t          addr;               // 7位地址
+	uint16_t         conv_latency_ms;    // 转换延时
+	uint16_t         conv_jitter_ms;     // 转换延时随机增量上限
+	uint32_t         nack_interval;      // 每N个地址字节注入一次NACK 0不注入
+	uint32_t         flip_interval;      // 每N个数据字节翻转一位 0不注入
+	bool             bus_stuck;          // 模拟SDA被拉低 所有地址字节无应答
+	aht21_sim_wave_t pftemp_wave;        // 温度波形 NULL时使用temp_centi
+	aht21_sim_wave_t pfhumi_wave;        // 湿度波形 NULL时使用humi_centi
+	void            *wave_arg;           // 波形回调参数
+	int32_t          temp_centi;         // 固定温度
+	int32_t          humi_centi;         // 固定湿度
+
+	//状态
+	uint32_t         now_ms;             // 虚拟时钟
+	uint32_t         conv_done_ms;       // 本次转换完成时刻
+	bool             measuring;          // 已触发测量
+	bool             calibrated;         // 校准使能位
+	uint8_t          frame[AHT21_FRAME_CRC_LEN]; // 最近一次转换结果
+	uint8_t          cmd[AHT21_SIM_CMD_MAX];     // 当前写事务收到的命令
+	uint8_t          cmd_len;
+	uint8_t          read_idx;           // 当前读事务位置
+	bool             addressed;          // 当前事务地址已应答
+	bool             reading;            // 当前事务方向
+	bool             expect_addr;        // 下一个字节为地址字节
+	bool             last_ack;           // 最近一个字节是否应答
+	uint32_t         addr_count;         // 地址字节计数(NACK注入)
+	uint32_t         byte_count;         // 数据字节计数(位翻转注入)
+	uint32_t         rng;                // 伪随机数状态
+	aht21_sim_stats_t stats;
+}aht21_sim_t;
+
+/**
+ * 初始化仿真实例 默认转换延时AHT21_MEASUREMENT_DELAY_MS 25摄氏度 50%RH
+ */
+int8_t aht21_sim_init(aht21_sim_t *sim, uint8_t addr);
+/**
+ * 绑定仿真实例 并填充IIC与时基接口表
+ * use_transfer为true时只提供事务接口 否则只提供字节级接口
+ */
+int8_t aht21_sim_bind(aht21_sim_t *sim, iic_driver_interface_t *iic_instance,
+                      system_timebase_interface_t *timebase, bool use_transfer);
+/**
+ * 虚拟时钟前进ms毫秒
+ */
+void aht21_sim_advance(aht21_sim_t *sim, uint32_t ms);
+/**
+ * 作为rtos_yeild传入驱动 每次调用虚拟时钟前进1ms
+ */
+int8_t aht21_sim_yield(bsp_aht21_t *aht21_instance);
+/**
+ * 作为pfwait_until 虚拟时钟直接跳到deadline_tick
+ */
+void aht21_sim_wait_until(uint32_t deadline_tick);
+/**
+ * 温湿度(0.01单位)转原始码 与驱动定点换算互逆
+ */
+uint32_t aht21_sim_temp_to_raw(int32_t temp_centi);
+uint32_t aht21_sim_humi_to_raw(int32_t humi_centi);
+
+#endif //__EC_BSP_AHT21_SIM_H__
@@ -0,0 +1,162 @@
+/**
+ * @file ec_bsp_aht21_trace.h
+ * @brief AHT21 驱动分阶段耗时追踪头文件
+ *
+ * 驱动在每个阶段(触发写、转换等待、帧读取、解码、初始化)结束时写入一条
+ * 带时间戳的事件到固定大小的无锁环形缓冲区；调试任务或串口周期性调用
+ * aht21_trace_drain取出事件，并累计每个阶段的min/avg/max/p99。
+ *
+ * 时间源：
+ * - 目标板默认使用DWT->CYCCNT(aht21_trace_init传入NULL时自动使能)
+ * - 主机仿真构建传入主机时钟函数
+ *
+ * @version 1.0
+ * @date 2024-07-10
+ *
+ * @note
+ * - 仅在AHT21_CFG_TRACE为1时驱动才插入追踪点，默认关闭，关闭时不产生任何代码。
+ * - 环形缓冲区为单生产者单消费者：驱动只能在一个任务中使用，
+ *   aht21_trace_drain只能在另一个任务中调用。缓冲区满时丢弃新事件并计数。
+ * - p99由对数直方图估计，误差不超过一个桶宽(1/2^AHT21_TRACE_HIST_SUB_BITS)。
+ *
+ * @par 依赖项
+ * - ec_bsp_aht21_config.h
+ *
+ * @par 版本历史
+ * - 1.0 初始版本
+ *
+ * @par 作者
+ * - liyijie
+ */
+
+#ifndef __EC_BSP_AHT21_TRACE_H__
+#define __EC_BSP_AHT21_TRACE_H__
+
+#include "ec_bsp_aht21_config.h"
+
+#include <stdint.h>
+
+#define AHT21_TRACE_RING_SIZE        64    // 事件缓冲区大小 必须为2的幂
+#define AHT21_TRACE_HIST_SUB_BITS    2     // 每个2的幂区间再细分为2^N个桶
+#define AHT21_TRACE_HIST_BUCKETS     (32U << AHT21_TRACE_HIST_SUB_BITS)
+
+//追踪阶段
+typedef enum
+{
+	AHT21_TRACE_PHASE_TRIGGER = 0,   // 写测量命令
+	AHT21_TRACE_PHASE_WAIT,          // 触发完成到读取有效帧
+	AHT21_TRACE_PHASE_READ,          // 读测量帧(含CRC校验与重读)
+	AHT21_TRACE_PHASE_DECODE,        // 帧解码
+	AHT21_TRACE_PHASE_INIT,          // aht21_init整体
+	AHT21_TRACE_PHASE_NUM,
+}aht21_trace_phase_t;
+
+//追踪事件
+typedef struct
+{
+	uint32_t timestamp;              // 阶段开始时刻(时钟计数)
+	uint32_t cycles;                 // 阶段耗时(时钟计数)
+	uint16_t seq;                    // 事件序号 不连续表示有丢弃
+	uint8_t  phase;                  // aht21_trace_phase_t
+	uint8_t  dev_addr;               // 传感器地址
+	int8_t   code;                   // 阶段结果码
+}aht21_trace_event_t;
+
+//单个阶段的统计
+typedef struct
+{
+	uint32_t count;
+	uint32_t min;
+	uint32_t max;
+	uint64_t sum;
+	uint32_t hist[AHT21_TRACE_HIST_BUCKETS];
+}aht21_trace_phase_stats_t;
+
+//全部阶段的统计 由消费者持有
+typedef struct
+{
+	aht21_trace_phase_stats_t phase[AHT21_TRACE_PHASE_NUM];
+}aht21_trace_stats_t;
+
+//统计摘要
+typedef struct
+{
+	uint32_t count;
+	uint32_t min;
+	uint32_t avg;
+	uint32_t max;
+	uint32_t p99;                    // 桶上界
+}aht21_trace_summary_t;
+
+/**
+ * @brief 初始化追踪 清空缓冲区
+ *
+ * @param pfclock   时钟函数 NULL时使用DWT->CYCCNT(仅目标板)
+ * @param clock_hz  时钟频率 用于换算微秒
+ */
+void aht21_trace_init(uint32_t (*pfclock)(void), uint32_t clock_hz);
+
+/**
+ * @brief 当前时钟计数
+ */
+uint32_t aht21_trace_now(void);
+
+/**
+ * @brief 写入一条事件(生产者)
+ *
+ * @param dev_addr  传感器地址
+ * @param phase     阶段
+ * @param start     阶段开始时刻 aht21_trace_now的返回值
+ * @param end       阶段结束时刻
+ * @param code      阶段结果码
+ */
+void aht21_trace_record(uint8_t dev_addr, aht21_trace_phase_t phase, uint32_t start, uint32_t end, int8_t code);
+
+/**
+ * @brief 取出全部事件(消费者)
+ *
+ * @param stats   累计统计 可为NULL
+ * @param pfsink  每条事件的输出回调(如串口打印) 可为NULL
+ * @return 本次取出的事件数
+ */
+uint32_t aht21_trace_drain(aht21_trace_stats_t *stats, void (*pfsink)(const aht21_trace_event_t *event));
+
+/**
+ * @brief 缓冲区满被丢弃的事件数
+ */
+uint32_t aht21_trace_dropped(void);
+
+/**
+ * @brief 清空统计
+ */
+void aht21_trace_stats_reset(aht21_trace_stats_t *stats);
+
+/**
+ * @brief 计算某阶段的min/avg/max/p99 单位为时钟计数
+ */
+void aht21_trace_summary(const aht21_trace_stats_t *stats, aht21_trace_phase_t phase,
+                         aht21_trace_summary_t *summary);
+
+/**
+ * @brief 时钟计数换算为微秒
+ */
+uint32_t aht21_trace_to_us(uint32_t cycles);
+
+/*
+ * 驱动内部追踪点 AHT21_CFG_TRACE为0时展开为空
+ */
+#if AHT21_CFG_TRACE
+#define AHT21_TRACE_BEGIN(var)                         uint32_t var = aht21_trace_now()
+#define AHT21_TRACE_STAMP(lvalue)                      ((lvalue) = aht21_trace_now())
+#define AHT21_TRACE_END(inst, phase, start, code)      \
+        aht21_trace_record((inst)->dev_addr, (phase), (start), aht21_trace_now(), (int8_t)(code))
+#define AHT21_TRACE_SPAN(inst, phase, start, end, code) \
+        aht21_trace_record((inst)->dev_addr, (phase), (start), (end), (int8_t)(code))
+#else
+#define AHT21_TRACE_BEGIN(var)                         do {} while (0)
+#define AHT21_TRACE_STAMP(lvalue)                      do {} while (0)
+#define AHT21_TRACE_END(inst, phase, start, code)      do {} while (0)
+#define AHT21_TRACE_SPAN(inst, phase, start, end, code) do {} while (0)
+#endif
+
+#endif //__EC_BSP_AHT21_TRACE_H__
@@ -0,0 +1,57 @@
+/**
+ * @file ec_bsp_aht21_wait.h
+ * @brief AHT21 驱动等待接口的目标板实现头文件
+ *
+ * 驱动通过system_timebase_interface_t::pfwait_until睡眠到绝对时刻，
+ * 本文件提供三种实现：
+ * - aht21_wait_until_rtos        : FreeRTOS vTaskDelayUntil 不占用任务通知
+ * - aht21_wait_until_rtos_notify : FreeRTOS ulTaskNotifyTake带超时 其他任务可
+ *                                  通过xTaskNotifyGive提前唤醒(如中止测量)
+ * - aht21_wait_until_wfi         : 裸机 WFI等待SysTick等中断
+ * 主机仿真使用ec_bsp_aht21_sim.h中的aht21_sim_wait_until。
+ *
+ * @version 1.0
+ * @date 2024-07-12
+ *
+ * @note
+ * - deadline_tick与timebase->mcu_get_systick_count同一时基(毫秒)，
+ *   换算为RTOS节拍时向上取整，保证不提前醒来读到busy帧。
+ * - 调度器未运行时FreeRTOS实现退化为WFI等待。
+ * - 实现不带上下文参数，同一时间只绑定一个时基。
+ *
+ * @par 依赖项
+ * - ec_bsp_aht21_driver.h
+ * - FreeRTOS.h task.h
+ *
+ * @par 版本历史
+ * - 1.0 初始版本
+ *
+ * @par 作者
+ * - liyijie
+ */
+
+#ifndef __EC_BSP_AHT21_WAIT_H__
+#define __EC_BSP_AHT21_WAIT_H__
+
+#include "ec_bsp_aht21_driver.h"
+
+#include <stdint.h>
+
+/**
+ * 绑定时基 并将pfwait_until填入时基接口表
+ */
+int8_t aht21_wait_attach(system_timebase_interface_t *timebase, aht21_wait_until_t pfwait_until);
+/**
+ * FreeRTOS 延时到绝对时刻
+ */
+void aht21_wait_until_rtos(uint32_t deadline_tick);
+/**
+ * FreeRTOS 等待任务通知 超时为到绝对时刻的剩余时间
+ */
+void aht21_wait_until_rtos_notify(uint32_t deadline_tick);
+/**
+ * 裸机 WFI直到绝对时刻
+ */
+void aht21_wait_until_wfi(uint32_t deadline_tick);
+
+#endif //__EC_BSP_AHT21_WAIT_H__
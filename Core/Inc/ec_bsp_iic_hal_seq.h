@@ -0,0 +1,63 @@
+/**
+ * @file ec_bsp_iic_hal_seq.h
+ * @brief 基于HAL顺序传输+DMA的IIC事务后端头文件
+ *
+ * 使用HAL_I2C_Master_Seq_Transmit_DMA/HAL_I2C_Master_Seq_Receive_DMA实现
+ * iic_driver_interface_t::pfTransfer，一个iic_transaction_t的全部段由硬件IIC
+ * 连续完成，不再逐字节经过函数指针。
+ *
+ * @version 1.0
+ * @date 2024-06-28
+ *
+ * @note
+ * - hi2c需已由CubeMX初始化，并为Tx/Rx配置好DMA通道和I2C事件/错误中断。
+ * - 默认由本文件实现HAL_I2C_MasterTxCpltCallback等回调；应用自己实现这些回调时
+ *   定义IIC_HAL_SEQ_DEFINE_CALLBACKS为0，并在回调中调用iic_hal_seq_on_complete/
+ *   iic_hal_seq_on_error。
+ * - pfTransfer不带上下文参数，本后端同一时间只绑定一个IIC外设。
+ * - 调度器运行时传输任务阻塞在二值信号量上等待每一段完成，由上述回调释放；
+ *   调度器启动前以WFI等待。
+ *
+ * @par 依赖项
+ * - stm32f4xx_hal.h
+ * - ec_bsp_aht21_driver.h : iic_driver_interface_t与事务描述定义。
+ *
+ * @par 版本历史
+ * - 1.0 初始版本
+ *
+ * @par 作者
+ * - liyijie
+ */
+
+#ifndef __EC_BSP_IIC_HAL_SEQ_H__
+#define __EC_BSP_IIC_HAL_SEQ_H__
+
+#include "stm32f4xx_hal.h"
+#include "ec_bsp_aht21_driver.h"
+
+#include <stdint.h>
+
+#ifndef IIC_HAL_SEQ_DEFINE_CALLBACKS
+#define IIC_HAL_SEQ_DEFINE_CALLBACKS 1
+#endif
+
+#define IIC_HAL_SEQ_TIMEOUT_MS       10    // 单段传输超时
+
+/**
+ * 绑定IIC外设 并填充接口表的pfInit/pfDeInit/pfTransfer/pfBusRecover
+ */
+int8_t iic_hal_seq_attach(I2C_HandleTypeDef *hi2c, iic_driver_interface_t *iic_instance);
+/**
+ * 执行一个IIC事务
+ */
+int8_t iic_hal_seq_transfer(const iic_transaction_t *xfer);
+/**
+ * 传输完成通知(HAL回调中调用)
+ */
+void iic_hal_seq_on_complete(I2C_HandleTypeDef *hi2c);
+/**
+ * 传输错误通知(HAL回调中调用)
+ */
+void iic_hal_seq_on_error(I2C_HandleTypeDef *hi2c);
+
+#endif //__EC_BSP_IIC_HAL_SEQ_H__
@@ -0,0 +1,51 @@
+/**
+ * @file ec_bsp_iic_recovery.h
+ * @brief IIC总线解锁(SCL九时钟)头文件
+ *
+ * 从机在读字节中途被复位或主机中断时可能一直拉低SDA，之后任何起始信号都
+ * 无法产生。按NXP UM10204 3.1.16的方法，主机以GPIO方式在SCL上最多输出9个
+ * 时钟，直到从机释放SDA，再发出停止信号使总线回到空闲。
+ *
+ * iic_bus_unjam只依赖iic_unjam_ops_t提供的引脚操作，可用于软件IIC和硬件IIC
+ * (需先把引脚切换为开漏GPIO)。驱动通过iic_driver_interface_t::pfBusRecover调用。
+ *
+ * @version 1.0
+ * @date 2024-07-04
+ *
+ * @par 依赖项
+ * - stdint.h
+ *
+ * @par 版本历史
+ * - 1.0 初始版本
+ *
+ * @par 作者
+ * - liyijie
+ */
+
+#ifndef __EC_BSP_IIC_RECOVERY_H__
+#define __EC_BSP_IIC_RECOVERY_H__
+
+#include <stdint.h>
+
+#define IIC_UNJAM_CLOCKS             9     // 最多输出的SCL时钟数
+#define IIC_UNJAM_HALF_PERIOD_US     5     // 半周期 约100kHz
+
+//引脚操作 引脚需为开漏输出 写1即释放
+typedef struct
+{
+	void    (*pfScl)(uint8_t level);         // 设置SCL电平
+	void    (*pfSda)(uint8_t level);         // 设置SDA电平
+	uint8_t (*pfSdaRead)(void);              // 读取SDA电平
+	void    (*pfDelayUs)(uint32_t us);       // 微秒延时
+}iic_unjam_ops_t;
+
+/**
+ * @brief 解锁IIC总线
+ *
+ * @param ops 引脚操作
+ * @return 0 SDA已释放且已发出停止信号
+ *         -1 参数错误或9个时钟后SDA仍为低
+ */
+int8_t iic_bus_unjam(const iic_unjam_ops_t *ops);
+
+#endif //__EC_BSP_IIC_RECOVERY_H__
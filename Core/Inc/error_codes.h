@@ -17,9 +17,15 @@ typedef enum
     RET_CODE_XSEMAPHORETAKE_FAIL = -10,             // xSemaphoreTake fail
     RET_CODE_XTASKCREATE_FAIL = -11,                // 任务创建失败
     RET_CODE_NO_RIGHT_DATA = -12,                  // 没有符合条件数据
-    RET_CODE_ERROR_PARAM_NULL = -13,                // 参数空指针
-    RET_CODE_ERROR_PARAM_NULL = -14,                // 参数空指针
-    RET_CODE_ERROR_PARAM_NULL = -15,                // 参数空指针
+    RET_CODE_AHT21_BUSY = -13,                      // 转换未完成
+    RET_CODE_AHT21_STATE_ERROR = -14,               // 测量状态错误
+    RET_CODE_AHT21_IIC_FAIL = -15,                  // IIC通信失败
+    RET_CODE_AHT21_TIMEOUT = -16,                   // 转换超时
+    RET_CODE_AHT21_CRC_FAIL = -17,                  // CRC校验失败
+    RET_CODE_AHT21_IIC_TIMEOUT = -18,               // IIC事务超时
+    RET_CODE_AHT21_PENDING = -19,                   // 请求已排队 转换完成后回调
+    RET_CODE_AHT21_SUB_FULL = -20,                  // 订阅表已满
+    RET_CODE_AHT21_DEADLINE = -21,                  // 无法在请求时限内完成
 
 } ret_code_t;
 
@@ -0,0 +1,320 @@
+/**
+ * @file ec_bsp_aht21_bus.c
+ * @brief 多AHT21总线管理源文件
+ *
+ * 这个文件实现经TCA9548类mux挂载的多个AHT21传感器的批量触发与收集。
+ *
+ * @version 1.0
+ * @date 2024-06-20
+ *
+ * @par 依赖项
+ * - ec_bsp_aht21_bus.h
+ *
+ * @par 版本历史
+ * - 1.0 初始版本
+ * - 1.1 mux写入检查返回值 经驱动的重试与恢复流程
+ *
+ * @par 作者
+ * - liyijie
+ */
+
+#include "ec_bsp_aht21_bus.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief  写mux通道寄存器
+ *
+ * 经aht21_iic_transfer执行,失败时按驱动的流程退避重试并解锁总线。
+ *
+ * @param  mux           mux实例
+ * @param  channel_mask  通道掩码 bit n对应通道n
+ * @return 0 success
+ *         RET_CODE_AHT21_IIC_FAIL    无应答
+ *         RET_CODE_AHT21_IIC_TIMEOUT 事务超时
+ */
+static int8_t aht21_bus_mux_write(aht21_iic_mux_t *mux, uint8_t channel_mask)
+{
+    int8_t code = aht21_iic_transfer(mux->aht21_instance, mux->addr, &channel_mask, 1, false);
+    if (code == RET_CODE_SUCCESS)
+    {
+        mux->channel_mask = channel_mask;
+    }
+    return code;
+}
+
+/**
+ * @brief  选中节点所在通道 必要时关闭上一个mux
+ *
+ * @param  bus   总线管理器
+ * @param  node  目标节点
+ * @return 0 success
+ *         其他 mux写入失败的结果码
+ */
+static int8_t aht21_bus_select(bsp_aht21_bus_t *bus, aht21_bus_node_t *node)
+{
+    int8_t code = RET_CODE_SUCCESS;
+    // 切换mux前关闭上一个mux 防止两个通道上的0x38同时出现在总线上
+    if (bus->active_mux != NULL && bus->active_mux != node->mux)
+    {
+        code = aht21_bus_mux_write(bus->active_mux, AHT21_BUS_MUX_CHANNEL_NONE);
+        if (code != RET_CODE_SUCCESS)
+        {
+            return code;
+        }
+        bus->active_mux = NULL;
+    }
+    if (node->mux == NULL)
+    {
+        // 直连节点
+        return RET_CODE_SUCCESS;
+    }
+    uint8_t mask = (uint8_t)(1U << node->channel);
+    if (node->mux->channel_mask != mask)
+    {
+        code = aht21_bus_mux_write(node->mux, mask);
+        if (code != RET_CODE_SUCCESS)
+        {
+            return code;
+        }
+    }
+    bus->active_mux = node->mux;
+    return RET_CODE_SUCCESS;
+}
+
+/**
+ * @brief  初始化mux描述
+ *
+ * @param  mux           mux实例
+ * @param  iic_instance  mux所在IIC总线
+ * @param  addr          mux 7位地址
+ * @return 0 success
+ */
+int8_t aht21_bus_mux_inst(aht21_iic_mux_t *mux, iic_driver_interface_t *iic_instance, uint8_t addr)
+{
+    if (mux == NULL)
+    {
+        return RET_CODE_ERROR_PARAM_NULL;
+    }
+    if (iic_instance == NULL)
+    {
+        return RET_CODE_ERROR_IIC_INSTANCE_NULL;
+    }
+    mux->iic_driver_interface = iic_instance;
+    mux->addr = addr;
+    // 上电状态未知 置为无效掩码 保证第一次选择时一定写入
+    mux->channel_mask = 0xFF;
+    mux->aht21_instance = NULL;
+    return RET_CODE_SUCCESS;
+}
+
+/**
+ * @brief  构造总线管理器
+ *
+ * @param  bus       总线管理器
+ * @param  nodes     节点数组 由调用者分配
+ * @param  capacity  节点数组容量
+ * @return 0 success
+ */
+int8_t aht21_bus_inst(bsp_aht21_bus_t *bus, aht21_bus_node_t *nodes, uint8_t capacity)
+{
+    if (bus == NULL || nodes == NULL || capacity == 0)
+    {
+        return RET_CODE_ERROR_PARAM_NULL;
+    }
+    bus->nodes = nodes;
+    bus->capacity = capacity;
+    bus->count = 0;
+    bus->active_mux = NULL;
+    return RET_CODE_SUCCESS;
+}
+
+/**
+ * @brief  添加传感器节点
+ *
+ * @param  bus             总线管理器
+ * @param  aht21_instance  已构造的传感器实例 每个节点一个独立实例
+ * @param  mux             所在mux NULL表示直连
+ * @param  channel         mux通道号
+ * @return >=0 节点序号
+ *         RET_CODE_ERROR_PARAM_NULL 参数错误、节点数组已满或实例与mux不在同一总线
+ */
+int8_t aht21_bus_add(bsp_aht21_bus_t *bus, bsp_aht21_t *aht21_instance, aht21_iic_mux_t *mux, uint8_t channel)
+{
+    if (bus == NULL || bus->nodes == NULL)
+    {
+        return RET_CODE_ERROR_PARAM_NULL;
+    }
+    if (aht21_instance == NULL)
+    {
+        return RET_CODE_ERROR_AHT21_INSTANCE_NULL;
+    }
+    if (bus->count >= bus->capacity ||
+        (mux != NULL && channel >= AHT21_BUS_MUX_CHANNEL_NUM))
+    {
+        return RET_CODE_ERROR_PARAM_NULL;
+    }
+#if !AHT21_CFG_STATIC_DISPATCH
+    // mux事务借用节点实例的IIC接口 二者须在同一总线
+    if (mux != NULL && aht21_instance->iic_driver_interface_t != mux->iic_driver_interface)
+    {
+        return RET_CODE_ERROR_PARAM_NULL;
+    }
+#endif
+    if (mux != NULL && mux->aht21_instance == NULL)
+    {
+        mux->aht21_instance = aht21_instance;
+    }
+    aht21_bus_node_t *node = &bus->nodes[bus->count];
+    node->aht21_instance = aht21_instance;
+    node->mux = mux;
+    node->channel = channel;
+    node->code = RET_CODE_AHT21_STATE_ERROR;
+    node->temp = 0.0f;
+    node->humi = 0.0f;
+    node->health = AHT21_HEALTH_UNKNOWN;
+    return (int8_t)(bus->count++);
+}
+
+/**
+ * @brief  依次触发全部传感器测量 不等待转换
+ *
+ * @param  bus  总线管理器
+ * @return 0 全部触发成功
+ *         其他 第一个失败节点的结果码 各节点结果见node->code
+ */
+int8_t aht21_bus_trigger_all(bsp_aht21_bus_t *bus)
+{
+    if (bus == NULL || bus->nodes == NULL)
+    {
+        return RET_CODE_ERROR_PARAM_NULL;
+    }
+    int8_t first_error = RET_CODE_SUCCESS;
+    for (uint8_t i = 0; i < bus->count; i++)
+    {
+        aht21_bus_node_t *node = &bus->nodes[i];
+        node->code = aht21_bus_select(bus, node);
+        if (node->code == RET_CODE_SUCCESS)
+        {
+            node->code = aht21_start(node->aht21_instance);
+        }
+        if (node->code == RET_CODE_SUCCESS)
+        {
+            // 已触发 等待收集
+            node->code = RET_CODE_AHT21_BUSY;
+        }
+        else if (first_error == RET_CODE_SUCCESS)
+        {
+            first_error = node->code;
+        }
+    }
+    return first_error;
+}
+
+/**
+ * @brief  记录未完成节点 保留最早的查询时刻
+ *
+ * @param  pending         已记录的未完成实例 NULL表示尚无
+ * @param  wake            最早的查询时刻
+ * @param  aht21_instance  未完成的实例
+ */
+static void aht21_bus_pending(bsp_aht21_t **pending, uint32_t *wake, bsp_aht21_t *aht21_instance)
+{
+    if (*pending == NULL || !AHT21_TICK_REACHED(aht21_instance->meas_deadline, *wake))
+    {
+        *wake = aht21_instance->meas_deadline;
+    }
+    *pending = aht21_instance;
+}
+
+/**
+ * @brief  收集全部已触发传感器的结果
+ *
+ * 每一轮扫描对所有未完成节点查询一次,全部未完成时睡眠到最早的查询时刻。
+ *
+ * @param  bus  总线管理器
+ * @return 0 全部成功
+ *         其他 第一个失败节点的结果码 各节点结果见node->code
+ */
+int8_t aht21_bus_collect_all(bsp_aht21_bus_t *bus)
+{
+    if (bus == NULL || bus->nodes == NULL)
+    {
+        return RET_CODE_ERROR_PARAM_NULL;
+    }
+    bsp_aht21_t *pending;
+    uint32_t wake = 0;
+    do
+    {
+        pending = NULL;
+        for (uint8_t i = 0; i < bus->count; i++)
+        {
+            aht21_bus_node_t *node = &bus->nodes[i];
+            if (node->code != RET_CODE_AHT21_BUSY)
+            {
+                continue;
+            }
+            bsp_aht21_t *aht21_instance = node->aht21_instance;
+            // 未到查询时刻的节点不访问总线 也不切换通道
+            if (aht21_instance->meas_state == AHT21_MEAS_STATE_CONVERTING &&
+                !AHT21_TICK_REACHED(AHT21_GET_TICK(aht21_instance),
+                                    aht21_instance->meas_deadline))
+            {
+                aht21_bus_pending(&pending, &wake, aht21_instance);
+                continue;
+            }
+            // 自适应模式下poll_ready会读状态字节 须先切到该节点通道
+            node->code = aht21_bus_select(bus, node);
+            if (node->code == RET_CODE_SUCCESS)
+            {
+                node->code = aht21_poll_ready(aht21_instance);
+            }
+            if (node->code == RET_CODE_SUCCESS)
+            {
+                node->code = aht21_fetch(aht21_instance, &node->temp, &node->humi);
+            }
+#if AHT21_CFG_HEALTH
+            node->health = aht21_instance->health.state;
+#endif
+            if (node->code == RET_CODE_AHT21_BUSY)
+            {
+                aht21_bus_pending(&pending, &wake, aht21_instance);
+            }
+        }
+        if (pending != NULL)
+        {
+            // 还有传感器在转换 睡眠到最早的查询时刻
+            aht21_wait_until(pending, wake);
+        }
+    } while (pending != NULL);
+
+    for (uint8_t i = 0; i < bus->count; i++)
+    {
+        if (bus->nodes[i].code != RET_CODE_SUCCESS)
+        {
+            return bus->nodes[i].code;
+        }
+    }
+    return RET_CODE_SUCCESS;
+}
+
+/**
+ * @brief  触发并收集全部传感器 总耗时约为一次转换时间
+ *
+ * @param  bus  总线管理器
+ * @return 0 全部成功
+ *         其他 第一个失败节点的结果码 各节点结果见node->code
+ */
+int8_t aht21_bus_sample_all(bsp_aht21_bus_t *bus)
+{
+    int8_t trigger_code = aht21_bus_trigger_all(bus);
+    if (trigger_code == RET_CODE_ERROR_PARAM_NULL)
+    {
+        return trigger_code;
+    }
+    // 部分节点触发失败时仍收集其余节点
+    int8_t collect_code = aht21_bus_collect_all(bus);
+    return (trigger_code != RET_CODE_SUCCESS) ? trigger_code : collect_code;
+}
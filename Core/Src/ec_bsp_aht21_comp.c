@@ -0,0 +1,324 @@
+/******************************************************************************
+ * Copyright (C) 2024 EternalChip, Inc.(Gmbh) or its affiliates.
+ *
+ * All Rights Reserved.
+ *
+ * File name: ec_bsp_aht21_comp.c
+ *
+ * Description: Calibration and derived quantities for AHT21 readings.
+ *
+ * Processing flow:
+ *
+ * call directly, or through aht21_fetch_comp in the driver.
+ *
+ *
+ * Version: V1.0
+ *
+ * Modifications:
+ *
+ *
+ * Note: 1 tab == 4 spaces!
+ *
+ *****************************************************************************/
+
+#include "ec_bsp_aht21_comp.h"
+
+#include <stddef.h>
+
+#define AHT21_COMP_MAGNUS_B_Q16  1154744  // 17.62 Q16
+#define AHT21_COMP_MAGNUS_C      24312    // 243.12摄氏度 0.01单位
+#define AHT21_COMP_LN2_Q16       45426    // ln(2) Q16
+#define AHT21_COMP_LOG2E_Q16     94548    // log2(e) Q16
+#define AHT21_COMP_LN10000_Q16   603609   // ln(10000) Q16
+#define AHT21_COMP_AH_K          132472   // 6.112*2.1674*10000
+#define AHT21_COMP_TEMP_MIN      (-5000)  // 公式输入范围 与原始码满量程一致
+#define AHT21_COMP_TEMP_MAX      15000
+
+/*
+ * ln(1 + i/32) Q16 i=0..32
+ */
+static const uint16_t s_aht21_comp_ln_table[33] =
+{
+    0, 2017, 3973, 5873, 7719, 9515, 11262, 12965, 14624, 16242, 17821,
+    19364, 20870, 22343, 23783, 25193, 26573, 27924, 29248, 30546, 31818,
+    33067, 34292, 35494, 36675, 37835, 38975, 40095, 41196, 42280, 43345,
+    44394, 45426,
+};
+
+/*
+ * 2^(i/32) Q16 i=0..32
+ */
+static const uint32_t s_aht21_comp_exp2_table[33] =
+{
+    65536, 66971, 68438, 69936, 71468, 73032, 74632, 76266, 77936, 79642,
+    81386, 83169, 84990, 86851, 88752, 90696, 92682, 94711, 96785, 98905,
+    101070, 103283, 105545, 107856, 110218, 112631, 115098, 117618, 120194,
+    122825, 125515, 128263, 131072,
+};
+
+/**
+ * @brief 最高置位位置 x不为0
+ */
+static int32_t aht21_comp_msb(uint32_t x)
+{
+    int32_t n = 0;
+    if (x & 0xFFFF0000U) { n += 16; x >>= 16; }
+    if (x & 0x0000FF00U) { n += 8;  x >>= 8; }
+    if (x & 0x000000F0U) { n += 4;  x >>= 4; }
+    if (x & 0x0000000CU) { n += 2;  x >>= 2; }
+    if (x & 0x00000002U) { n += 1; }
+    return n;
+}
+
+/**
+ * @brief 整数平方根 floor(sqrt(x))
+ */
+static uint32_t aht21_comp_isqrt(uint32_t x)
+{
+    uint32_t res = 0;
+    uint32_t bit = 1UL << 30;
+    while (bit > x)
+    {
+        bit >>= 2;
+    }
+    while (bit != 0)
+    {
+        if (x >= res + bit)
+        {
+            x -= res + bit;
+            res = (res >> 1) + bit;
+        }
+        else
+        {
+            res >>= 1;
+        }
+        bit >>= 2;
+    }
+    return res;
+}
+
+/**
+ * @brief 自然对数 ln(x) x为Q16 且大于0 结果Q16
+ *
+ * x = m * 2^e, m∈[1,2) ln(x) = e*ln2 + ln(m) ln(m)查表线性插值 误差小于2e-4
+ */
+static int32_t aht21_comp_ln_q16(uint32_t x)
+{
+    int32_t e = aht21_comp_msb(x) - 16;
+    uint32_t m = (e >= 0) ? (x >> e) : (x << -e);
+    uint32_t frac = m - 65536U;
+    uint32_t idx = frac >> 11;
+    uint32_t rem = frac & 0x7FFU;
+    int32_t lo = s_aht21_comp_ln_table[idx];
+    int32_t hi = s_aht21_comp_ln_table[idx + 1];
+    return e * AHT21_COMP_LN2_Q16 + lo + (int32_t)(((hi - lo) * (int32_t)rem) >> 11);
+}
+
+/**
+ * @brief 指数 exp(y) y为Q16 结果Q16 溢出时饱和
+ *
+ * exp(y) = 2^(y*log2e) = 2^k * 2^f 2^f查表线性插值
+ */
+static uint32_t aht21_comp_exp_q16(int32_t y)
+{
+    int32_t z = (int32_t)(((int64_t)y * AHT21_COMP_LOG2E_Q16) / 65536);
+    int32_t f = z & 0xFFFF;
+    int32_t k = (z - f) / 65536;
+    if (k >= 14)
+    {
+        return 0xFFFFFFFFU;
+    }
+    if (k <= -18)
+    {
+        return 0;
+    }
+    uint32_t idx = (uint32_t)f >> 11;
+    uint32_t rem = (uint32_t)f & 0x7FFU;
+    uint32_t lo = s_aht21_comp_exp2_table[idx];
+    uint32_t hi = s_aht21_comp_exp2_table[idx + 1];
+    uint32_t v = lo + (((hi - lo) * rem) >> 11);
+    return (k >= 0) ? (v << k) : (v >> -k);
+}
+
+/**
+ * @brief Magnus公式指数项 b*T/(c+T) 结果Q16
+ */
+static int32_t aht21_comp_magnus(int32_t temp)
+{
+    if (temp < AHT21_COMP_TEMP_MIN)
+    {
+        temp = AHT21_COMP_TEMP_MIN;
+    }
+    if (temp > AHT21_COMP_TEMP_MAX)
+    {
+        temp = AHT21_COMP_TEMP_MAX;
+    }
+    return (int32_t)(((int64_t)AHT21_COMP_MAGNUS_B_Q16 * temp) / (AHT21_COMP_MAGNUS_C + temp));
+}
+
+/**
+ * @brief 限幅到int16
+ */
+static int16_t aht21_comp_sat16(int32_t v)
+{
+    if (v > INT16_MAX)
+    {
+        return INT16_MAX;
+    }
+    if (v < INT16_MIN)
+    {
+        return INT16_MIN;
+    }
+    return (int16_t)v;
+}
+
+/**
+ * @brief 填充默认校准参数(增益1 偏移0)
+ *
+ * @param calib 校准参数
+ */
+void aht21_comp_calib_default(aht21_calib_t *calib)
+{
+    if (calib == NULL)
+    {
+        return;
+    }
+    calib->temp_offset = 0;
+    calib->humi_offset = 0;
+    calib->temp_gain = AHT21_COMP_GAIN_ONE;
+    calib->humi_gain = AHT21_COMP_GAIN_ONE;
+}
+
+/**
+ * @brief 应用校准 湿度限制在0~100%RH
+ *
+ * @param calib     校准参数 NULL时不校准
+ * @param temp      温度输入(0.01摄氏度)
+ * @param humi      湿度输入(0.01%RH)
+ * @param temp_out  温度输出
+ * @param humi_out  湿度输出
+ */
+void aht21_comp_calibrate(const aht21_calib_t *calib, int16_t temp, uint16_t humi,
+                          int16_t *temp_out, uint16_t *humi_out)
+{
+    int32_t t = temp;
+    int32_t h = humi;
+    if (calib != NULL)
+    {
+        // 四舍五入 负数同样向最近值取整
+        t = ((t * calib->temp_gain + (1 << 13)) >> 14) + calib->temp_offset;
+        h = ((h * calib->humi_gain + (1 << 13)) >> 14) + calib->humi_offset;
+    }
+    if (h < 0)
+    {
+        h = 0;
+    }
+    if (h > 10000)
+    {
+        h = 10000;
+    }
+    *temp_out = aht21_comp_sat16(t);
+    *humi_out = (uint16_t)h;
+}
+
+/**
+ * @brief 露点 Magnus公式
+ *
+ * @param temp 温度(0.01摄氏度)
+ * @param humi 湿度(0.01%RH) 0按0.01%RH计算
+ * @return 露点(0.01摄氏度)
+ */
+int16_t aht21_comp_dew_point(int16_t temp, uint16_t humi)
+{
+    uint32_t h = (humi == 0) ? 1U : ((humi > 10000) ? 10000U : humi);
+    // ln(RH/100) = ln(h) - ln(10000)
+    int32_t gamma = aht21_comp_ln_q16(h << 16) - AHT21_COMP_LN10000_Q16 + aht21_comp_magnus(temp);
+    return aht21_comp_sat16((int32_t)(((int64_t)AHT21_COMP_MAGNUS_C * gamma) /
+                                      (AHT21_COMP_MAGNUS_B_Q16 - gamma)));
+}
+
+/**
+ * @brief 绝对湿度
+ *
+ * @param temp 温度(0.01摄氏度)
+ * @param humi 湿度(0.01%RH)
+ * @return 绝对湿度(0.01g/m3) 超出范围时饱和
+ */
+uint16_t aht21_comp_abs_humi(int16_t temp, uint16_t humi)
+{
+    int32_t t = (temp < AHT21_COMP_TEMP_MIN) ? AHT21_COMP_TEMP_MIN : temp;
+    uint32_t h = (humi > 10000) ? 10000U : humi;
+    uint64_t es = aht21_comp_exp_q16(aht21_comp_magnus(t));
+    // AH(0.01g/m3) = 1324.72 * exp(..) * RH(0.01%) / (T(0.01) + 27315)
+    uint64_t ah = (es * h * AHT21_COMP_AH_K) / ((uint64_t)(t + 27315) * 6553600U);
+    return (ah > 0xFFFFU) ? 0xFFFFU : (uint16_t)ah;
+}
+
+/**
+ * @brief 体感温度 NOAA算法 内部以0.01华氏度计算
+ *
+ * @param temp 温度(0.01摄氏度)
+ * @param humi 湿度(0.01%RH)
+ * @return 体感温度(0.01摄氏度)
+ */
+int16_t aht21_comp_heat_index(int16_t temp, uint16_t humi)
+{
+    int32_t t = (temp < AHT21_COMP_TEMP_MIN) ? AHT21_COMP_TEMP_MIN :
+                ((temp > AHT21_COMP_TEMP_MAX) ? AHT21_COMP_TEMP_MAX : temp);
+    int32_t tf = t * 9 / 5 + 3200;
+    int32_t rh = (humi > 10000) ? 10000 : humi;
+
+    // Steadman简化公式 0.5*(T + 61 + (T-68)*1.2 + RH*0.094)
+    int32_t hi = (tf + 6100 + (tf - 6800) * 6 / 5 + rh * 94 / 1000) / 2;
+    if ((hi + tf) / 2 >= 8000)
+    {
+        // Rothfusz回归 系数放大1e8 T/RH为0.01单位
+        int64_t t1 = tf;
+        int64_t r1 = rh;
+        int64_t t2 = t1 * t1;
+        int64_t r2 = r1 * r1;
+        int64_t acc = -4238
+                    + (204901523LL * t1) / 100000000LL
+                    + (1014333127LL * r1) / 100000000LL
+                    - (22475541LL * t1 * r1) / 10000000000LL
+                    - (683783LL * t2) / 10000000000LL
+                    - (5481717LL * r2) / 10000000000LL
+                    + (122874LL * t2 * r1) / 1000000000000LL
+                    + (85282LL * t1 * r2) / 1000000000000LL
+                    - (199LL * (t2 / 100) * (r2 / 100)) / 10000000000LL;
+        if (rh < 1300 && tf >= 8000 && tf <= 11200)
+        {
+            // 低湿修正 ((13-RH)/4)*sqrt((17-|T-95|)/17)
+            int32_t d = (tf > 9500) ? (tf - 9500) : (9500 - tf);
+            uint32_t s = aht21_comp_isqrt(((uint32_t)(1700 - d) << 16) / 1700U);
+            acc -= ((int64_t)(1300 - rh) * s) / 1024;
+        }
+        else if (rh > 8500 && tf >= 8000 && tf <= 8700)
+        {
+            // 高湿修正 ((RH-85)/10)*((87-T)/5)
+            acc += ((int64_t)(rh - 8500) * (8700 - tf)) / 5000;
+        }
+        hi = (int32_t)acc;
+    }
+    return aht21_comp_sat16((hi - 3200) * 5 / 9);
+}
+
+/**
+ * @brief 校准并计算全部派生量
+ *
+ * @param calib  校准参数 NULL时不校准
+ * @param temp   温度输入(0.01摄氏度)
+ * @param humi   湿度输入(0.01%RH)
+ * @param out    补偿结果
+ */
+void aht21_comp_process(const aht21_calib_t *calib, int16_t temp, uint16_t humi, aht21_comp_t *out)
+{
+    if (out == NULL)
+    {
+        return;
+    }
+    aht21_comp_calibrate(calib, temp, humi, &out->temp, &out->humi);
+    out->dew_point = aht21_comp_dew_point(out->temp, out->humi);
+    out->abs_humi = aht21_comp_abs_humi(out->temp, out->humi);
+    out->heat_index = aht21_comp_heat_index(out->temp, out->humi);
+}
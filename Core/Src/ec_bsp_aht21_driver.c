@@ -10,7 +10,7 @@
  *
  * @note
  * - 确保I2C库已经初始化并配置正确。
- * - 所有函数都假定传感器的I2C地址为0x38（默认地址）。
+ * - 传感器I2C地址保存在实例dev_addr中，默认0x38（AHT21_ADDR）。
  *
  * @par 依赖项
  * - i2c.h : 包含I2C通信函数的头文件。
@@ -23,10 +23,36 @@
  */
 
 #include "ec_bsp_aht21_driver.h"
+#ifdef USE_HAL_DRIVER
+#include "stm32f4xx_hal.h"
+#endif
 
 #include <stdio.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
+
+/*
+ * IIC初始化/逆初始化的分派
+ */
+#if AHT21_CFG_STATIC_DISPATCH
+#define AHT21_IIC_INIT(inst)         AHT21_CFG_IIC_INIT()
+#define AHT21_IIC_DEINIT(inst)       AHT21_CFG_IIC_DEINIT()
+#else
+#define AHT21_IIC_INIT(inst)         ((inst)->iic_driver_interface_t->pfInit())
+#define AHT21_IIC_DEINIT(inst)       ((inst)->iic_driver_interface_t->pfDeInit())
+#endif
+
+/*
+ * 测量结束时更新健康状态 关闭健康监测时不产生代码
+ */
+#if AHT21_CFG_HEALTH
+static void aht21_health_record(bsp_aht21_t *aht21_instance, int8_t code, const aht21_raw_data_t *raw);
+#define AHT21_HEALTH_RECORD(inst, code, raw) aht21_health_record((inst), (code), (raw))
+#else
+#define AHT21_HEALTH_RECORD(inst, code, raw) do { } while (0)
+#endif
+
 /**
  * @brief 构造AHT21传感器 对AHT21实例进行挂载和判空，并在必要时进行逆初始化。
  *
@@ -58,6 +84,7 @@ int8_t aht21_inst(bsp_aht21_t *aht21_instance, // AHT21的实体实例
     {
         return RET_CODE_ERROR_AHT21_INSTANCE_NULL;
     }
+#if !AHT21_CFG_STATIC_DISPATCH
     if (iic_instance == NULL)
     {
         return RET_CODE_ERROR_IIC_INSTANCE_NULL;
@@ -66,88 +93,394 @@ int8_t aht21_inst(bsp_aht21_t *aht21_instance, // AHT21的实体实例
     {
         return RET_CODE_ERROR_TIMEBASE_NULL;
     }
-    if (rtos_yeild == NULL)
+    // 时基提供pfwait_until时可不提供rtos_yeild
+    if (rtos_yeild == NULL && timebase->pfwait_until == NULL)
     {
         return RET_CODE_ERROR_RTOS_YEILD_NULL;
     }
-    // 一些全局变量声明
-    static iic_driver_interface_t iic_driver_interface = {NULL, NULL, NULL, NULL};
-    static bsp_aht21_t aht21_interface = {NULL, NULL, NULL, NULL, NULL, NULL};
-    static system_timebase_interface_t timebase_interface = {NULL};
-    static void *rtos_yeild_interface = NULL;
-    // 对iic实例进行判空和挂载
-    iic_driver_interface.pfDeInit = iic_instance->pfDeInit;
-    iic_driver_interface.pfReadReg = iic_instance->pfReadReg;
-    iic_driver_interface.pfWriteReg = iic_instance->pfWriteReg;
-    iic_driver_interface.pfInit = iic_instance->pfInit;
-    if (iic_driver_interface.pfDeInit == NULL ||
-        iic_driver_interface.pfInit == NULL ||
-        // iic_driver_interface.pfReadReg == NULL ||
-        // iic_driver_interface.pfWriteReg == NULL ||
-        iic_driver_interface.pfStart == NULL ||
-        iic_driver_interface.pfStop == NULL ||
-        iic_driver_interface.pfWaitAck == NULL ||
-        iic_driver_interface.pfSendByte == NULL ||
-        iic_driver_interface.pfReadByte == NULL
-    )
+    // 对iic实例进行判空 实例只保存接口指针 多个传感器可共享同一条总线
+    // 提供事务接口时可不提供字节级接口
+    if (iic_instance->pfDeInit == NULL ||
+        iic_instance->pfInit == NULL ||
+        (iic_instance->pfTransfer == NULL &&
+         (iic_instance->pfStart == NULL ||
+          iic_instance->pfStop == NULL ||
+          iic_instance->pfWaitAck == NULL ||
+          iic_instance->pfSendByte == NULL ||
+          iic_instance->pfReadByte == NULL ||
+          iic_instance->pfSendAck == NULL ||
+          iic_instance->pfSendNack == NULL)))
     {
         // 解构
         aht21_deInst(aht21_instance);
         return RET_CODE_ERROR_PARAM_NULL;
     }
-
     // IIC挂载
-    aht21_instance->iic_driver_interface_t->pfDeInit = iic_instance->pfDeInit;
-    // aht21_instance->iic_driver_interface_t->pfReadReg = iic_instance->pfReadReg;
-    // aht21_instance->iic_driver_interface_t->pfWriteReg = iic_instance->pfWriteReg;
-    aht21_instance->iic_driver_interface_t->pfInit = iic_instance->pfInit;
-    aht21_instance->iic_driver_interface_t->pfStart = iic_instance->pfStart;
-    aht21_instance->iic_driver_interface_t->pfStop = iic_instance->pfStop;
-    aht21_instance->iic_driver_interface_t->pfWaitAck = iic_instance->pfWaitAck;
-    aht21_instance->iic_driver_interface_t->pfSendByte = iic_instance->pfSendByte;
-    aht21_instance->iic_driver_interface_t->pfReadByte = iic_instance->pfReadByte;
-    aht21_instance->iic_driver_interface_t->pfSendAck = iic_instance->pfSendAck;
-    aht21_instance->iic_driver_interface_t->pfSendNack = iic_instance->pfSendNack;
+    aht21_instance->iic_driver_interface_t = iic_instance;
 
     // 对时基单元进行判空和挂载
-    timebase_interface.mcu_get_systick_count = timebase->mcu_get_systick_count;
-    if (timebase_interface.mcu_get_systick_count == NULL)
+    if (timebase->mcu_get_systick_count == NULL)
     {
         // 解构
         aht21_deInst(aht21_instance);
         return RET_CODE_ERROR_TIMEBASE_NULL;
     }
     aht21_instance->pftimebase_interface = timebase;
-    // 对rtos_yeild进行挂载和判空
-    rtos_yeild_interface = rtos_yeild;
-    if (rtos_yeild_interface == NULL)
+    // 对rtos_yeild进行挂载
+    aht21_instance->pfyield = (int8_t (*)(bsp_aht21_t *))rtos_yeild;
+#else
+    // 静态分派 接口在编译期绑定 不保存接口指针
+    (void)iic_instance;
+    (void)timebase;
+    (void)rtos_yeild;
+    aht21_instance->iic_driver_interface_t = NULL;
+    aht21_instance->pftimebase_interface = NULL;
+    aht21_instance->pfyield = NULL;
+#endif
+    // 默认地址 挂在mux后的传感器地址相同 由总线管理器切换通道
+    aht21_instance->dev_addr = AHT21_ADDR;
+    if (AHT21_ADDR != aht21_read_id(aht21_instance))
     {
-        // 解构
         aht21_deInst(aht21_instance);
-        return RET_CODE_ERROR_RTOS_YEILD_NULL;
+        return RET_CODE_ERROR_TEPM_HUMI_MODLE_ADDR_ERROT;
     }
-    aht21_instance->pfyield = rtos_yeild;
-    // AHT21实例方法判空与挂载
+#if AHT21_CFG_METHOD_TABLE
+    // AHT21实例方法挂载
+    aht21_instance->pfInst = aht21_inst;
     aht21_instance->pfinit = aht21_init;
     aht21_instance->pfaht21_read_id = aht21_read_id;
     aht21_instance->pfdeInit = aht21_deInit;
-    if (0x38 != aht21_read_id(aht21_instance))
+    aht21_instance->pfaht21_read_data = aht21_read_data;
+    aht21_instance->pfstartMeasurement = aht21_start;
+    aht21_instance->pfpoll_ready = aht21_poll_ready;
+    aht21_instance->pffetch = aht21_fetch;
+    aht21_instance->pfread_burst = aht21_read_burst;
+    aht21_instance->pfsleep = aht21_sleep;
+    aht21_instance->pfwakeup = aht21_wakeup;
+    aht21_instance->pfsoftReset = aht21_softReset;
+#endif
+    aht21_instance->meas_state = AHT21_MEAS_STATE_IDLE;
+    aht21_instance->wait_mode = AHT21_WAIT_MODE_FIXED;
+    aht21_instance->poll_backoff_init_ms = AHT21_POLL_BACKOFF_INIT_MS;
+    aht21_instance->poll_backoff_max_ms = AHT21_POLL_BACKOFF_MAX_MS;
+    aht21_instance->poll_backoff_ms = AHT21_POLL_BACKOFF_INIT_MS;
+    memset(&aht21_instance->conv_stats, 0, sizeof(aht21_instance->conv_stats));
+    aht21_instance->crc_enable = false;
+    aht21_instance->crc_retry_max = AHT21_CRC_RETRY_DEFAULT;
+    aht21_instance->crc_fail_count = 0;
+    aht21_instance->crc_reject_count = 0;
+    aht21_instance->pfcrc8 = NULL;
+    aht21_instance->sleeping = false;
+    aht21_instance->wake_deadline = 0;
+    aht21_instance->pfpower = NULL;
+    memset(&aht21_instance->fault_stats, 0, sizeof(aht21_instance->fault_stats));
+    aht21_comp_calib_default(&aht21_instance->calib);
+#if AHT21_CFG_HEALTH
+    aht21_health_reset(&aht21_instance->health, NULL);
+#endif
+    // 挂载成功
+    return RET_CODE_SUCCESS;
+}
+
+/**
+ * @brief  睡眠到绝对时刻
+ *
+ * 优先调用时基的pfwait_until让任务睡眠到deadline,未提供时循环调用pfyield。
+ * 等待函数提前返回(如被通知唤醒)时重新检查时刻并继续等待。
+ *
+ * @param  aht21_instance  aht21实例
+ * @param  deadline_tick   绝对时刻
+ */
+void aht21_wait_until(bsp_aht21_t *aht21_instance, uint32_t deadline_tick)
+{
+    while (!AHT21_TICK_REACHED(AHT21_GET_TICK(aht21_instance), deadline_tick))
     {
-        aht21_deInst(aht21_instance);
-        return RET_CODE_ERROR_TEPM_HUMI_MODLE_ADDR_ERROT;
+#if AHT21_CFG_STATIC_DISPATCH
+#ifdef AHT21_CFG_WAIT_UNTIL
+        AHT21_CFG_WAIT_UNTIL(deadline_tick);
+#else
+        (void)AHT21_CFG_YIELD();
+#endif
+#else
+        if (aht21_instance->pftimebase_interface->pfwait_until != NULL)
+        {
+            aht21_instance->pftimebase_interface->pfwait_until(deadline_tick);
+        }
+        else
+        {
+            aht21_instance->pfyield(aht21_instance);
+        }
+#endif
     }
-    aht21_instance->pfaht21_read_data = aht21_read_data;
-    // 进行判空
-    if (aht21_instance->pfdeInit == NULL ||
-        aht21_instance->pfinit == NULL ||
-        aht21_instance->pfaht21_read_id == NULL ||
-        aht21_instance->pfaht21_read_data == NULL)
+}
+
+/**
+ * @brief  睡眠ms毫秒
+ *
+ * @param  aht21_instance  aht21实例
+ * @param  ms              等待时间
+ */
+static void aht21_wait_ms(bsp_aht21_t *aht21_instance, uint32_t ms)
+{
+    aht21_wait_until(aht21_instance, AHT21_GET_TICK(aht21_instance) + ms);
+}
+
+/**
+ * @brief  执行一次IIC事务 不做恢复
+ *
+ * 字节级接口的每个返回值都会检查,任意一步失败立即发送停止信号释放总线。
+ * 事务返回后耗时超过AHT21_IIC_XFER_TIMEOUT_MS(如时钟拉伸过长)记为超时。
+ * 该检查只在后端返回后进行,不能打断卡住的后端:阻塞时长的上限由后端自己
+ * 保证,如ec_bsp_iic_hal_seq的pfTransfer每段最多等待IIC_HAL_SEQ_TIMEOUT_MS;
+ * 字节级接口和不带超时的pfTransfer后端没有上限。
+ *
+ * @param  aht21_instance  aht21实例
+ * @param  addr            7位从机地址
+ * @param  pdata           数据缓冲区
+ * @param  size            数据长度
+ * @param  read            true读 false写
+ * @return 0 success
+ *         RET_CODE_AHT21_IIC_FAIL    无应答或后端出错
+ *         RET_CODE_AHT21_IIC_TIMEOUT 事务超时
+ */
+static int8_t aht21_iic_xfer_once(bsp_aht21_t *aht21_instance, uint8_t addr, uint8_t *pdata, uint8_t size, bool read)
+{
+    uint32_t start = AHT21_GET_TICK(aht21_instance);
+    int8_t code = RET_CODE_SUCCESS;
+
+#if AHT21_CFG_STATIC_DISPATCH
+    iic_segment_t seg = {pdata, size, read ? IIC_SEG_READ : IIC_SEG_WRITE};
+    iic_transaction_t xfer = {addr, 1, &seg};
+    code = (AHT21_CFG_IIC_TRANSFER(&xfer) == 0) ? RET_CODE_SUCCESS : RET_CODE_AHT21_IIC_FAIL;
+#else
+    iic_driver_interface_t *iic = aht21_instance->iic_driver_interface_t;
+    if (iic->pfTransfer != NULL)
+    {
+        // 后端一次完成整个事务
+        iic_segment_t seg = {pdata, size, read ? IIC_SEG_READ : IIC_SEG_WRITE};
+        iic_transaction_t xfer = {addr, 1, &seg};
+        code = (iic->pfTransfer(&xfer) == 0) ? RET_CODE_SUCCESS : RET_CODE_AHT21_IIC_FAIL;
+    }
+    else
+    {
+        if (iic->pfStart() != 0 ||
+            iic->pfSendByte((uint8_t)((addr << 1) | (read ? 0x01 : 0x00))) != 0 ||
+            iic->pfWaitAck() != 0)
+        {
+            code = RET_CODE_AHT21_IIC_FAIL;
+        }
+        for (uint8_t i = 0; i < size && code == RET_CODE_SUCCESS; i++)
+        {
+            if (read)
+            {
+                // 最后一个字节回复NACK
+                if (iic->pfReadByte(&pdata[i]) != 0 ||
+                    ((i + 1 < size) ? iic->pfSendAck() : iic->pfSendNack()) != 0)
+                {
+                    code = RET_CODE_AHT21_IIC_FAIL;
+                }
+            }
+            else if (iic->pfSendByte(pdata[i]) != 0 || iic->pfWaitAck() != 0)
+            {
+                code = RET_CODE_AHT21_IIC_FAIL;
+            }
+        }
+        if (iic->pfStop() != 0 && code == RET_CODE_SUCCESS)
+        {
+            code = RET_CODE_AHT21_IIC_FAIL;
+        }
+    }
+#endif
+    uint32_t elapsed = AHT21_GET_TICK(aht21_instance) - start;
+    if (elapsed > AHT21_IIC_XFER_TIMEOUT_MS)
+    {
+        code = RET_CODE_AHT21_IIC_TIMEOUT;
+    }
+    if (code == RET_CODE_AHT21_IIC_TIMEOUT)
+    {
+        aht21_instance->fault_stats.timeout++;
+    }
+    else if (code != RET_CODE_SUCCESS)
+    {
+        aht21_instance->fault_stats.nack++;
+    }
+    return code;
+}
+
+/**
+ * @brief  调用总线解锁
+ *
+ * @param  aht21_instance  aht21实例
+ * @return 0 已解锁
+ *         -1 后端未提供解锁或解锁失败
+ */
+static int8_t aht21_iic_bus_recover(bsp_aht21_t *aht21_instance)
+{
+#if AHT21_CFG_STATIC_DISPATCH
+#ifdef AHT21_CFG_IIC_BUS_RECOVER
+    aht21_instance->fault_stats.bus_recover++;
+    return (AHT21_CFG_IIC_BUS_RECOVER() == 0) ? 0 : -1;
+#else
+    return -1;
+#endif
+#else
+    iic_driver_interface_t *iic = aht21_instance->iic_driver_interface_t;
+    if (iic->pfBusRecover == NULL)
+    {
+        return -1;
+    }
+    aht21_instance->fault_stats.bus_recover++;
+    return (iic->pfBusRecover() == 0) ? 0 : -1;
+#endif
+}
+
+/**
+ * @brief  经实例的IIC接口向任意从机执行事务 失败时重试并解锁总线
+ *
+ * 1. 按指数退避(1ms 2ms 4ms ...)重试AHT21_IIC_RETRY_MAX次
+ * 2. 仍失败则调用pfBusRecover(九时钟解锁SCL/SDA)后再试一次
+ * 不软复位传感器,同一总线上的其他从机(如IIC mux)也通过本函数访问,
+ * 超时、重试和恢复计入该实例的故障统计。
+ *
+ * @param  aht21_instance  aht21实例 提供IIC接口、时基和故障统计
+ * @param  addr            7位从机地址
+ * @param  pdata           数据缓冲区
+ * @param  size            数据长度
+ * @param  read            true读 false写
+ * @return 0 success 其他为最后一次失败的结果码
+ */
+int8_t aht21_iic_transfer(bsp_aht21_t *aht21_instance, uint8_t addr, uint8_t *pdata, uint8_t size, bool read)
+{
+    if (aht21_instance == NULL)
+    {
+        return RET_CODE_ERROR_AHT21_INSTANCE_NULL;
+    }
+    if (pdata == NULL || size == 0)
     {
-        // 解构
-        aht21_deInst(aht21_instance);
         return RET_CODE_ERROR_PARAM_NULL;
     }
-    // 挂载成功
+    aht21_fault_stats_t *stats = &aht21_instance->fault_stats;
+    int8_t code = aht21_iic_xfer_once(aht21_instance, addr, pdata, size, read);
+    if (code == RET_CODE_SUCCESS)
+    {
+        return code;
+    }
+    uint32_t backoff = AHT21_IIC_BACKOFF_INIT_MS;
+    for (uint8_t retry = 0; retry < AHT21_IIC_RETRY_MAX; retry++)
+    {
+        aht21_wait_ms(aht21_instance, backoff);
+        backoff <<= 1;
+        stats->retry++;
+        code = aht21_iic_xfer_once(aht21_instance, addr, pdata, size, read);
+        if (code == RET_CODE_SUCCESS)
+        {
+            stats->recovered++;
+            return code;
+        }
+    }
+    if (aht21_iic_bus_recover(aht21_instance) == 0)
+    {
+        code = aht21_iic_xfer_once(aht21_instance, addr, pdata, size, read);
+        if (code == RET_CODE_SUCCESS)
+        {
+            stats->recovered++;
+            return code;
+        }
+    }
+    return code;
+}
+
+/**
+ * @brief  与AHT21执行IIC事务 失败时逐级恢复
+ *
+ * 经aht21_iic_transfer重试和解锁总线后仍失败则软复位传感器,本次测量作废。
+ *
+ * @param  aht21_instance  aht21实例
+ * @param  pdata           数据缓冲区
+ * @param  size            数据长度
+ * @param  read            true读 false写
+ * @return 0 success 其他为最后一次失败的结果码
+ */
+static int8_t aht21_iic_xfer(bsp_aht21_t *aht21_instance, uint8_t *pdata, uint8_t size, bool read)
+{
+    int8_t code = aht21_iic_transfer(aht21_instance, aht21_instance->dev_addr, pdata, size, read);
+    if (code == RET_CODE_SUCCESS)
+    {
+        return code;
+    }
+    // 总线已恢复但传感器仍无响应 软复位 当前测量作废
+    aht21_softReset(aht21_instance);
+    aht21_instance->fault_stats.fatal++;
+    return code;
+}
+
+/**
+ * @brief  通过实例IIC接口向AHT21写入数据 失败时自动恢复
+ *
+ * @param  aht21_instance  aht21实例
+ * @param  pdata           待发送数据
+ * @param  size            数据长度
+ * @return 0 success 其他参考aht21_iic_xfer
+ */
+static int8_t aht21_iic_write(bsp_aht21_t *aht21_instance, const uint8_t *pdata, uint8_t size)
+{
+    return aht21_iic_xfer(aht21_instance, (uint8_t *)pdata, size, false);
+}
+
+/**
+ * @brief  通过实例IIC接口从AHT21读取数据 失败时自动恢复
+ *
+ * @param  aht21_instance  aht21实例
+ * @param  pdata           接收缓冲区
+ * @param  size            数据长度
+ * @return 0 success 其他参考aht21_iic_xfer
+ */
+static int8_t aht21_iic_read(bsp_aht21_t *aht21_instance, uint8_t *pdata, uint8_t size)
+{
+    return aht21_iic_xfer(aht21_instance, pdata, size, true);
+}
+
+/**
+ * @brief  软复位AHT21 发送0xBA并等待AHT21_RESET_DELAY_MS
+ *
+ * 复位命令只发送一次,不经过恢复流程;正在进行的测量作废。
+ *
+ * @param  aht21_instance  aht21实例
+ * @return 0 success
+ *         RET_CODE_AHT21_IIC_FAIL 复位命令无应答
+ */
+int8_t aht21_softReset(bsp_aht21_t *aht21_instance)
+{
+    if (aht21_instance == NULL)
+    {
+        return RET_CODE_ERROR_AHT21_INSTANCE_NULL;
+    }
+    uint8_t cmd = AHT21_SOFT_RESET;
+    aht21_instance->fault_stats.soft_reset++;
+    aht21_instance->meas_state = AHT21_MEAS_STATE_IDLE;
+    int8_t code = aht21_iic_xfer_once(aht21_instance, aht21_instance->dev_addr, &cmd, 1, false);
+    aht21_wait_ms(aht21_instance, AHT21_RESET_DELAY_MS);
+    return code;
+}
+
+/**
+ * @brief  获取总线故障统计
+ *
+ * @param  aht21_instance  aht21实例
+ * @param  stats           统计输出
+ * @return 0 success
+ */
+int8_t aht21_get_fault_stats(bsp_aht21_t *aht21_instance, aht21_fault_stats_t *stats)
+{
+    if (aht21_instance == NULL)
+    {
+        return RET_CODE_ERROR_AHT21_INSTANCE_NULL;
+    }
+    if (stats == NULL)
+    {
+        return RET_CODE_ERROR_PARAM_NULL;
+    }
+    *stats = aht21_instance->fault_stats;
     return RET_CODE_SUCCESS;
 }
 
@@ -160,30 +493,30 @@ int8_t aht21_inst(bsp_aht21_t *aht21_instance, // AHT21的实体实例
  */
 int8_t aht21_init(bsp_aht21_t *aht21_instance)
 {
+    AHT21_TRACE_BEGIN(trace_start);
     // iic初始化
-    aht21_instance->iic_driver_interface_t->pfInit();
-    int32_t count = aht21_instance->pftimebase_interface->mcu_get_systick_count();
-    if ((aht21_instance->pftimebase_interface->mcu_get_systick_count() - count) < 70)
+    (void)AHT21_IIC_INIT(aht21_instance);
+    // 上电AHT21_INIT_DELAY_MS内传感器不响应 时基从上电开始计数
+    if (AHT21_GET_TICK(aht21_instance) < AHT21_INIT_DELAY_MS)
     {
-        // 让出cpu
-        aht21_instance->pfyield(aht21_instance);
+        aht21_wait_until(aht21_instance, AHT21_INIT_DELAY_MS);
     }
     // AHT21初始化
-    uint8_t readBuffer;
+    uint8_t readBuffer = 0;
     // 获取状态
-    iic_Start();                            // 生成iic启动信号
-    iic_Send_Byte(AHT21_ADDR, 0x71);        // 发送0x71获取状态
-    iic_wait_ack(AHT21_ADDR);               // 等待iic应答
-    readBuffer = iic_Read_Byte(AHT21_ADDR); // 接收AHT21状态
-    iic_Stop();                             // iic停止
-    if ((readBuffer & 0x80) == 0x00)
+    int8_t code = aht21_iic_read(aht21_instance, &readBuffer, 1);
+    if (code == RET_CODE_SUCCESS && (readBuffer & 0x08) == 0x00)
     {
-        iic_Start();                     // 生成iic启动信号
-        iic_Send_Byte(AHT21_ADDR, 0xBE); // 发送0xBE进行初始化
-        iic_nack(AHT21_ADDR);            // 发送非应答信号
-        iic_Stop();                      // iic停止
+        // 未校准 发送0xBE 0x08 0x00进行初始化
+        const uint8_t init_cmd[3] = {0xBE, 0x08, 0x00};
+        code = aht21_iic_write(aht21_instance, init_cmd, 3);
+        if (code == RET_CODE_SUCCESS)
+        {
+            aht21_wait_ms(aht21_instance, AHT21_CAL_DELAY_MS);
+        }
     }
-    return readBuffer;
+    AHT21_TRACE_END(aht21_instance, AHT21_TRACE_PHASE_INIT, trace_start, code);
+    return code;
 }
 
 /**
@@ -192,9 +525,11 @@ int8_t aht21_init(bsp_aht21_t *aht21_instance)
 int8_t aht21_deInit(bsp_aht21_t *aht21_instance)
 {
     // iic逆初始化
-    aht21_instance->iic_driver_interface_t->pfDeInit();
-    // AHT21下电
+    (void)AHT21_IIC_DEINIT(aht21_instance);
+#ifdef USE_HAL_DRIVER
+    // AHT21下电 主机仿真构建中不存在
     __HAL_RCC_GPIOB_CLK_DISABLE();
+#endif
     // aht21_instance 解构
     aht21_deInst(aht21_instance);
     // 逆初始化成功
@@ -213,34 +548,26 @@ int8_t aht21_deInst(bsp_aht21_t *aht21_instance)
 {
     if (aht21_instance != NULL)
     {
-        // AHT21实例IIC逆初始化
-        if (aht21_instance->iic_driver_interface_t != NULL)
-        {
-            aht21_instance->iic_driver_interface_t->pfDeInit = NULL;
-            aht21_instance->iic_driver_interface_t->pfReadReg = NULL;
-            aht21_instance->iic_driver_interface_t->pfWriteReg = NULL;
-            aht21_instance->iic_driver_interface_t->pfInit = NULL;
-            aht21_instance->iic_driver_interface_t->pfStart = NULL;
-            aht21_instance->iic_driver_interface_t->pfStop = NULL;
-            aht21_instance->iic_driver_interface_t->pfWaitAck = NULL;
-            aht21_instance->iic_driver_interface_t->pfSendByte = NULL;
-            aht21_instance->iic_driver_interface_t->pfReadByte = NULL;
-            aht21_instance->iic_driver_interface_t->pfSendAck = NULL;
-            aht21_instance->iic_driver_interface_t->pfSendNack = NULL;
-            aht21_instance->iic_driver_interface_t = NULL;
-        }
-        // AHT21实例时基单元逆初始化
-        if (aht21_instance->pftimebase_interface != NULL)
-        {
-            aht21_instance->pftimebase_interface->mcu_get_systick_count = NULL;
-        }
+        // AHT21实例IIC/时基解除挂载 接口可能被其他实例共享 不修改接口本身
+        aht21_instance->iic_driver_interface_t = NULL;
+        aht21_instance->pftimebase_interface = NULL;
+#if AHT21_CFG_METHOD_TABLE
         // AHT21实例逆初始化
         aht21_instance->pfdeInit = NULL;
         aht21_instance->pfinit = NULL;
         aht21_instance->pfaht21_read_id = NULL;
         aht21_instance->pfaht21_read_data = NULL;
-        aht21_instance->pfyield = NULL;
+        aht21_instance->pfstartMeasurement = NULL;
+        aht21_instance->pfpoll_ready = NULL;
+        aht21_instance->pffetch = NULL;
+        aht21_instance->pfread_burst = NULL;
+        aht21_instance->pfsleep = NULL;
+        aht21_instance->pfwakeup = NULL;
+        aht21_instance->pfsoftReset = NULL;
         aht21_instance->pfInst = NULL;
+#endif
+        aht21_instance->pfyield = NULL;
+        aht21_instance->meas_state = AHT21_MEAS_STATE_IDLE;
         aht21_instance = NULL;
     }
     return 0;
@@ -256,44 +583,933 @@ int8_t aht21_read_id(bsp_aht21_t *aht21_instance)
 }
 
 /**
- * 读取温度/湿度
+ * @brief  根据转换时间统计预测首次查询状态的时间
+ *
+ * 统计样本不足时使用AHT21_POLL_FIRST_DEFAULT_MS,否则取滑动平均减去一个
+ * 初始查询间隔,并限制在[最短转换时间, AHT21_MEASUREMENT_DELAY_MS]之间。
+ *
+ * @param  aht21_instance  aht21实例
+ * @return 触发后首次查询的时间(ms)
  */
-int8_t aht21_read_data(bsp_aht21_t *aht21_instance, float *temp, float *humi)
+static uint32_t aht21_predict_first_poll(const bsp_aht21_t *aht21_instance)
 {
-    uint8_t readBuffer[6];
-    //发送信号
-    uint8_t send_arry[3] =  {0xAC,0x33,0x00};
-    aht21_instance->iic_driver_interface_t->pfWriteReg(AHT21_ADDR,send_arry,3);
-    // iic_Start(); // 生成iic启动信号
-    // iic_Send_Byte(AHT21_ADDR, 0xAC);
-    // iic_Send_Byte(AHT21_ADDR, 0x33);
-    // iic_Send_Byte(AHT21_ADDR, 0x00);
-    // 等待75ms时间测量
-    int32_t count = aht21_instance->pftimebase_interface->mcu_get_systick_count();
-    if ((aht21_instance->pftimebase_interface->mcu_get_systick_count()) - count < 75)
+    const aht21_conv_stats_t *stats = &aht21_instance->conv_stats;
+    if (stats->count < AHT21_CONV_STATS_WARMUP)
     {
-        // 让出cpu
-        aht21_instance->pfyield(aht21_instance);
+        return AHT21_POLL_FIRST_DEFAULT_MS;
     }
-    iic_wait_ack(AHT21_ADDR); // 等待iic应答
-    for (int i = 0; i < 6; i++)
+    uint32_t first = stats->avg_q4 >> 4;
+    first = (first > aht21_instance->poll_backoff_init_ms) ? first - aht21_instance->poll_backoff_init_ms : 0;
+    if (first < stats->min_ms)
     {
-        readBuffer[i] = iic_Read_Byte(AHT21_ADDR); // 接收AHT21测量值
+        first = stats->min_ms;
     }
-    iic_Stop(); // 发送iic停止信号
-    // 判断0字节第七位是否为0 若为0则为刚刚测量完成的数据
-    if ((readBuffer[0] & 0x80) == 0x00)
+    if (first > AHT21_MEASUREMENT_DELAY_MS)
+    {
+        first = AHT21_MEASUREMENT_DELAY_MS;
+    }
+    return first;
+}
+
+/**
+ * @brief  记录一次转换时间
+ *
+ * @param  aht21_instance  aht21实例
+ * @param  elapsed_ms      触发到busy位清零的时间
+ */
+static void aht21_record_conv_time(bsp_aht21_t *aht21_instance, uint32_t elapsed_ms)
+{
+    aht21_conv_stats_t *stats = &aht21_instance->conv_stats;
+    uint16_t sample = (elapsed_ms > 0xFFFF) ? 0xFFFF : (uint16_t)elapsed_ms;
+    if (stats->count == 0)
+    {
+        stats->min_ms = sample;
+        stats->max_ms = sample;
+        stats->avg_q4 = (uint16_t)(sample << 4);
+    }
+    else
+    {
+        if (sample < stats->min_ms)
+        {
+            stats->min_ms = sample;
+        }
+        if (sample > stats->max_ms)
+        {
+            stats->max_ms = sample;
+        }
+        // avg += (sample - avg) / 8
+        int32_t diff = ((int32_t)sample << 4) - (int32_t)stats->avg_q4;
+        stats->avg_q4 = (uint16_t)((int32_t)stats->avg_q4 + diff / 8);
+    }
+    if (stats->count != UINT32_MAX)
+    {
+        stats->count++;
+    }
+}
+
+/**
+ * @brief  触发一次测量(发送0xAC 0x33 0x00) 不等待转换完成
+ *
+ * @param  aht21_instance  aht21实例
+ * @return 0 success
+ *         RET_CODE_AHT21_STATE_ERROR 上一次测量尚未取数
+ *         RET_CODE_AHT21_IIC_FAIL    IIC通信失败
+ */
+int8_t aht21_start(bsp_aht21_t *aht21_instance)
+{
+    if (aht21_instance == NULL)
+    {
+        return RET_CODE_ERROR_AHT21_INSTANCE_NULL;
+    }
+    if (aht21_instance->meas_state == AHT21_MEAS_STATE_CONVERTING || aht21_instance->sleeping)
+    {
+        return RET_CODE_AHT21_STATE_ERROR;
+    }
+    const uint8_t send_arry[3] = {AHT21_AC, AHT21_AC_1, AHT21_AC_2};
+    AHT21_TRACE_BEGIN(trace_start);
+    int8_t code = aht21_iic_write(aht21_instance, send_arry, 3);
+    AHT21_TRACE_END(aht21_instance, AHT21_TRACE_PHASE_TRIGGER, trace_start, code);
+    if (code != RET_CODE_SUCCESS)
+    {
+        aht21_instance->meas_state = AHT21_MEAS_STATE_IDLE;
+        AHT21_HEALTH_RECORD(aht21_instance, code, NULL);
+        return code;
+    }
+    // 记录触发时刻和转换完成的deadline
+    aht21_instance->meas_start_tick = AHT21_GET_TICK(aht21_instance);
+    if (aht21_instance->wait_mode == AHT21_WAIT_MODE_ADAPTIVE)
+    {
+        // 自适应模式下deadline为首次查询状态的时刻
+        aht21_instance->meas_deadline = aht21_instance->meas_start_tick + aht21_predict_first_poll(aht21_instance);
+        aht21_instance->poll_backoff_ms = aht21_instance->poll_backoff_init_ms;
+    }
+    else
+    {
+        aht21_instance->meas_deadline = aht21_instance->meas_start_tick + AHT21_MEASUREMENT_DELAY_MS;
+    }
+    aht21_instance->meas_state = AHT21_MEAS_STATE_CONVERTING;
+    AHT21_TRACE_STAMP(aht21_instance->trace_wait_start);
+    return RET_CODE_SUCCESS;
+}
+
+/**
+ * @brief  查询转换是否完成 不阻塞
+ *
+ * @param  aht21_instance  aht21实例
+ * @return 0 转换完成 可调用aht21_fetch取数
+ *         RET_CODE_AHT21_BUSY        未到deadline
+ *         RET_CODE_AHT21_STATE_ERROR 未触发测量
+ */
+int8_t aht21_poll_ready(bsp_aht21_t *aht21_instance)
+{
+    if (aht21_instance == NULL)
+    {
+        return RET_CODE_ERROR_AHT21_INSTANCE_NULL;
+    }
+    if (aht21_instance->meas_state == AHT21_MEAS_STATE_READY)
+    {
+        return RET_CODE_SUCCESS;
+    }
+    if (aht21_instance->meas_state != AHT21_MEAS_STATE_CONVERTING)
+    {
+        return RET_CODE_AHT21_STATE_ERROR;
+    }
+    uint32_t now = AHT21_GET_TICK(aht21_instance);
+    if (!AHT21_TICK_REACHED(now, aht21_instance->meas_deadline))
+    {
+        return RET_CODE_AHT21_BUSY;
+    }
+    if (aht21_instance->wait_mode == AHT21_WAIT_MODE_ADAPTIVE)
+    {
+        // 读取状态字节 busy位清零即转换完成
+        uint8_t status = 0;
+        int8_t code = aht21_iic_read(aht21_instance, &status, 1);
+        if (code != RET_CODE_SUCCESS)
+        {
+            aht21_instance->meas_state = AHT21_MEAS_STATE_IDLE;
+            AHT21_HEALTH_RECORD(aht21_instance, code, NULL);
+            return code;
+        }
+        if ((status & 0x80) != 0x00)
+        {
+            if (AHT21_TICK_REACHED(now, aht21_instance->meas_start_tick + AHT21_MEASUREMENT_TIMEOUT_MS))
+            {
+                aht21_instance->meas_state = AHT21_MEAS_STATE_IDLE;
+                AHT21_TRACE_END(aht21_instance, AHT21_TRACE_PHASE_WAIT, aht21_instance->trace_wait_start,
+                                RET_CODE_AHT21_TIMEOUT);
+                AHT21_HEALTH_RECORD(aht21_instance, RET_CODE_AHT21_TIMEOUT, NULL);
+                return RET_CODE_AHT21_TIMEOUT;
+            }
+            // 仍忙 按退避间隔安排下一次查询
+            aht21_instance->meas_deadline = now + aht21_instance->poll_backoff_ms;
+            if (aht21_instance->poll_backoff_ms < aht21_instance->poll_backoff_max_ms)
+            {
+                aht21_instance->poll_backoff_ms <<= 1;
+                if (aht21_instance->poll_backoff_ms > aht21_instance->poll_backoff_max_ms)
+                {
+                    aht21_instance->poll_backoff_ms = aht21_instance->poll_backoff_max_ms;
+                }
+            }
+            return RET_CODE_AHT21_BUSY;
+        }
+        aht21_record_conv_time(aht21_instance, now - aht21_instance->meas_start_tick);
+    }
+    aht21_instance->meas_state = AHT21_MEAS_STATE_READY;
+    return RET_CODE_SUCCESS;
+}
+
+/**
+ * @brief  设置转换等待方式
+ *
+ * @param  aht21_instance   aht21实例
+ * @param  mode             AHT21_WAIT_MODE_FIXED 或 AHT21_WAIT_MODE_ADAPTIVE
+ * @param  backoff_init_ms  自适应模式首次查询仍忙后的间隔 0使用默认值
+ * @param  backoff_max_ms   自适应模式查询间隔上限 0使用默认值
+ * @return 0 success
+ *         RET_CODE_AHT21_STATE_ERROR 正在转换 不允许切换
+ */
+int8_t aht21_set_wait_mode(bsp_aht21_t *aht21_instance, aht21_wait_mode_t mode,
+                           uint16_t backoff_init_ms, uint16_t backoff_max_ms)
+{
+    if (aht21_instance == NULL)
+    {
+        return RET_CODE_ERROR_AHT21_INSTANCE_NULL;
+    }
+    if (aht21_instance->meas_state == AHT21_MEAS_STATE_CONVERTING)
+    {
+        return RET_CODE_AHT21_STATE_ERROR;
+    }
+    if (backoff_init_ms == 0)
+    {
+        backoff_init_ms = AHT21_POLL_BACKOFF_INIT_MS;
+    }
+    if (backoff_max_ms == 0)
     {
-        uint32_t data = 0;
-        data = ((uint32_t)readBuffer[3] >> 4) + ((uint32_t)readBuffer[2] << 4) + ((uint32_t)readBuffer[1] << 12);
-        *temp = data * 200.0f / (1 << 20) - 50;
-        *humi = data * 100.0f / (1 << 20);
-        return RET_CODE_SUCCESS; // 测量成功
+        backoff_max_ms = AHT21_POLL_BACKOFF_MAX_MS;
     }
-    return -1; // 待修改
+    if (backoff_max_ms < backoff_init_ms)
+    {
+        backoff_max_ms = backoff_init_ms;
+    }
+    aht21_instance->wait_mode = mode;
+    aht21_instance->poll_backoff_init_ms = backoff_init_ms;
+    aht21_instance->poll_backoff_max_ms = backoff_max_ms;
+    aht21_instance->poll_backoff_ms = backoff_init_ms;
+    return RET_CODE_SUCCESS;
+}
+
+/**
+ * @brief  设置CRC校验
+ *
+ * 使能后每次取数读取7字节并校验CRC-8,校验失败时重读retry_max次,
+ * 仍失败则丢弃本次测量并返回RET_CODE_AHT21_CRC_FAIL。
+ *
+ * @param  aht21_instance  aht21实例
+ * @param  enable          是否使能
+ * @param  retry_max       CRC错误时重读次数
+ * @return 0 success
+ */
+int8_t aht21_set_crc(bsp_aht21_t *aht21_instance, bool enable, uint8_t retry_max)
+{
+    if (aht21_instance == NULL)
+    {
+        return RET_CODE_ERROR_AHT21_INSTANCE_NULL;
+    }
+    aht21_instance->crc_enable = enable;
+    aht21_instance->crc_retry_max = retry_max;
+    return RET_CODE_SUCCESS;
 }
 
-int8_t iic_ReadReg(void *,uint8_t addr,uint8_t *data,uint8_t size)
+/**
+ * @brief  获取转换时间统计
+ *
+ * @param  aht21_instance  aht21实例
+ * @param  stats           统计输出
+ * @return 0 success
+ */
+int8_t aht21_get_conv_stats(bsp_aht21_t *aht21_instance, aht21_conv_stats_t *stats)
 {
-    iic_driver_interface_t
+    if (aht21_instance == NULL)
+    {
+        return RET_CODE_ERROR_AHT21_INSTANCE_NULL;
+    }
+    if (stats == NULL)
+    {
+        return RET_CODE_ERROR_PARAM_NULL;
+    }
+    *stats = aht21_instance->conv_stats;
+    return RET_CODE_SUCCESS;
+}
+
+/**
+ * @brief  校验7字节帧的CRC
+ *
+ * @param  aht21_instance  aht21实例
+ * @param  frame           7字节帧
+ * @return true CRC正确
+ */
+static bool aht21_crc_check(const bsp_aht21_t *aht21_instance, const uint8_t *frame)
+{
+    uint8_t crc = (aht21_instance->pfcrc8 != NULL) ? aht21_instance->pfcrc8(frame, AHT21_FRAME_LEN)
+                                                   : aht21_frame_crc8(frame, AHT21_FRAME_LEN);
+    return crc == frame[AHT21_FRAME_LEN];
+}
+
+/**
+ * @brief  读取已完成转换的原始数据 不做浮点运算
+ *
+ * @param  aht21_instance  aht21实例
+ * @param  raw             原始数据输出(20位湿度/温度码及状态字节)
+ * @return 0 success
+ *         RET_CODE_AHT21_BUSY        未到deadline或传感器仍忙 需继续poll
+ *         RET_CODE_AHT21_STATE_ERROR 未触发测量
+ *         RET_CODE_AHT21_TIMEOUT     转换超时
+ *         RET_CODE_AHT21_IIC_FAIL    IIC通信失败
+ *         转换未完成时原样返回aht21_poll_ready的结果
+ */
+int8_t aht21_fetch_raw(bsp_aht21_t *aht21_instance, aht21_raw_data_t *raw)
+{
+    if (aht21_instance == NULL)
+    {
+        return RET_CODE_ERROR_AHT21_INSTANCE_NULL;
+    }
+    if (raw == NULL)
+    {
+        return RET_CODE_ERROR_PARAM_NULL;
+    }
+    int8_t code = aht21_poll_ready(aht21_instance);
+    if (code != RET_CODE_SUCCESS)
+    {
+        return code;
+    }
+    uint8_t readBuffer[AHT21_FRAME_CRC_LEN];
+    uint8_t attempt = 0;
+    AHT21_TRACE_BEGIN(trace_read);
+    for (;;)
+    {
+        code = aht21_iic_read(aht21_instance, readBuffer,
+                              aht21_instance->crc_enable ? AHT21_FRAME_CRC_LEN : AHT21_FRAME_LEN);
+        if (code != RET_CODE_SUCCESS)
+        {
+            aht21_instance->meas_state = AHT21_MEAS_STATE_IDLE;
+            AHT21_TRACE_END(aht21_instance, AHT21_TRACE_PHASE_READ, trace_read, code);
+            AHT21_HEALTH_RECORD(aht21_instance, code, NULL);
+            return code;
+        }
+        if (!aht21_instance->crc_enable || aht21_crc_check(aht21_instance, readBuffer))
+        {
+            break;
+        }
+        // CRC错误 测量结果仍锁存在传感器中 直接重读 无需重新触发测量
+        aht21_instance->crc_fail_count++;
+        if (attempt++ >= aht21_instance->crc_retry_max)
+        {
+            aht21_instance->crc_reject_count++;
+            aht21_instance->meas_state = AHT21_MEAS_STATE_IDLE;
+            AHT21_TRACE_END(aht21_instance, AHT21_TRACE_PHASE_READ, trace_read, RET_CODE_AHT21_CRC_FAIL);
+            AHT21_HEALTH_RECORD(aht21_instance, RET_CODE_AHT21_CRC_FAIL, NULL);
+            return RET_CODE_AHT21_CRC_FAIL;
+        }
+    }
+    AHT21_TRACE_END(aht21_instance, AHT21_TRACE_PHASE_READ, trace_read, RET_CODE_SUCCESS);
+    // 判断0字节第七位是否为0 若为0则为刚刚测量完成的数据
+    if (aht21_frame_is_busy(readBuffer[0]))
+    {
+        uint32_t now = AHT21_GET_TICK(aht21_instance);
+        if (AHT21_TICK_REACHED(now, aht21_instance->meas_start_tick + AHT21_MEASUREMENT_TIMEOUT_MS))
+        {
+            // busy位一直不清零 放弃本次测量 避免调用者无限等待
+            aht21_instance->meas_state = AHT21_MEAS_STATE_IDLE;
+            AHT21_TRACE_SPAN(aht21_instance, AHT21_TRACE_PHASE_WAIT, aht21_instance->trace_wait_start,
+                             trace_read, RET_CODE_AHT21_TIMEOUT);
+            AHT21_HEALTH_RECORD(aht21_instance, RET_CODE_AHT21_TIMEOUT, NULL);
+            return RET_CODE_AHT21_TIMEOUT;
+        }
+        // 传感器仍在转换 顺延deadline
+        aht21_instance->meas_deadline = now + AHT21_BUSY_RETRY_DELAY_MS;
+        aht21_instance->meas_state = AHT21_MEAS_STATE_CONVERTING;
+        return RET_CODE_AHT21_BUSY;
+    }
+    // 等待阶段到开始读取有效帧为止
+    AHT21_TRACE_SPAN(aht21_instance, AHT21_TRACE_PHASE_WAIT, aht21_instance->trace_wait_start,
+                     trace_read, RET_CODE_SUCCESS);
+    AHT21_TRACE_BEGIN(trace_decode);
+    aht21_frame_decode(readBuffer, raw);
+    AHT21_TRACE_END(aht21_instance, AHT21_TRACE_PHASE_DECODE, trace_decode, RET_CODE_SUCCESS);
+    aht21_instance->meas_state = AHT21_MEAS_STATE_IDLE;
+    AHT21_HEALTH_RECORD(aht21_instance, RET_CODE_SUCCESS, raw);
+    return RET_CODE_SUCCESS; // 测量成功
+}
+
+/**
+ * @brief  读取已完成转换的温度/湿度 定点格式
+ *
+ * @param  aht21_instance  aht21实例
+ * @param  temp_centi      温度输出(0.01摄氏度)
+ * @param  humi_centi      湿度输出(0.01%RH)
+ * @return 同aht21_fetch_raw
+ */
+int8_t aht21_fetch_centi(bsp_aht21_t *aht21_instance, int16_t *temp_centi, uint16_t *humi_centi)
+{
+    if (temp_centi == NULL || humi_centi == NULL)
+    {
+        return RET_CODE_ERROR_PARAM_NULL;
+    }
+    aht21_raw_data_t raw;
+    int8_t code = aht21_fetch_raw(aht21_instance, &raw);
+    if (code != RET_CODE_SUCCESS)
+    {
+        return code;
+    }
+    aht21_comp_calibrate(&aht21_instance->calib,
+                         aht21_raw_to_temp_centi(raw.temp_raw),
+                         aht21_raw_to_humi_centi(raw.humi_raw),
+                         temp_centi, humi_centi);
+    return RET_CODE_SUCCESS;
+}
+
+/**
+ * @brief  读取已完成转换的数据 计算校准后的温湿度及派生量
+ *
+ * @param  aht21_instance  aht21实例
+ * @param  comp            补偿结果
+ * @return 同aht21_fetch_raw
+ */
+int8_t aht21_fetch_comp(bsp_aht21_t *aht21_instance, aht21_comp_t *comp)
+{
+    if (comp == NULL)
+    {
+        return RET_CODE_ERROR_PARAM_NULL;
+    }
+    aht21_raw_data_t raw;
+    int8_t code = aht21_fetch_raw(aht21_instance, &raw);
+    if (code != RET_CODE_SUCCESS)
+    {
+        return code;
+    }
+    aht21_comp_process(&aht21_instance->calib,
+                       aht21_raw_to_temp_centi(raw.temp_raw),
+                       aht21_raw_to_humi_centi(raw.humi_raw),
+                       comp);
+    return RET_CODE_SUCCESS;
+}
+
+/**
+ * @brief  原始码转浮点温湿度 并应用实例的校准参数
+ *
+ * 与aht21_fetch_centi同一条定点校准路径，浮点输出只是0.01单位结果的换算，
+ * 两种接口读到的值一致。
+ *
+ * @param  aht21_instance  aht21实例
+ * @param  raw             原始数据
+ * @param  temp            温度输出(摄氏度)
+ * @param  humi            湿度输出(百分比)
+ */
+static void aht21_raw_to_output(const bsp_aht21_t *aht21_instance, const aht21_raw_data_t *raw,
+                                float *temp, float *humi)
+{
+    int16_t temp_centi;
+    uint16_t humi_centi;
+    aht21_comp_calibrate(&aht21_instance->calib,
+                         aht21_raw_to_temp_centi(raw->temp_raw),
+                         aht21_raw_to_humi_centi(raw->humi_raw),
+                         &temp_centi, &humi_centi);
+    *temp = temp_centi * 0.01f;
+    *humi = humi_centi * 0.01f;
+}
+
+/**
+ * @brief  设置校准参数
+ *
+ * @param  aht21_instance  aht21实例
+ * @param  calib           校准参数 NULL时恢复默认(增益1 偏移0)
+ * @return 0 success
+ */
+int8_t aht21_set_calib(bsp_aht21_t *aht21_instance, const aht21_calib_t *calib)
+{
+    if (aht21_instance == NULL)
+    {
+        return RET_CODE_ERROR_AHT21_INSTANCE_NULL;
+    }
+    if (calib == NULL)
+    {
+        aht21_comp_calib_default(&aht21_instance->calib);
+    }
+    else
+    {
+        aht21_instance->calib = *calib;
+    }
+    return RET_CODE_SUCCESS;
+}
+
+#if AHT21_CFG_HEALTH
+/**
+ * @brief  把一次测量结果交给健康跟踪
+ *
+ * 成功时以触发时刻计算变化率,温湿度使用校准后的值与量程阈值比较。
+ *
+ * @param  aht21_instance  aht21实例
+ * @param  code            测量结果码
+ * @param  raw             成功时的原始数据 失败时为NULL
+ */
+static void aht21_health_record(bsp_aht21_t *aht21_instance, int8_t code, const aht21_raw_data_t *raw)
+{
+    aht21_health_input_t in;
+    in.tick = aht21_instance->meas_start_tick;
+    in.code = code;
+    in.comm_errors = aht21_instance->fault_stats.nack + aht21_instance->fault_stats.timeout;
+    in.crc_errors = aht21_instance->crc_fail_count;
+    in.temp_raw = 0;
+    in.humi_raw = 0;
+    in.temp = 0;
+    in.humi = 0;
+    if (raw != NULL)
+    {
+        in.temp_raw = raw->temp_raw;
+        in.humi_raw = raw->humi_raw;
+        aht21_comp_calibrate(&aht21_instance->calib,
+                             aht21_raw_to_temp_centi(raw->temp_raw),
+                             aht21_raw_to_humi_centi(raw->humi_raw),
+                             &in.temp, &in.humi);
+    }
+    aht21_health_update(&aht21_instance->health, &in);
+}
+
+/**
+ * @brief  设置健康检测阈值 同时清除健康统计
+ *
+ * @param  aht21_instance  aht21实例
+ * @param  cfg             阈值 NULL时恢复默认
+ * @return 0 success
+ */
+int8_t aht21_set_health_cfg(bsp_aht21_t *aht21_instance, const aht21_health_cfg_t *cfg)
+{
+    if (aht21_instance == NULL)
+    {
+        return RET_CODE_ERROR_AHT21_INSTANCE_NULL;
+    }
+    aht21_health_reset(&aht21_instance->health, cfg);
+    return RET_CODE_SUCCESS;
+}
+
+/**
+ * @brief  获取健康状态及统计
+ *
+ * @param  aht21_instance  aht21实例
+ * @param  health          输出
+ * @return 0 success
+ */
+int8_t aht21_get_health(bsp_aht21_t *aht21_instance, aht21_health_t *health)
+{
+    if (aht21_instance == NULL)
+    {
+        return RET_CODE_ERROR_AHT21_INSTANCE_NULL;
+    }
+    if (health == NULL)
+    {
+        return RET_CODE_ERROR_PARAM_NULL;
+    }
+    *health = aht21_instance->health;
+    return RET_CODE_SUCCESS;
+}
+#endif
+
+/**
+ * @brief  把实例当前的健康状态写入样本
+ *
+ * @param  aht21_instance  aht21实例
+ * @param  sample          样本
+ */
+static void aht21_sample_health(const bsp_aht21_t *aht21_instance, aht21_sample_t *sample)
+{
+#if AHT21_CFG_HEALTH
+    sample->health = aht21_instance->health.state;
+    sample->health_flags = aht21_instance->health.flags;
+#else
+    (void)aht21_instance;
+    sample->health = AHT21_HEALTH_UNKNOWN;
+    sample->health_flags = 0;
+#endif
+}
+
+/**
+ * @brief  读取已完成转换的温度/湿度 浮点格式
+ *
+ * @param  aht21_instance  aht21实例
+ * @param  temp            温度输出(摄氏度)
+ * @param  humi            湿度输出(百分比)
+ * @return 同aht21_fetch_raw
+ */
+int8_t aht21_fetch(bsp_aht21_t *aht21_instance, float *temp, float *humi)
+{
+    if (temp == NULL || humi == NULL)
+    {
+        return RET_CODE_ERROR_PARAM_NULL;
+    }
+    aht21_raw_data_t raw;
+    int8_t code = aht21_fetch_raw(aht21_instance, &raw);
+    if (code != RET_CODE_SUCCESS)
+    {
+        return code;
+    }
+    aht21_raw_to_output(aht21_instance, &raw, temp, humi);
+    return RET_CODE_SUCCESS;
+}
+
+/**
+ * @brief  读取已完成转换的数据到样本 时间戳为触发时刻
+ *
+ * @param  aht21_instance  aht21实例
+ * @param  sample          样本输出 失败时温湿度为0 结果码记录在sample->code
+ * @return 同aht21_fetch_raw RET_CODE_AHT21_BUSY时不修改sample
+ */
+int8_t aht21_fetch_sample(bsp_aht21_t *aht21_instance, aht21_sample_t *sample)
+{
+    if (aht21_instance == NULL)
+    {
+        return RET_CODE_ERROR_AHT21_INSTANCE_NULL;
+    }
+    if (sample == NULL)
+    {
+        return RET_CODE_ERROR_PARAM_NULL;
+    }
+    aht21_raw_data_t raw;
+    int8_t code = aht21_fetch_raw(aht21_instance, &raw);
+    if (code == RET_CODE_AHT21_BUSY)
+    {
+        return code;
+    }
+    sample->seq = 0;
+    sample->timestamp = aht21_instance->meas_start_tick;
+    sample->code = code;
+    aht21_sample_health(aht21_instance, sample);
+    if (code == RET_CODE_SUCCESS)
+    {
+        aht21_raw_to_output(aht21_instance, &raw, &sample->temp, &sample->humi);
+    }
+    else
+    {
+        sample->temp = 0.0f;
+        sample->humi = 0.0f;
+    }
+    return code;
+}
+
+/**
+ * @brief  触发测量并阻塞等待原始数据 转换期间睡眠
+ *
+ * @param  aht21_instance  aht21实例
+ * @param  raw             原始数据输出
+ * @return 0 success 其他参考error_codes.h
+ */
+static int8_t aht21_measure_raw(bsp_aht21_t *aht21_instance, aht21_raw_data_t *raw)
+{
+    int8_t code = aht21_start(aht21_instance);
+    if (code != RET_CODE_SUCCESS)
+    {
+        return code;
+    }
+    do
+    {
+        // 睡眠到预计完成(或下一次查询)时刻 不提前读取
+        while ((code = aht21_poll_ready(aht21_instance)) == RET_CODE_AHT21_BUSY)
+        {
+            aht21_wait_until(aht21_instance, aht21_instance->meas_deadline);
+        }
+        if (code != RET_CODE_SUCCESS)
+        {
+            return code;
+        }
+        code = aht21_fetch_raw(aht21_instance, raw);
+    } while (code == RET_CODE_AHT21_BUSY);
+    return code;
+}
+
+/**
+ * @brief  读取温度/湿度 阻塞直到转换完成
+ *
+ * 由aht21_start/aht21_poll_ready/aht21_fetch组合而成,转换期间通过aht21_wait_until睡眠。
+ * 需要同时驱动多个传感器时应直接使用拆分接口。
+ *
+ * @param  aht21_instance  aht21实例
+ * @param  temp            温度输出(摄氏度)
+ * @param  humi            湿度输出(百分比)
+ * @return 0 success 其他参考error_codes.h
+ */
+int8_t aht21_read_data(bsp_aht21_t *aht21_instance, float *temp, float *humi)
+{
+    if (temp == NULL || humi == NULL)
+    {
+        return RET_CODE_ERROR_PARAM_NULL;
+    }
+    aht21_raw_data_t raw;
+    int8_t code = aht21_measure_raw(aht21_instance, &raw);
+    if (code != RET_CODE_SUCCESS)
+    {
+        return code;
+    }
+    aht21_raw_to_output(aht21_instance, &raw, temp, humi);
+    return RET_CODE_SUCCESS;
+}
+
+/**
+ * @brief  按固定周期连续采集n个样本 写入调用者提供的数组
+ *
+ * 第i个样本在 首次调用时刻 + i * period_ms 触发,时间戳为触发时刻。
+ * 周期小于转换时间时样本背靠背采集。单个样本失败不会中断采集,
+ * 失败原因记录在该样本的code中。
+ *
+ * @param  aht21_instance  aht21实例
+ * @param  out             样本数组 至少n个元素
+ * @param  n               样本数
+ * @param  period_ms       采样周期
+ * @return 0 全部成功
+ *         其他 第一个失败样本的结果码
+ */
+int8_t aht21_read_burst(bsp_aht21_t *aht21_instance, aht21_sample_t *out, uint16_t n, uint32_t period_ms)
+{
+    if (aht21_instance == NULL)
+    {
+        return RET_CODE_ERROR_AHT21_INSTANCE_NULL;
+    }
+    if (out == NULL || n == 0)
+    {
+        return RET_CODE_ERROR_PARAM_NULL;
+    }
+    int8_t first_error = RET_CODE_SUCCESS;
+    uint32_t deadline = AHT21_GET_TICK(aht21_instance);
+    for (uint16_t i = 0; i < n; i++)
+    {
+        // 睡眠到本样本触发时刻
+        aht21_wait_until(aht21_instance, deadline);
+        aht21_raw_data_t raw;
+        aht21_sample_t *sample = &out[i];
+        sample->seq = 0;
+        sample->timestamp = AHT21_GET_TICK(aht21_instance);
+        sample->code = aht21_measure_raw(aht21_instance, &raw);
+        aht21_sample_health(aht21_instance, sample);
+        if (sample->code == RET_CODE_SUCCESS)
+        {
+            aht21_raw_to_output(aht21_instance, &raw, &sample->temp, &sample->humi);
+        }
+        else
+        {
+            sample->temp = 0.0f;
+            sample->humi = 0.0f;
+            if (first_error == RET_CODE_SUCCESS)
+            {
+                first_error = sample->code;
+            }
+        }
+        deadline += period_ms;
+    }
+    return first_error;
+}
+
+/**
+ * @brief  进入休眠模式
+ *
+ * AHT21在每次测量结束后自动进入低功耗状态,没有单独的休眠命令。
+ * 配置了供电开关时关闭传感器供电,否则只记录状态。
+ *
+ * @param  aht21_instance  aht21实例
+ * @return 0 success
+ *         RET_CODE_AHT21_STATE_ERROR 正在转换
+ */
+int8_t aht21_sleep(bsp_aht21_t *aht21_instance)
+{
+    if (aht21_instance == NULL)
+    {
+        return RET_CODE_ERROR_AHT21_INSTANCE_NULL;
+    }
+    if (aht21_instance->meas_state == AHT21_MEAS_STATE_CONVERTING)
+    {
+        return RET_CODE_AHT21_STATE_ERROR;
+    }
+    if (aht21_instance->pfpower != NULL && !aht21_instance->sleeping)
+    {
+        int8_t code = aht21_instance->pfpower(false);
+        if (code != RET_CODE_SUCCESS)
+        {
+            return code;
+        }
+    }
+    aht21_instance->meas_state = AHT21_MEAS_STATE_IDLE;
+    aht21_instance->sleeping = true;
+    return RET_CODE_SUCCESS;
+}
+
+/**
+ * @brief  唤醒AHT21 不阻塞
+ *
+ * 配置了供电开关时重新上电,wake_deadline设为上电后AHT21_INIT_DELAY_MS,
+ * 调用者需在该时刻之后调用aht21_init再开始测量。
+ *
+ * @param  aht21_instance  aht21实例
+ * @return 0 success
+ */
+int8_t aht21_wakeup(bsp_aht21_t *aht21_instance)
+{
+    if (aht21_instance == NULL)
+    {
+        return RET_CODE_ERROR_AHT21_INSTANCE_NULL;
+    }
+    uint32_t now = AHT21_GET_TICK(aht21_instance);
+    aht21_instance->wake_deadline = now;
+    if (aht21_instance->pfpower != NULL && aht21_instance->sleeping)
+    {
+        int8_t code = aht21_instance->pfpower(true);
+        if (code != RET_CODE_SUCCESS)
+        {
+            return code;
+        }
+        aht21_instance->wake_deadline = now + AHT21_INIT_DELAY_MS;
+    }
+    aht21_instance->sleeping = false;
+    return RET_CODE_SUCCESS;
+}
+
+/**
+ * @brief  设置传感器供电开关
+ *
+ * @param  aht21_instance  aht21实例
+ * @param  pfpower         供电开关 NULL表示常供电
+ * @return 0 success
+ */
+int8_t aht21_set_power_hook(bsp_aht21_t *aht21_instance, int8_t (*pfpower)(bool on))
+{
+    if (aht21_instance == NULL)
+    {
+        return RET_CODE_ERROR_AHT21_INSTANCE_NULL;
+    }
+    aht21_instance->pfpower = pfpower;
+    return RET_CODE_SUCCESS;
+}
+
+/**
+ * @brief  等待到绝对时刻 优先使用周期配置的pfsleep_until
+ *
+ * @param  aht21_instance  aht21实例
+ * @param  periodic        周期采样配置
+ * @param  deadline        绝对时刻
+ */
+static void aht21_periodic_wait(bsp_aht21_t *aht21_instance, const aht21_periodic_t *periodic, uint32_t deadline)
+{
+    if (periodic->pfsleep_until == NULL)
+    {
+        aht21_wait_until(aht21_instance, deadline);
+        return;
+    }
+    while (!AHT21_TICK_REACHED(AHT21_GET_TICK(aht21_instance), deadline))
+    {
+        periodic->pfsleep_until(deadline);
+    }
+}
+
+/**
+ * @brief  启动周期采样 第一个周期从当前时刻开始
+ *
+ * @param  aht21_instance  aht21实例
+ * @param  periodic        周期采样配置
+ * @param  period_ms       采样周期
+ * @param  pfsleep_until   任务睡眠到绝对时刻的函数 如vTaskDelayUntil的封装
+ * @return 0 success
+ */
+int8_t aht21_periodic_start(bsp_aht21_t *aht21_instance, aht21_periodic_t *periodic,
+                            uint32_t period_ms, void (*pfsleep_until)(uint32_t deadline_tick))
+{
+    if (aht21_instance == NULL)
+    {
+        return RET_CODE_ERROR_AHT21_INSTANCE_NULL;
+    }
+    if (periodic == NULL || period_ms == 0)
+    {
+        return RET_CODE_ERROR_PARAM_NULL;
+    }
+    periodic->period_ms = period_ms;
+    periodic->next_deadline = AHT21_GET_TICK(aht21_instance);
+    periodic->missed = 0;
+    periodic->pfsleep_until = pfsleep_until;
+    return RET_CODE_SUCCESS;
+}
+
+/**
+ * @brief  执行一个采样周期
+ *
+ * 睡眠到本周期的绝对时刻 -> 唤醒传感器 -> 触发测量 -> 睡眠到转换完成 ->
+ * 取数 -> 传感器休眠。下一周期时刻在上一周期时刻上累加,不随处理耗时漂移;
+ * 处理耗时超过周期时跳过已错过的周期并计入missed。
+ *
+ * @param  aht21_instance  aht21实例
+ * @param  periodic        周期采样配置
+ * @param  sample          样本输出 时间戳为本周期时刻
+ * @return 0 success 其他参考error_codes.h
+ */
+int8_t aht21_periodic_step(bsp_aht21_t *aht21_instance, aht21_periodic_t *periodic, aht21_sample_t *sample)
+{
+    if (aht21_instance == NULL)
+    {
+        return RET_CODE_ERROR_AHT21_INSTANCE_NULL;
+    }
+    if (periodic == NULL || sample == NULL)
+    {
+        return RET_CODE_ERROR_PARAM_NULL;
+    }
+    aht21_periodic_wait(aht21_instance, periodic, periodic->next_deadline);
+    sample->seq = 0;
+    sample->timestamp = periodic->next_deadline;
+
+    int8_t code = aht21_wakeup(aht21_instance);
+    if (code == RET_CODE_SUCCESS && aht21_instance->pfpower != NULL)
+    {
+        // 重新上电后等待上电时间并重新初始化
+        aht21_periodic_wait(aht21_instance, periodic, aht21_instance->wake_deadline);
+        code = aht21_init(aht21_instance);
+    }
+    if (code == RET_CODE_SUCCESS)
+    {
+        code = aht21_start(aht21_instance);
+    }
+    aht21_raw_data_t raw;
+    while (code == RET_CODE_SUCCESS)
+    {
+        // 睡眠到预计完成时刻(自适应模式下为下一次查询时刻)
+        while ((code = aht21_poll_ready(aht21_instance)) == RET_CODE_AHT21_BUSY)
+        {
+            aht21_periodic_wait(aht21_instance, periodic, aht21_instance->meas_deadline);
+        }
+        if (code != RET_CODE_SUCCESS)
+        {
+            break;
+        }
+        code = aht21_fetch_raw(aht21_instance, &raw);
+        if (code != RET_CODE_AHT21_BUSY)
+        {
+            break;
+        }
+        code = RET_CODE_SUCCESS;
+    }
+    sample->code = code;
+    aht21_sample_health(aht21_instance, sample);
+    if (code == RET_CODE_SUCCESS)
+    {
+        aht21_raw_to_output(aht21_instance, &raw, &sample->temp, &sample->humi);
+    }
+    else
+    {
+        sample->temp = 0.0f;
+        sample->humi = 0.0f;
+    }
+    aht21_sleep(aht21_instance);
+
+    // 按绝对时刻推进 跳过已错过的周期 恰好到期的周期照常执行
+    periodic->next_deadline += periodic->period_ms;
+    uint32_t now = AHT21_GET_TICK(aht21_instance);
+    if (AHT21_TICK_PASSED(now, periodic->next_deadline))
+    {
+        uint32_t skip = (now - periodic->next_deadline + periodic->period_ms - 1U) / periodic->period_ms;
+        periodic->next_deadline += skip * periodic->period_ms;
+        periodic->missed += skip;
+    }
+    return code;
 }
@@ -1,5 +1,12 @@
 #include "ec_bsp_aht21_handler.h"
+#include "ec_bsp_aht21_latest.h"
+#include "ec_bsp_aht21_history.h"
+#include "stm32f4xx_hal.h"
+#include "FreeRTOS.h"
 #include "task.h"
+#include "queue.h"
+#include "semphr.h"
+#include "stream_buffer.h"
 /**
  * @brief 初始化 AHT21 温湿度传感器模块的实例
  *
@@ -27,12 +34,89 @@
  * @attention 这个接口提供给OS 来进行Handler初始化
  * @return 0 表示成功，其他值表示失败
  */
-// 维护一个全局温度度数据队列
-static temp_humi_event_t g_spk_event_array[10] = {NULL};
+// 等待同一次转换的请求 按最早时限优先排列 时限相同时priority大的在前 再按到达顺序
+typedef struct
+{
+    temp_humi_request_t req[AHT21_HANDLER_QUEUE_LEN];
+    uint8_t count;
+    uint8_t fail_run; // 连续转换失败次数
+} temp_humi_batch_t;
+
+// 订阅槽状态
+typedef enum
+{
+    TEMP_HUMI_SUB_FREE = 0, // 空闲
+    TEMP_HUMI_SUB_RESERVED, // 订阅方正在填写
+    TEMP_HUMI_SUB_NEW,      // 已填写 等待handler线程安排首次采样
+    TEMP_HUMI_SUB_ACTIVE,   // 生效中
+    TEMP_HUMI_SUB_CLOSING,  // 已取消 等待handler线程回收 期间不会被重新占用
+} temp_humi_sub_state_t;
+
+// 订阅者
+typedef struct
+{
+    temp_humi_subscribe_t cfg;
+    uint32_t next_due;       // 下一次投递的绝对时刻(驱动时基)
+    uint32_t missed;         // 因转换耗时跳过的周期数
+    uint32_t dropped;        // 目标队列/流缓冲区已满而丢弃的样本数
+    volatile uint8_t state;  // temp_humi_sub_state_t
+} temp_humi_subscriber_t;
+
+// 最新样本 采样线程发布 请求方和中断按值读取
+static aht21_latest_t g_aht21_latest;
+// 历史样本 采样线程写入 查询方不加锁复制
+static aht21_history_t g_aht21_history;
+// 当前批次 只由handler线程访问
+static temp_humi_batch_t g_temp_humi_batch;
+// 订阅表 订阅方只写FREE/RESERVED状态的槽及把NEW/ACTIVE改为CLOSING 其余由handler线程访问
+static temp_humi_subscriber_t g_temp_humi_subs[AHT21_HANDLER_SUB_MAX];
+// 已完成构造的handler 请求方经由其queue_event投递请求
+static bsp_aht21_handler_t *g_aht21_handler = NULL;
+// 指标由请求方任务和handler线程共同更新 在临界区内修改 handler运行前不统计
+#define TEMP_HUMI_METRICS_UPDATE(stmt)                            \
+    do                                                            \
+    {                                                             \
+        if (NULL != g_aht21_handler)                              \
+        {                                                         \
+            aht21_metrics_t *metrics = &g_aht21_handler->metrics; \
+            taskENTER_CRITICAL();                                 \
+            stmt;                                                 \
+            taskEXIT_CRITICAL();                                  \
+        }                                                         \
+    } while (0)
+
+// 最近转换耗时的估计(ms) handler线程更新 请求方据此判断时限能否满足
+static volatile uint32_t g_temp_humi_conv_ms = AHT21_MEASUREMENT_DELAY_MS;
+#if AHT21_HANDLER_STATIC_ALLOC
+// temp_humi_handler_start提供的RTOS对象存储
+static temp_humi_handler_storage_t *g_temp_humi_storage = NULL;
+#endif
+
+// 本模块静态变量占用的RAM 编译期确定 可在map文件中查看
+#define AHT21_HANDLER_MODULE_RAM                                          \
+    (sizeof(g_aht21_latest) + sizeof(g_aht21_history) +                   \
+     sizeof(g_temp_humi_batch) + sizeof(g_temp_humi_subs) + sizeof(g_aht21_handler))
+const uint32_t g_temp_humi_handler_ram = AHT21_HANDLER_MODULE_RAM;
+
+#ifdef AHT21_HANDLER_RAM_BUDGET
+// 超出预算时数组长度为负 编译失败
+#if AHT21_HANDLER_STATIC_ALLOC
+typedef char aht21_handler_ram_budget_check[
+    (AHT21_HANDLER_MODULE_RAM + AHT21_HANDLER_STORAGE_RAM <= AHT21_HANDLER_RAM_BUDGET) ? 1 : -1];
+#else
+typedef char aht21_handler_ram_budget_check[(AHT21_HANDLER_MODULE_RAM <= AHT21_HANDLER_RAM_BUDGET) ? 1 : -1];
+#endif
+#endif
+
+static void temp_humi_batch_insert(const temp_humi_request_t *request);
+static TickType_t temp_humi_sub_wait_ticks(bsp_aht21_handler_t *aht21_handler_instance);
+static void temp_humi_sub_serve(bsp_aht21_handler_t *aht21_handler_instance);
+static void temp_humi_batch_serve(bsp_aht21_handler_t *aht21_handler_instance);
+
 void temp_humi_handler_thread(bsp_AHT21_handler_arg_struct *bsp_AHT21_handler_arg_instance)
 {
     // 驱动实例声明
-    bsp_aht21_t *aht21_instance;
+    bsp_aht21_t aht21_instance;
     // 结构体声明
     bsp_aht21_handler_t aht21_handler_instance = {
         .insted = false,
@@ -46,20 +130,33 @@ void temp_humi_handler_thread(bsp_AHT21_handler_arg_struct *bsp_AHT21_handler_ar
         .queue_event = NULL,
         .aht21_instance = NULL,
         .thread_os = NULL};
-    aht21_handler_instance.aht21_instance = aht21_instance;
+    aht21_handler_instance.aht21_instance = &aht21_instance;
+    aht21_latest_init(&g_aht21_latest);
+    aht21_history_init(&g_aht21_history);
     // 调用handler构造函数
     int8_t code = aht21_handler_inst(bsp_AHT21_handler_arg_instance, &aht21_handler_instance, &aht21_instance);
     if (code != RET_CODE_SUCCESS)
     {
-        // 构造失败 执行逆初始化和解构函数
-        aht21_handler_deinit(&aht21_handler_instance, &aht21_instance);
-        aht21_handler_deinst(&aht21_handler_instance, &aht21_instance);
-        return code;
+        // 构造失败 执行解构函数(包含逆初始化) 任务不能返回 删除自身
+        aht21_handler_deInst(&aht21_handler_instance);
+        vTaskDelete(NULL);
+        return;
     }
-    // 创建任务
+    g_aht21_handler = &aht21_handler_instance;
+    // 按订阅周期和请求触发转换并分发结果
     for (;;)
     {
-
+        // 没有待处理请求时阻塞在请求队列上直到下一个订阅时刻 空闲时不占用cpu
+        temp_humi_request_t request;
+        if (g_temp_humi_batch.count == 0 &&
+            xQueueReceive(aht21_handler_instance.queue_event, &request,
+                          temp_humi_sub_wait_ticks(&aht21_handler_instance)) == pdPASS &&
+            request.event != NULL)
+        {
+            temp_humi_batch_insert(&request);
+        }
+        temp_humi_sub_serve(&aht21_handler_instance);
+        temp_humi_batch_serve(&aht21_handler_instance);
     }
 }
 
@@ -73,22 +170,15 @@ static int8_t aht21_handler_inst(bsp_AHT21_handler_arg_struct *bsp_AHT21_handler
         // 已完成初始化
         return RET_CODE_HAS_BEEN_INITED;
     }
-    // 入参校验
-    if (NULL == bsp_AHT21_handler_arg_instance ||
-        NULL == bsp_AHT21_handler_arg_instance->iic_driver_interface_table ||
-        NULL == bsp_AHT21_handler_arg_instance->rtos_yeild ||
-        NULL == bsp_AHT21_handler_arg_instance->timebase)
-    {
-        return RET_CODE_ERROR_PARAM_NULL;
-    }
-    // 进行handler初始化 完成模块驱动实例挂载
-    int8_t code = aht21_handler_init(&bsp_AHT21_handler_arg_instance, &bsp_aht21_handler_instance);
+    // 进行handler初始化 完成模块驱动实例挂载 入参在其中校验
+    int8_t code = aht21_handler_init(bsp_AHT21_handler_arg_instance, bsp_aht21_handler_instance);
     if (code != 0)
     {
         // init failure
         return code;
     }
-    bsp_aht21_handler_instance->thread_os = true;
+    // 记录handler线程 构造在线程内执行
+    bsp_aht21_handler_instance->thread_os = xTaskGetCurrentTaskHandle();
     // inst success
     return RET_CODE_SUCCESS;
 }
@@ -109,42 +199,63 @@ static int8_t aht21_handler_init(bsp_AHT21_handler_arg_struct *bsp_AHT21_handler
     {
         return RET_CODE_HAS_BEEN_INITED;
     }
-    // 入参校验
+    // 入参校验 时基提供pfwait_until时可不提供rtos_yeild(与aht21_inst一致)
     if (NULL == bsp_AHT21_handler_arg_instance ||
         NULL == bsp_AHT21_handler_arg_instance->iic_driver_interface_table ||
-        NULL == bsp_AHT21_handler_arg_instance->rtos_yeild ||
-        NULL == bsp_AHT21_handler_arg_instance->timebase)
+        NULL == bsp_AHT21_handler_arg_instance->timebase ||
+        (NULL == bsp_AHT21_handler_arg_instance->rtos_yeild &&
+         NULL == bsp_AHT21_handler_arg_instance->timebase->pfwait_until))
     {
         // 参数为空
         return RET_CODE_ERROR_PARAM_NULL;
     }
 
-    // 初始化队列
-    bsp_aht21_handler_instance->queue_event = xQueueCreate(10, sizeof(int));
+    // 初始化队列和互斥量
+#if AHT21_HANDLER_STATIC_ALLOC
+    temp_humi_handler_storage_t *storage = g_temp_humi_storage;
+    if (NULL == storage)
+    {
+        return RET_CODE_ERROR_PARAM_NULL;
+    }
+    bsp_aht21_handler_instance->queue_event = xQueueCreateStatic(AHT21_HANDLER_QUEUE_LEN, sizeof(temp_humi_request_t),
+                                                                 storage->queue_storage, &storage->queue);
+#else
+    bsp_aht21_handler_instance->queue_event = xQueueCreate(AHT21_HANDLER_QUEUE_LEN, sizeof(temp_humi_request_t));
+#endif
     if (NULL == bsp_aht21_handler_instance->queue_event)
     {
         return RET_CODE_QUEUE_EVENT_NULL;
     }
+#if AHT21_HANDLER_STATIC_ALLOC
+    bsp_aht21_handler_instance->init_lock = xSemaphoreCreateMutexStatic(&storage->init_lock);
+#else
+    bsp_aht21_handler_instance->init_lock = xSemaphoreCreateMutex();
+#endif
+    if (NULL == bsp_aht21_handler_instance->init_lock)
+    {
+        vQueueDelete(bsp_aht21_handler_instance->queue_event);
+        bsp_aht21_handler_instance->queue_event = NULL;
+        return RET_CODE_XSEMAPHORETAKE_FAIL;
+    }
 
-    // 获取信号量
+    // 获取信号量 驱动构造与初始化期间持有
     if (xSemaphoreTake(bsp_aht21_handler_instance->init_lock, portMAX_DELAY) != pdTRUE)
     {
-        vSemaphoreDelete(bsp_aht21_handler_instance->init_lock);
-        vQueueDelete(bsp_aht21_handler_instance->queue_event);
         return RET_CODE_XSEMAPHORETAKE_FAIL;
     }
-    xSemaphoreGive(bsp_aht21_handler_instance->init_lock);
     // 调用AHT21驱动构造函数
     int8_t code = aht21_inst(bsp_aht21_handler_instance->aht21_instance, bsp_AHT21_handler_arg_instance->iic_driver_interface_table, bsp_AHT21_handler_arg_instance->timebase, bsp_AHT21_handler_arg_instance->rtos_yeild);
     // 构造失败
     if (code != 0)
     {
         // 温湿度模块构造失败
+        xSemaphoreGive(bsp_aht21_handler_instance->init_lock);
         return code;
     }
 
     // AHT21_driver INIT
     code = aht21_init(bsp_aht21_handler_instance->aht21_instance);
+    xSemaphoreGive(bsp_aht21_handler_instance->init_lock);
     if (code != 0)
     {
         // init failure
@@ -204,61 +315,725 @@ static int8_t aht21_handler_deInit(bsp_aht21_handler_t *bsp_aht21_handler_instan
 {
     if (NULL != bsp_aht21_handler_instance)
     {
-        vSemaphoreDelete(bsp_aht21_handler_instance->init_lock);
-        vQueueDelete(bsp_aht21_handler_instance->queue_event);
+        // 只释放已创建的对象 静态创建的对象删除后存储归还调用方
+        if (NULL != bsp_aht21_handler_instance->init_lock)
+        {
+            vSemaphoreDelete(bsp_aht21_handler_instance->init_lock);
+            bsp_aht21_handler_instance->init_lock = NULL;
+        }
+        if (NULL != bsp_aht21_handler_instance->queue_event)
+        {
+            vQueueDelete(bsp_aht21_handler_instance->queue_event);
+            bsp_aht21_handler_instance->queue_event = NULL;
+        }
     }
     bsp_aht21_handler_instance = NULL;
     return RET_CODE_SUCCESS;
 }
 
 /**
- * @param event  temp_humi_event_t 实例
- * @attention 接收参数来提供温湿度
- * @return 0 表示成功，其他值表示失败
+ * @brief 样本是否满足请求的时效
+ *
+ * @param sample      样本
+ * @param not_before  请求时刻 - lifetime
+ * @return true 样本触发时刻不早于not_before
  */
-int8_t temp_humi_event_handler_send(temp_humi_event_t *event)
+static bool temp_humi_sample_fresh(const aht21_sample_t *sample, uint32_t not_before)
 {
-    if (NULL == event)
+    return (int32_t)(sample->timestamp - not_before) >= 0;
+}
+
+/**
+ * @brief 按请求类型写出样本 并调用回调函数
+ *
+ * 样本按值复制到event->sample；未提供记录时回调直接借用handler的样本，
+ * 只在回调期间有效。未请求的一项为0。
+ *
+ * @param event   请求事件
+ * @param sample  样本
+ */
+static void temp_humi_event_deliver(temp_humi_event_t *event, const aht21_sample_t *sample)
+{
+    const aht21_sample_t *out = sample;
+    aht21_sample_t filtered;
+    if (event->type_of_data != TEMP_HUMI_EVENT_TYPE_BOTH)
     {
-        return RET_CODE_ERROR_PARAM_NULL;
+        filtered = *sample;
+        if (event->type_of_data == TEMP_HUMI_EVENT_TYPE_TEMP)
+        {
+            filtered.humi = 0.0f;
+        }
+        else
+        {
+            filtered.temp = 0.0f;
+        }
+        out = &filtered;
+    }
+    if (NULL != event->sample)
+    {
+        *event->sample = *out;
+        out = event->sample;
+    }
+    if (NULL != event->callback)
+    {
+        event->callback(out, event->arg);
+    }
+}
+
+/**
+ * @brief 毫秒换算为节拍 向上取整 不提前醒来
+ */
+static TickType_t temp_humi_ms_to_ticks(uint32_t ms)
+{
+    return (TickType_t)(((uint64_t)ms * configTICK_RATE_HZ + 999U) / 1000U);
+}
+
+/**
+ * @brief 请求a是否应排在b之前
+ */
+static bool temp_humi_request_before(const temp_humi_request_t *a, const temp_humi_request_t *b)
+{
+    int32_t diff = (int32_t)(a->deadline - b->deadline);
+    if (diff != 0)
+    {
+        return diff < 0;
+    }
+    return a->priority > b->priority;
+}
+
+/**
+ * @brief 按时限把请求插入当前批次 批次最多AHT21_HANDLER_QUEUE_LEN个
+ *
+ * @param request 请求
+ */
+static void temp_humi_batch_insert(const temp_humi_request_t *request)
+{
+    temp_humi_batch_t *batch = &g_temp_humi_batch;
+    uint8_t i = batch->count;
+    // 相等时排在已有请求之后 保持到达顺序
+    while (i > 0 && temp_humi_request_before(request, &batch->req[i - 1]))
+    {
+        batch->req[i] = batch->req[i - 1];
+        i--;
     }
-    // 声明返回对象
-    temp_humi_event_t event_result;
-    // 查看请求事件时效
-    if (NULL != event->lifetime && g_spk_event_array)
+    batch->req[i] = *request;
+    batch->count++;
+    TEMP_HUMI_METRICS_UPDATE(aht21_metrics_hwm(&metrics->batch_hwm, batch->count));
+}
+
+/**
+ * @brief 把queue_event中的请求移入当前批次 不阻塞
+ *
+ * @param aht21_handler_instance AHT21 Handler 实例
+ */
+static void temp_humi_batch_collect(bsp_aht21_handler_t *aht21_handler_instance)
+{
+    temp_humi_batch_t *batch = &g_temp_humi_batch;
+    temp_humi_request_t request;
+    while (batch->count < AHT21_HANDLER_QUEUE_LEN &&
+           xQueueReceive(aht21_handler_instance->queue_event, &request, 0) == pdPASS)
+    {
+        // event为NULL的消息只用于唤醒handler线程
+        if (request.event != NULL)
+        {
+            temp_humi_batch_insert(&request);
+        }
+    }
+}
+
+/**
+ * @brief 阻塞到转换deadline 期间到达的请求并入当前批次
+ *
+ * @param aht21_handler_instance AHT21 Handler 实例
+ * @param deadline               驱动时基下的绝对时刻
+ */
+static void temp_humi_batch_wait(bsp_aht21_handler_t *aht21_handler_instance, uint32_t deadline)
+{
+    temp_humi_batch_t *batch = &g_temp_humi_batch;
+    bsp_aht21_t *aht21_instance = aht21_handler_instance->aht21_instance;
+    uint32_t now = AHT21_GET_TICK(aht21_instance);
+    if (AHT21_TICK_REACHED(now, deadline))
+    {
+        return;
+    }
+    TickType_t ticks = temp_humi_ms_to_ticks(deadline - now);
+    if (batch->count >= AHT21_HANDLER_QUEUE_LEN)
+    {
+        vTaskDelay(ticks);
+        return;
+    }
+    // 与temp_humi_batch_collect相同 按时限插入 保持批次有序
+    temp_humi_request_t request;
+    if (xQueueReceive(aht21_handler_instance->queue_event, &request, ticks) == pdPASS &&
+        request.event != NULL)
+    {
+        temp_humi_batch_insert(&request);
+    }
+}
+
+/**
+ * @brief 执行一次转换 转换期间阻塞在请求队列上
+ *
+ * @param aht21_handler_instance AHT21 Handler 实例
+ * @param sample                 样本输出
+ * @return 0 表示成功，其他值参考error_codes.h
+ */
+static int8_t temp_humi_batch_convert(bsp_aht21_handler_t *aht21_handler_instance, aht21_sample_t *sample)
+{
+    bsp_aht21_t *aht21_instance = aht21_handler_instance->aht21_instance;
+    int8_t code = aht21_start(aht21_instance);
+    while (code == RET_CODE_SUCCESS)
+    {
+        while ((code = aht21_poll_ready(aht21_instance)) == RET_CODE_AHT21_BUSY)
+        {
+            temp_humi_batch_wait(aht21_handler_instance, aht21_instance->meas_deadline);
+        }
+        if (code != RET_CODE_SUCCESS)
+        {
+            break;
+        }
+        code = aht21_fetch_sample(aht21_instance, sample);
+        if (code != RET_CODE_AHT21_BUSY)
+        {
+            break;
+        }
+        code = RET_CODE_SUCCESS;
+    }
+    return code;
+}
+
+/**
+ * @brief 以失败码结束一个请求 回调收到code为失败码、温湿度为0的样本
+ *
+ * @param event  请求事件
+ * @param code   结果码
+ * @param tick   样本时间戳
+ */
+static void temp_humi_event_fail(temp_humi_event_t *event, int8_t code, uint32_t tick)
+{
+    aht21_sample_t failed;
+    memset(&failed, 0, sizeof(failed));
+    failed.timestamp = tick;
+    failed.code = code;
+    temp_humi_event_deliver(event, &failed);
+}
+
+/**
+ * @brief 拒绝批次中在deadline前无法完成的请求
+ *
+ * 被拒绝的请求收到结果码为RET_CODE_AHT21_DEADLINE的样本。
+ *
+ * @param done  下一次转换预计完成时刻
+ */
+static void temp_humi_batch_expire(uint32_t done)
+{
+    temp_humi_batch_t *batch = &g_temp_humi_batch;
+    uint8_t keep = 0;
+    for (uint8_t i = 0; i < batch->count; i++)
+    {
+        temp_humi_request_t *req = &batch->req[i];
+        if (req->hard && (int32_t)(done - req->deadline) > 0)
+        {
+            temp_humi_event_fail(req->event, RET_CODE_AHT21_DEADLINE, done);
+            TEMP_HUMI_METRICS_UPDATE(metrics->rejected_deadline++);
+        }
+        else
+        {
+            batch->req[keep++] = *req;
+        }
+    }
+    batch->count = keep;
+}
+
+/**
+ * @brief 用样本满足批次中时效符合的请求 按批次顺序(最早时限优先)回调
+ *
+ * 不满足的请求保持原有顺序留在批次中 等待下一次转换。
+ *
+ * @param aht21_handler_instance handler实例 延迟按驱动时基计算
+ * @param sample 样本
+ */
+static void temp_humi_batch_dispatch(bsp_aht21_handler_t *aht21_handler_instance,
+                                     const aht21_sample_t *sample)
+{
+    temp_humi_batch_t *batch = &g_temp_humi_batch;
+    uint8_t keep = 0;
+    for (uint8_t i = 0; i < batch->count; i++)
+    {
+        if (batch->req[i].any || temp_humi_sample_fresh(sample, batch->req[i].not_before))
+        {
+            temp_humi_event_deliver(batch->req[i].event, sample);
+            uint32_t latency = AHT21_GET_TICK(aht21_handler_instance->aht21_instance) - batch->req[i].arrival;
+            TEMP_HUMI_METRICS_UPDATE((metrics->served++, aht21_metrics_latency(metrics, latency)));
+        }
+        else
+        {
+            batch->req[keep++] = batch->req[i];
+        }
+    }
+    batch->count = keep;
+}
+
+/**
+ * @brief 执行一次转换并发布 同时满足批次中时效符合的请求
+ *
+ * @param aht21_handler_instance AHT21 Handler 实例
+ * @param sample                 样本输出 失败时sample->code为结果码
+ * @return 0 表示成功，其他值参考error_codes.h
+ */
+static int8_t temp_humi_handler_sample(bsp_aht21_handler_t *aht21_handler_instance, aht21_sample_t *sample)
+{
+    temp_humi_batch_t *batch = &g_temp_humi_batch;
+    memset(sample, 0, sizeof(*sample));
+    sample->timestamp = AHT21_GET_TICK(aht21_handler_instance->aht21_instance);
+    int8_t code = temp_humi_batch_convert(aht21_handler_instance, sample);
+    TEMP_HUMI_METRICS_UPDATE((metrics->conversions++, metrics->conv_failures += (code != RET_CODE_SUCCESS)));
+    if (code != RET_CODE_SUCCESS)
     {
-        // 遍历队列,有满足时效数据直接返回
-        for (size_t i = 0; i < sizeof(g_spk_event_array); i++)
+        sample->code = code;
+        if (batch->count != 0 && ++batch->fail_run >= AHT21_HANDLER_CONVERT_RETRY)
         {
-            if (g_spk_event_array[i].timestamp < event->(lifetime)HAL_GetTick())
+            // 传感器持续失败 本批请求以失败码结束 调用方不再等待
+            for (uint8_t i = 0; i < batch->count; i++)
             {
-                event_result = g_spk_event_array[i];
+                temp_humi_event_fail(batch->req[i].event, code, sample->timestamp);
             }
+            TEMP_HUMI_METRICS_UPDATE(metrics->failed += batch->count);
+            batch->count = 0;
+            batch->fail_run = 0;
         }
+        return code;
+    }
+    batch->fail_run = 0;
+    // 转换耗时滑动平均 含IIC事务
+    uint32_t took = AHT21_GET_TICK(aht21_handler_instance->aht21_instance) - sample->timestamp;
+    g_temp_humi_conv_ms = (g_temp_humi_conv_ms * 3U + took + 3U) / 4U;
+    aht21_latest_publish(&g_aht21_latest, sample);
+    aht21_history_push(&g_aht21_history, sample);
+    // 转换期间到达的请求
+    temp_humi_batch_collect(aht21_handler_instance);
+    temp_humi_batch_dispatch(aht21_handler_instance, sample);
+    return RET_CODE_SUCCESS;
+}
+
+/**
+ * @brief 处理当前批次
+ *
+ * 批次中最早的请求触发一次转换(leader)，转换期间到达且时效窗口覆盖转换
+ * 触发时刻的请求(follower)并入本次转换，不再单独触发。
+ *
+ * @param aht21_handler_instance AHT21 Handler 实例
+ */
+static void temp_humi_batch_serve(bsp_aht21_handler_t *aht21_handler_instance)
+{
+    temp_humi_batch_t *batch = &g_temp_humi_batch;
+    aht21_sample_t sample;
+    temp_humi_batch_collect(aht21_handler_instance);
+    if (batch->count == 0)
+    {
+        return;
+    }
+    // 排队期间可能已发布了满足时效的样本
+    if (aht21_latest_read(&g_aht21_latest, &sample, NULL) == RET_CODE_SUCCESS)
+    {
+        temp_humi_batch_dispatch(aht21_handler_instance, &sample);
+        if (batch->count == 0)
+        {
+            return;
+        }
+    }
+    // 赶不上下一次转换的请求直接拒绝 不占用转换
+    temp_humi_batch_expire(AHT21_GET_TICK(aht21_handler_instance->aht21_instance) + g_temp_humi_conv_ms);
+    if (batch->count == 0)
+    {
+        return;
+    }
+    // 本批请求共用一次转换
+    temp_humi_handler_sample(aht21_handler_instance, &sample);
+}
+
+/**
+ * @brief 距下一个订阅时刻的节拍数 新订阅在此处安排首次采样 已取消的订阅在此处回收
+ *
+ * 回收只在handler线程中、投递之外进行，取消订阅时正在进行的投递读到的cfg
+ * 不会被新的订阅改写。
+ *
+ * @param aht21_handler_instance AHT21 Handler 实例
+ * @return 0 已有订阅到期 portMAX_DELAY 没有订阅
+ */
+static TickType_t temp_humi_sub_wait_ticks(bsp_aht21_handler_t *aht21_handler_instance)
+{
+    uint32_t now = AHT21_GET_TICK(aht21_handler_instance->aht21_instance);
+    TickType_t wait = portMAX_DELAY;
+    for (uint8_t i = 0; i < AHT21_HANDLER_SUB_MAX; i++)
+    {
+        temp_humi_subscriber_t *sub = &g_temp_humi_subs[i];
+        if (sub->state == TEMP_HUMI_SUB_CLOSING)
+        {
+            sub->state = TEMP_HUMI_SUB_FREE;
+            continue;
+        }
+        if (sub->state == TEMP_HUMI_SUB_NEW)
+        {
+            sub->next_due = now;
+            sub->state = TEMP_HUMI_SUB_ACTIVE;
+        }
+        if (sub->state != TEMP_HUMI_SUB_ACTIVE)
+        {
+            continue;
+        }
+        // 不提前返回 本轮的新订阅须全部安排在同一时刻
+        TickType_t ticks = AHT21_TICK_REACHED(now, sub->next_due) ? 0 : temp_humi_ms_to_ticks(sub->next_due - now);
+        if (ticks < wait)
+        {
+            wait = ticks;
+        }
+    }
+    return wait;
+}
+
+/**
+ * @brief 按订阅的类型投递样本
+ *
+ * @param sub     订阅者
+ * @param sample  样本
+ */
+static void temp_humi_sub_deliver(temp_humi_subscriber_t *sub, const aht21_sample_t *sample)
+{
+    aht21_sample_t out = *sample;
+    bool delivered = true;
+    if (sub->cfg.type_of_data == TEMP_HUMI_EVENT_TYPE_TEMP)
+    {
+        out.humi = 0.0f;
+    }
+    else if (sub->cfg.type_of_data == TEMP_HUMI_EVENT_TYPE_HUMI)
+    {
+        out.temp = 0.0f;
+    }
+    switch (sub->cfg.sink)
+    {
+    case TEMP_HUMI_SINK_QUEUE:
+        delivered = (xQueueSend((QueueHandle_t)sub->cfg.target, &out, 0) == pdPASS);
+        break;
+    case TEMP_HUMI_SINK_STREAM:
+        // 空间不足时整条丢弃 不写入半个样本
+        delivered = (xStreamBufferSpacesAvailable((StreamBufferHandle_t)sub->cfg.target) >= sizeof(out) &&
+                     xStreamBufferSend((StreamBufferHandle_t)sub->cfg.target, &out, sizeof(out), 0) == sizeof(out));
+        break;
+    case TEMP_HUMI_SINK_CALLBACK:
+        sub->cfg.callback(&out, sub->cfg.arg);
+        break;
+    default:
+        delivered = false;
+        break;
+    }
+    if (!delivered)
+    {
+        sub->dropped++;
+    }
+}
 
-        // 没有最新时效返回让Handler直接去查
-        return RET_CODE_NO_RIGHT_DATA,                  // 没有符合条件数据
+/**
+ * @brief 处理到期的订阅
+ *
+ * 全部订阅共用一个采样计划：任意订阅到期时执行一次转换，到期或在
+ * AHT21_HANDLER_SUB_SLACK_MS内即将到期的订阅都由这次转换投递，周期成倍数
+ * 关系时采样频率等于最短周期。下一次时刻按周期累加不漂移，错过的周期跳过。
+ *
+ * @param aht21_handler_instance AHT21 Handler 实例
+ */
+static void temp_humi_sub_serve(bsp_aht21_handler_t *aht21_handler_instance)
+{
+    if (temp_humi_sub_wait_ticks(aht21_handler_instance) != 0)
+    {
+        return;
     }
-    else
+    aht21_sample_t sample;
+    temp_humi_handler_sample(aht21_handler_instance, &sample);
+    uint32_t now = AHT21_GET_TICK(aht21_handler_instance->aht21_instance);
+    for (uint8_t i = 0; i < AHT21_HANDLER_SUB_MAX; i++)
     {
-        // 返回队列最新数据
-        event_result = g_spk_event_array[i];
+        temp_humi_subscriber_t *sub = &g_temp_humi_subs[i];
+        if (sub->state != TEMP_HUMI_SUB_ACTIVE ||
+            !AHT21_TICK_REACHED(sample.timestamp + AHT21_HANDLER_SUB_SLACK_MS, sub->next_due))
+        {
+            continue;
+        }
+        temp_humi_sub_deliver(sub, &sample);
+        sub->next_due += sub->cfg.period_ms;
+        if (AHT21_TICK_PASSED(now, sub->next_due))
+        {
+            uint32_t skip = (now - sub->next_due + sub->cfg.period_ms - 1U) / sub->cfg.period_ms;
+            sub->next_due += skip * sub->cfg.period_ms;
+            sub->missed += skip;
+        }
     }
-    // 进行赋值 及调用回调函数
-    if (NULL != event->humi)
+}
+
+#if AHT21_HANDLER_STATIC_ALLOC
+/**
+ * @param bsp_AHT21_handler_arg_instance  handler参数 任务运行期间不能释放
+ * @param storage                         RTOS对象存储 任务运行期间不能释放
+ * @param priority                        任务优先级
+ * @attention 以调用方提供的存储创建handler任务 队列和互斥量在任务内由同一存储创建
+ * @return 0 表示成功
+ *         RET_CODE_ERROR_PARAM_NULL  参数错误
+ *         RET_CODE_HAS_BEEN_INITED   已启动
+ *         RET_CODE_XTASKCREATE_FAIL  任务创建失败
+ */
+int8_t temp_humi_handler_start(bsp_AHT21_handler_arg_struct *bsp_AHT21_handler_arg_instance,
+                               temp_humi_handler_storage_t *storage, UBaseType_t priority)
+{
+    if (NULL == bsp_AHT21_handler_arg_instance || NULL == storage)
     {
-        event->humi = event_result.humi;
+        return RET_CODE_ERROR_PARAM_NULL;
     }
-    if (NULL != event->temp)
+    if (NULL != g_temp_humi_storage)
     {
-        event->humi = event_result.temp;
+        return RET_CODE_HAS_BEEN_INITED;
     }
-    if (NULL != event->type_of_data)
+    g_temp_humi_storage = storage;
+    TaskHandle_t task = xTaskCreateStatic((TaskFunction_t)temp_humi_handler_thread, "aht21_handler",
+                                          AHT21_HANDLER_STACK_DEPTH, bsp_AHT21_handler_arg_instance,
+                                          priority, storage->stack, &storage->task);
+    if (NULL == task)
     {
-        event->humi = event_result.humi;
-        event->humi = event_result.temp;
+        g_temp_humi_storage = NULL;
+        return RET_CODE_XTASKCREATE_FAIL;
     }
-    event->callback(event->humi, event->temp);
-    //成功
     return RET_CODE_SUCCESS;
-}
\ No newline at end of file
+}
+#endif
+
+/**
+ * @param event  temp_humi_event_t 实例
+ * @attention 接收参数来提供温湿度 从最新样本槽按值复制 不加锁
+ *            lifetime为TEMP_HUMI_LIFETIME_ANY时接受任意已有样本 否则样本触发时刻须在lifetime(ms)以内
+ *            lifetime超过INT32_MAX(约24.8天)时按INT32_MAX处理
+ *            缓存不满足时请求交给handler线程 与时效重叠的其他请求合并为一次转换
+ *            排队的event在回调前需保持有效 连续AHT21_HANDLER_CONVERT_RETRY次转换失败时
+ *            排队的请求收到code为失败码的样本
+ *            排队的请求按最早时限优先回调 设置了deadline的请求在下一次转换赶不上时限时
+ *            收到code为RET_CODE_AHT21_DEADLINE的样本
+ * @return 0 表示成功 已写出数据并回调
+ *         RET_CODE_AHT21_PENDING  已排队 转换完成后在handler线程中写出数据并回调
+ *         RET_CODE_AHT21_DEADLINE deadline短于一次转换耗时 未排队
+ *         RET_CODE_NO_RIGHT_DATA  handler未运行
+ *         RET_CODE_AHT21_BUSY     请求队列已满 priority为0时队列保留位置不可用
+ */
+int8_t temp_humi_event_handler_send(temp_humi_event_t *event)
+{
+    if (NULL == event)
+    {
+        return RET_CODE_ERROR_PARAM_NULL;
+    }
+    if (NULL == g_aht21_handler || NULL == g_aht21_handler->queue_event)
+    {
+        return RET_CODE_NO_RIGHT_DATA;
+    }
+    // 与样本时间戳同一时基
+    uint32_t now = AHT21_GET_TICK(g_aht21_handler->aht21_instance);
+    temp_humi_request_t request;
+    request.event = event;
+    // 时效按带符号差比较 超过INT32_MAX的lifetime会使比较反转 截断为INT32_MAX
+    // TEMP_HUMI_LIFETIME_ANY另行标记 排队后仍接受下一次转换的样本
+    request.any = (TEMP_HUMI_LIFETIME_ANY == event->lifetime);
+    request.not_before = now - ((event->lifetime > (uint32_t)INT32_MAX) ? (uint32_t)INT32_MAX : event->lifetime);
+    request.priority = event->priority;
+    request.hard = (0 != event->deadline);
+    request.deadline = now + (request.hard ? event->deadline : AHT21_HANDLER_SOFT_DEADLINE_MS);
+    request.arrival = now;
+    TEMP_HUMI_METRICS_UPDATE(metrics->requests++);
+    // 查看缓存样本时效
+    aht21_sample_t sample;
+    if (aht21_latest_read(&g_aht21_latest, &sample, NULL) == RET_CODE_SUCCESS &&
+        (request.any || temp_humi_sample_fresh(&sample, request.not_before)))
+    {
+        temp_humi_event_deliver(event, &sample);
+        TEMP_HUMI_METRICS_UPDATE((metrics->served++, metrics->cache_hits++, aht21_metrics_latency(metrics, 0)));
+        return RET_CODE_SUCCESS;
+    }
+    // 没有满足时效的数据 交给Handler合并转换
+    // 时限短于一次转换 排队也无法满足
+    if (request.hard && event->deadline < g_temp_humi_conv_ms)
+    {
+        TEMP_HUMI_METRICS_UPDATE(metrics->rejected_deadline++);
+        return RET_CODE_AHT21_DEADLINE;
+    }
+    // 队列最后AHT21_HANDLER_QUEUE_RESERVE个位置留给priority非0的请求
+    if ((0 == request.priority &&
+         uxQueueSpacesAvailable(g_aht21_handler->queue_event) <= AHT21_HANDLER_QUEUE_RESERVE) ||
+        xQueueSend(g_aht21_handler->queue_event, &request, 0) != pdPASS)
+    {
+        TEMP_HUMI_METRICS_UPDATE(metrics->rejected_busy++);
+        return RET_CODE_AHT21_BUSY;
+    }
+    uint32_t depth = AHT21_HANDLER_QUEUE_LEN - uxQueueSpacesAvailable(g_aht21_handler->queue_event);
+    TEMP_HUMI_METRICS_UPDATE(aht21_metrics_hwm(&metrics->queue_hwm, depth));
+    return RET_CODE_AHT21_PENDING;
+}
+
+/**
+ * @param sample  样本输出
+ * @param seq     样本序号输出 可为NULL
+ * @attention 按值读取最新样本 可在中断中调用
+ * @return 0 表示成功，其他值表示失败
+ */
+int8_t temp_humi_handler_read_latest(aht21_sample_t *sample, uint32_t *seq)
+{
+    return aht21_latest_read(&g_aht21_latest, sample, seq);
+}
+
+/**
+ * @param seq  借用的序号输出
+ * @attention 不复制 直接引用最新样本槽 读完后用temp_humi_handler_borrow_valid确认
+ * @return 样本 尚无样本时为NULL
+ */
+const aht21_sample_t *temp_humi_handler_borrow_latest(uint32_t *seq)
+{
+    return aht21_latest_borrow(&g_aht21_latest, seq);
+}
+
+/**
+ * @param seq  temp_humi_handler_borrow_latest输出的序号
+ * @attention false表示借用期间样本已被改写 读到的数据应丢弃
+ * @return true 有效
+ */
+bool temp_humi_handler_borrow_valid(uint32_t seq)
+{
+    return aht21_latest_valid(&g_aht21_latest, seq);
+}
+
+/**
+ * @param from  起始时刻(含) 与样本时间戳同一时基
+ * @param to    结束时刻(含)
+ * @param out   输出 按时间顺序
+ * @param max   out容量
+ * @attention 复制原始样本窗口 不阻塞采样线程
+ * @return 复制数
+ */
+uint16_t temp_humi_handler_history_raw(uint32_t from, uint32_t to, aht21_history_raw_t *out, uint16_t max)
+{
+    return aht21_history_read_raw(&g_aht21_history, from, to, out, max);
+}
+
+/**
+ * @param level  AHT21_HISTORY_MINUTE / AHT21_HISTORY_HOUR
+ * @param from   桶起始时刻下限(含)
+ * @param to     桶起始时刻上限(含)
+ * @param out    输出 按时间顺序
+ * @param max    out容量
+ * @attention 复制已结束的分钟/小时汇总 不阻塞采样线程
+ * @return 复制数
+ */
+uint16_t temp_humi_handler_history_rollup(aht21_history_level_t level, uint32_t from, uint32_t to,
+                                          aht21_history_rollup_t *out, uint16_t max)
+{
+    return aht21_history_read_rollup(&g_aht21_history, level, from, to, out, max);
+}
+
+/**
+ * @param buf   输出 AHT21_METRICS_SNAPSHOT_MAX字节总是足够
+ * @param size  buf容量
+ * @attention 在临界区内复制指标 临界区外读取驱动IIC统计并编码 不阻塞handler线程
+ * @return 写入字节数 handler未运行或buf不足时为0
+ */
+uint16_t temp_humi_handler_metrics_snapshot(uint8_t *buf, uint16_t size)
+{
+    bsp_aht21_handler_t *handler = g_aht21_handler;
+    if (NULL == handler || NULL == buf)
+    {
+        return 0;
+    }
+    aht21_metrics_t copy;
+    taskENTER_CRITICAL();
+    copy = handler->metrics;
+    taskEXIT_CRITICAL();
+    aht21_fault_stats_t fault;
+    if (aht21_get_fault_stats(handler->aht21_instance, &fault) != RET_CODE_SUCCESS)
+    {
+        memset(&fault, 0, sizeof(fault));
+    }
+    return aht21_metrics_encode(&copy, &fault, handler->aht21_instance->crc_fail_count, buf, size);
+}
+
+/**
+ * @param sub  订阅配置 内容被复制 调用返回后可释放
+ * @attention 订阅周期性温湿度 首个样本在handler线程下一次调度时投递
+ *            队列/流缓冲区的元素为aht21_sample_t 未订阅的一项为0
+ * @return >=0 订阅号
+ *         RET_CODE_ERROR_PARAM_NULL 参数错误
+ *         RET_CODE_AHT21_SUB_FULL   订阅表已满
+ */
+int8_t temp_humi_handler_subscribe(const temp_humi_subscribe_t *sub)
+{
+    if (NULL == sub || 0 == sub->period_ms ||
+        (sub->sink == TEMP_HUMI_SINK_CALLBACK && NULL == sub->callback) ||
+        (sub->sink != TEMP_HUMI_SINK_CALLBACK && NULL == sub->target))
+    {
+        return RET_CODE_ERROR_PARAM_NULL;
+    }
+    // 占用一个空闲槽
+    int8_t id = RET_CODE_AHT21_SUB_FULL;
+    taskENTER_CRITICAL();
+    for (uint8_t i = 0; i < AHT21_HANDLER_SUB_MAX; i++)
+    {
+        if (g_temp_humi_subs[i].state == TEMP_HUMI_SUB_FREE)
+        {
+            g_temp_humi_subs[i].state = TEMP_HUMI_SUB_RESERVED;
+            id = (int8_t)i;
+            break;
+        }
+    }
+    taskEXIT_CRITICAL();
+    if (id < 0)
+    {
+        return id;
+    }
+    temp_humi_subscriber_t *slot = &g_temp_humi_subs[id];
+    // 在临界区内发布 handler线程看到NEW时配置和计数一定已写入
+    // (临界区进出带编译器与内存屏障 volatile的state不保证与普通字段的顺序)
+    taskENTER_CRITICAL();
+    slot->cfg = *sub;
+    slot->missed = 0;
+    slot->dropped = 0;
+    slot->state = TEMP_HUMI_SUB_NEW;
+    taskEXIT_CRITICAL();
+    // 唤醒handler线程重新计算等待时间
+    if (NULL != g_aht21_handler && NULL != g_aht21_handler->queue_event)
+    {
+        temp_humi_request_t wake = { .event = NULL };
+        xQueueSend(g_aht21_handler->queue_event, &wake, 0);
+    }
+    return id;
+}
+
+/**
+ * @param id  temp_humi_handler_subscribe返回的订阅号
+ * @attention 取消订阅 返回后不再开始新的投递 handler线程正在投递时本次投递仍会完成
+ *            订阅号在handler线程下一轮调度时回收 之后才可能被新的订阅占用
+ * @return 0 表示成功，其他值表示失败
+ */
+int8_t temp_humi_handler_unsubscribe(int8_t id)
+{
+    if (id < 0 || id >= AHT21_HANDLER_SUB_MAX)
+    {
+        return RET_CODE_ERROR_PARAM_NULL;
+    }
+    int8_t ret = RET_CODE_ERROR_PARAM_NULL;
+    temp_humi_subscriber_t *slot = &g_temp_humi_subs[id];
+    taskENTER_CRITICAL();
+    if (slot->state == TEMP_HUMI_SUB_NEW || slot->state == TEMP_HUMI_SUB_ACTIVE)
+    {
+        slot->state = TEMP_HUMI_SUB_CLOSING;
+        ret = RET_CODE_SUCCESS;
+    }
+    taskEXIT_CRITICAL();
+    // 唤醒handler线程回收订阅槽
+    if (RET_CODE_SUCCESS == ret && NULL != g_aht21_handler && NULL != g_aht21_handler->queue_event)
+    {
+        temp_humi_request_t wake = { .event = NULL };
+        xQueueSend(g_aht21_handler->queue_event, &wake, 0);
+    }
+    return ret;
+}
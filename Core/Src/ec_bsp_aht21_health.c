@@ -0,0 +1,255 @@
+/******************************************************************************
+ * Copyright (C) 2024 EternalChip, Inc.(Gmbh) or its affiliates.
+ *
+ * All Rights Reserved.
+ *
+ * File name: ec_bsp_aht21_health.c
+ *
+ * Description: Per-instance health tracking for AHT21 sensors.
+ *
+ * Processing flow:
+ *
+ * called by the driver at the end of every measurement.
+ *
+ *
+ * Version: V1.0
+ *
+ * Modifications:
+ *
+ *
+ * Note: 1 tab == 4 spaces!
+ *
+ *****************************************************************************/
+
+#include "ec_bsp_aht21_health.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#define AHT21_HEALTH_Q16_ONE         65536U
+
+/**
+ * @brief 滑动平均 event为1表示本次测量出现该类错误
+ */
+static uint32_t aht21_health_ewma(uint32_t rate_q16, uint32_t event)
+{
+    uint32_t target = event ? AHT21_HEALTH_Q16_ONE : 0U;
+    if (target >= rate_q16)
+    {
+        return rate_q16 + ((target - rate_q16) >> AHT21_HEALTH_EWMA_SHIFT);
+    }
+    return rate_q16 - ((rate_q16 - target) >> AHT21_HEALTH_EWMA_SHIFT);
+}
+
+/**
+ * @brief 千分比阈值转Q16 0表示不检测
+ */
+static uint32_t aht21_health_permille_q16(uint16_t permille)
+{
+    return permille == 0 ? UINT32_MAX : (((uint32_t)permille << 16) + 999U) / 1000U;
+}
+
+/**
+ * @brief 变化量是否超过rate_max(每秒) rate_max为0时不检测
+ */
+static uint8_t aht21_health_rate_exceeded(int32_t delta, uint16_t rate_max, uint32_t dt_ms)
+{
+    if (rate_max == 0)
+    {
+        return 0;
+    }
+    uint32_t mag = (uint32_t)(delta < 0 ? -delta : delta);
+    if (dt_ms == 0)
+    {
+        dt_ms = 1;
+    }
+    return (uint64_t)mag * 1000U > (uint64_t)rate_max * dt_ms;
+}
+
+/**
+ * @brief 默认阈值
+ *
+ * @param cfg 输出
+ */
+void aht21_health_cfg_default(aht21_health_cfg_t *cfg)
+{
+    if (cfg == NULL)
+    {
+        return;
+    }
+    cfg->stuck_limit = 8;
+    cfg->temp_min = -4000;
+    cfg->temp_max = 12000;
+    cfg->humi_min = 0;
+    cfg->humi_max = 10000;
+    cfg->temp_rate_max = 200;
+    cfg->humi_rate_max = 1000;
+    cfg->rate_warn = 100;
+    cfg->rate_fail = 250;
+    cfg->fail_limit = 3;
+}
+
+/**
+ * @brief 复位健康跟踪
+ *
+ * @param health 跟踪状态
+ * @param cfg    阈值 NULL时使用默认值
+ */
+void aht21_health_reset(aht21_health_t *health, const aht21_health_cfg_t *cfg)
+{
+    if (health == NULL)
+    {
+        return;
+    }
+    memset(health, 0, sizeof(*health));
+    if (cfg == NULL)
+    {
+        aht21_health_cfg_default(&health->cfg);
+    }
+    else
+    {
+        health->cfg = *cfg;
+    }
+    health->state = AHT21_HEALTH_UNKNOWN;
+}
+
+/**
+ * @brief 记录一次测量结果
+ *
+ * 累计错误计数以增量方式折算成"含错误的测量比例",计数回绕时增量仍正确。
+ * 卡死、量程、变化率只在成功测量时检测；失败测量保持这些标志不变,
+ * 变化率以上一个成功样本为基准。
+ *
+ * @param health 跟踪状态
+ * @param in     测量结果
+ * @return aht21_health_state_t
+ */
+uint8_t aht21_health_update(aht21_health_t *health, const aht21_health_input_t *in)
+{
+    if (health == NULL || in == NULL)
+    {
+        return AHT21_HEALTH_UNKNOWN;
+    }
+    const aht21_health_cfg_t *cfg = &health->cfg;
+    uint8_t flags = health->flags & (AHT21_HEALTH_F_STUCK | AHT21_HEALTH_F_SATURATED |
+                                     AHT21_HEALTH_F_RANGE | AHT21_HEALTH_F_RATE);
+
+    // 通信错误率
+    uint32_t comm_delta = in->comm_errors - health->last_comm_errors;
+    uint32_t crc_delta = in->crc_errors - health->last_crc_errors;
+    health->last_comm_errors = in->comm_errors;
+    health->last_crc_errors = in->crc_errors;
+    health->comm_rate_q16 = aht21_health_ewma(health->comm_rate_q16, comm_delta);
+    health->crc_rate_q16 = aht21_health_ewma(health->crc_rate_q16, crc_delta);
+
+    if (in->code != 0)
+    {
+        health->stats.failures++;
+        if (health->fail_run < UINT8_MAX)
+        {
+            health->fail_run++;
+        }
+    }
+    else
+    {
+        health->stats.samples++;
+        health->fail_run = 0;
+        flags = 0;
+
+        // 温湿度原始码同时不变 活的传感器噪声会使低位跳动
+        if (health->has_last &&
+            in->temp_raw == health->last_temp_raw && in->humi_raw == health->last_humi_raw)
+        {
+            if (health->stuck_run < UINT16_MAX)
+            {
+                health->stuck_run++;
+            }
+        }
+        else
+        {
+            health->stuck_run = 0;
+        }
+        if (health->stuck_run > health->stats.max_stuck_run)
+        {
+            health->stats.max_stuck_run = health->stuck_run;
+        }
+        if (cfg->stuck_limit != 0 && health->stuck_run >= cfg->stuck_limit)
+        {
+            if (health->stuck_run == cfg->stuck_limit)
+            {
+                health->stats.stuck_events++;
+            }
+            flags |= AHT21_HEALTH_F_STUCK;
+        }
+
+        if (in->temp_raw == 0 || in->temp_raw >= AHT21_HEALTH_RAW_FULL ||
+            in->humi_raw == 0 || in->humi_raw >= AHT21_HEALTH_RAW_FULL)
+        {
+            flags |= AHT21_HEALTH_F_SATURATED;
+        }
+
+        if ((cfg->temp_min != 0 || cfg->temp_max != 0) &&
+            (in->temp < cfg->temp_min || in->temp > cfg->temp_max))
+        {
+            flags |= AHT21_HEALTH_F_RANGE;
+        }
+        if ((cfg->humi_min != 0 || cfg->humi_max != 0) &&
+            (in->humi < cfg->humi_min || in->humi > cfg->humi_max))
+        {
+            flags |= AHT21_HEALTH_F_RANGE;
+        }
+        if (flags & AHT21_HEALTH_F_RANGE)
+        {
+            health->stats.range_violations++;
+        }
+
+        if (health->has_last)
+        {
+            uint32_t dt = in->tick - health->last_tick;
+            if (aht21_health_rate_exceeded((int32_t)in->temp - health->last_temp, cfg->temp_rate_max, dt) ||
+                aht21_health_rate_exceeded((int32_t)in->humi - (int32_t)health->last_humi, cfg->humi_rate_max, dt))
+            {
+                flags |= AHT21_HEALTH_F_RATE;
+                health->stats.rate_violations++;
+            }
+        }
+
+        health->last_tick = in->tick;
+        health->last_temp_raw = in->temp_raw;
+        health->last_humi_raw = in->humi_raw;
+        health->last_temp = in->temp;
+        health->last_humi = in->humi;
+        health->has_last = 1;
+    }
+
+    if (cfg->fail_limit != 0 && health->fail_run >= cfg->fail_limit)
+    {
+        flags |= AHT21_HEALTH_F_NO_DATA;
+    }
+    uint32_t warn_q16 = aht21_health_permille_q16(cfg->rate_warn);
+    uint32_t fail_q16 = aht21_health_permille_q16(cfg->rate_fail);
+    if (health->crc_rate_q16 >= warn_q16)
+    {
+        flags |= AHT21_HEALTH_F_CRC;
+    }
+    if (health->comm_rate_q16 >= warn_q16)
+    {
+        flags |= AHT21_HEALTH_F_COMM;
+    }
+
+    if ((flags & (AHT21_HEALTH_F_STUCK | AHT21_HEALTH_F_SATURATED | AHT21_HEALTH_F_NO_DATA)) ||
+        health->crc_rate_q16 >= fail_q16 || health->comm_rate_q16 >= fail_q16)
+    {
+        health->state = AHT21_HEALTH_FAILED;
+    }
+    else if (flags != 0)
+    {
+        health->state = AHT21_HEALTH_DEGRADED;
+    }
+    else if (health->has_last)
+    {
+        health->state = AHT21_HEALTH_OK;
+    }
+    health->flags = flags;
+    return health->state;
+}
@@ -0,0 +1,329 @@
+/**
+ * @file ec_bsp_aht21_history.c
+ * @brief AHT21 多分辨率历史数据源文件
+ *
+ * @version 1.0
+ * @date 2024-07-20
+ *
+ * @par 依赖项
+ * - ec_bsp_aht21_history.h
+ *
+ * @par 版本历史
+ * - 1.0 初始版本
+ *
+ * @par 作者
+ * - liyijie
+ */
+
+#include "ec_bsp_aht21_history.h"
+#ifdef USE_HAL_DRIVER
+#include "stm32f4xx_hal.h"
+#endif
+
+#include <stddef.h>
+#include <string.h>
+
+// 写入者写完记录再发布计数 读者复制完记录再复查计数
+#ifdef USE_HAL_DRIVER
+#define AHT21_HISTORY_BARRIER()      __DMB()
+#elif defined(__GNUC__)
+#define AHT21_HISTORY_BARRIER()      __sync_synchronize()
+#else
+#define AHT21_HISTORY_BARRIER()
+#endif
+
+// 时间戳是否在[from, to]内(兼容计数回绕)
+#define AHT21_HISTORY_IN_WINDOW(t, from, to) \
+	((uint32_t)((t) - (from)) <= (uint32_t)((to) - (from)))
+
+static const uint32_t g_aht21_history_bucket_ms[AHT21_HISTORY_LEVEL_NUM] = {
+    AHT21_HISTORY_MINUTE_MS,
+    AHT21_HISTORY_HOUR_MS,
+};
+
+static const uint16_t g_aht21_history_rollup_len[AHT21_HISTORY_LEVEL_NUM] = {
+    AHT21_HISTORY_MINUTE_LEN,
+    AHT21_HISTORY_HOUR_LEN,
+};
+
+/**
+ * @brief 汇总环首地址
+ */
+static aht21_history_rollup_t *aht21_history_ring(const aht21_history_t *history, aht21_history_level_t level)
+{
+    return (aht21_history_rollup_t *)(level == AHT21_HISTORY_MINUTE ? history->minute : history->hour);
+}
+
+/**
+ * @brief 浮点转0.01单位 四舍五入并限幅
+ */
+static int32_t aht21_history_centi(float value, int32_t min, int32_t max)
+{
+    float centi = value * 100.0f;
+    centi += (centi >= 0.0f) ? 0.5f : -0.5f;
+    if (centi <= (float)min)
+    {
+        return min;
+    }
+    if (centi >= (float)max)
+    {
+        return max;
+    }
+    return (int32_t)centi;
+}
+
+/**
+ * @brief 累加器清空并从start开始新桶
+ */
+static void aht21_history_acc_open(aht21_history_acc_t *acc, uint32_t start)
+{
+    acc->start = start;
+    acc->count = 0;
+    acc->temp_sum = 0;
+    acc->humi_sum = 0;
+    acc->temp_min = INT16_MAX;
+    acc->temp_max = INT16_MIN;
+    acc->humi_min = UINT16_MAX;
+    acc->humi_max = 0;
+}
+
+/**
+ * @brief 把一个汇总桶(或count为1的原始样本)并入累加器
+ */
+static void aht21_history_acc_merge(aht21_history_acc_t *acc, const aht21_history_rollup_t *in,
+                                    int32_t temp_sum, uint32_t humi_sum)
+{
+    acc->count += in->count;
+    acc->temp_sum += temp_sum;
+    acc->humi_sum += humi_sum;
+    if (in->temp_min < acc->temp_min)
+    {
+        acc->temp_min = in->temp_min;
+    }
+    if (in->temp_max > acc->temp_max)
+    {
+        acc->temp_max = in->temp_max;
+    }
+    if (in->humi_min < acc->humi_min)
+    {
+        acc->humi_min = in->humi_min;
+    }
+    if (in->humi_max > acc->humi_max)
+    {
+        acc->humi_max = in->humi_max;
+    }
+}
+
+/**
+ * @brief 累加器转汇总桶
+ */
+static void aht21_history_acc_close(const aht21_history_acc_t *acc, aht21_history_rollup_t *out)
+{
+    int32_t half = (int32_t)(acc->count / 2U);
+    out->start = acc->start;
+    out->count = acc->count;
+    out->temp_min = acc->temp_min;
+    out->temp_max = acc->temp_max;
+    out->temp_mean = (int16_t)((acc->temp_sum + (acc->temp_sum >= 0 ? half : -half)) / (int32_t)acc->count);
+    out->humi_min = acc->humi_min;
+    out->humi_max = acc->humi_max;
+    out->humi_mean = (uint16_t)((acc->humi_sum + (uint32_t)half) / acc->count);
+}
+
+/**
+ * @brief 把一条记录并入level级的当前桶 桶已结束时先写入汇总环
+ *
+ * 分钟桶结束时递归并入小时桶。桶边界从第一条记录起按固定长度对齐，
+ * 中间没有样本的桶不写入。
+ *
+ * @param history  历史存储
+ * @param level    汇总级别
+ * @param in       记录 start为记录时刻
+ * @param temp_sum 记录的温度和
+ * @param humi_sum 记录的湿度和
+ */
+static void aht21_history_roll(aht21_history_t *history, aht21_history_level_t level,
+                               const aht21_history_rollup_t *in, int32_t temp_sum, uint32_t humi_sum)
+{
+    aht21_history_acc_t *acc = &history->acc[level];
+    uint32_t len_ms = g_aht21_history_bucket_ms[level];
+    if (acc->count == 0)
+    {
+        aht21_history_acc_open(acc, in->start);
+    }
+    else if ((uint32_t)(in->start - acc->start) >= len_ms)
+    {
+        aht21_history_rollup_t closed;
+        aht21_history_acc_close(acc, &closed);
+        uint32_t head = history->rollup_head[level];
+        aht21_history_ring(history, level)[head % g_aht21_history_rollup_len[level]] = closed;
+        AHT21_HISTORY_BARRIER();
+        history->rollup_head[level] = head + 1U;
+
+        if (level + 1 < AHT21_HISTORY_LEVEL_NUM)
+        {
+            aht21_history_roll(history, (aht21_history_level_t)(level + 1), &closed,
+                               acc->temp_sum, acc->humi_sum);
+        }
+        aht21_history_acc_open(acc, acc->start + (in->start - acc->start) / len_ms * len_ms);
+    }
+    aht21_history_acc_merge(acc, in, temp_sum, humi_sum);
+}
+
+/**
+ * @brief 复制环中[from, to]内的记录 去掉复制期间被覆盖的最旧记录
+ *
+ * 记录i(累计序号)在写入者写入记录i + len时被覆盖，写入者写完后才把计数
+ * 更新为i + len + 1。复制结束时计数为end，则序号大于end - len的记录
+ * 在复制期间未被改写。
+ *
+ * @param ring      环首地址
+ * @param rec_size  记录大小
+ * @param len       环长度
+ * @param head      累计写入数
+ * @param ts_offset 时间戳在记录中的偏移
+ * @return 复制数
+ */
+static uint16_t aht21_history_copy(const uint8_t *ring, size_t rec_size, uint16_t len,
+                                   const volatile uint32_t *head, size_t ts_offset,
+                                   uint32_t from, uint32_t to, uint8_t *out, uint16_t max)
+{
+    uint32_t begin = *head;
+    AHT21_HISTORY_BARRIER();
+    uint32_t oldest = (begin > len) ? begin - len : 0U;
+    uint32_t first = 0;
+    uint16_t n = 0;
+    for (uint32_t i = oldest; i != begin && n < max; i++)
+    {
+        const uint8_t *rec = ring + (size_t)(i % len) * rec_size;
+        uint32_t ts;
+        memcpy(&ts, rec + ts_offset, sizeof(ts));
+        if (!AHT21_HISTORY_IN_WINDOW(ts, from, to))
+        {
+            continue;
+        }
+        if (n == 0)
+        {
+            first = i;
+        }
+        memcpy(out + (size_t)n * rec_size, rec, rec_size);
+        n++;
+    }
+    AHT21_HISTORY_BARRIER();
+    uint32_t end = *head;
+    if (n == 0 || end < len)
+    {
+        return n;
+    }
+    // 时间有序 窗口内的记录序号连续 被覆盖的只可能是开头几条
+    uint32_t valid = end - len + 1U;
+    if (first >= valid)
+    {
+        return n;
+    }
+    uint32_t torn = valid - first;
+    if (torn >= n)
+    {
+        return 0;
+    }
+    memmove(out, out + (size_t)torn * rec_size, (size_t)(n - torn) * rec_size);
+    return (uint16_t)(n - torn);
+}
+
+/**
+ * @brief  清空历史
+ *
+ * @param  history  历史存储
+ */
+void aht21_history_init(aht21_history_t *history)
+{
+    if (history == NULL)
+    {
+        return;
+    }
+    memset(history, 0, sizeof(*history));
+}
+
+/**
+ * @brief  写入一个样本
+ *
+ * 失败的样本(code非0)不写入。只能由唯一的写入者调用。
+ *
+ * @param  history  历史存储
+ * @param  sample   样本
+ */
+void aht21_history_push(aht21_history_t *history, const aht21_sample_t *sample)
+{
+    if (history == NULL || sample == NULL || sample->code != 0)
+    {
+        return;
+    }
+    aht21_history_raw_t raw;
+    raw.timestamp = sample->timestamp;
+    raw.temp = (int16_t)aht21_history_centi(sample->temp, INT16_MIN, INT16_MAX);
+    raw.humi = (uint16_t)aht21_history_centi(sample->humi, 0, UINT16_MAX);
+
+    uint32_t head = history->raw_head;
+    history->raw[head % AHT21_HISTORY_RAW_LEN] = raw;
+    AHT21_HISTORY_BARRIER();
+    history->raw_head = head + 1U;
+
+    aht21_history_rollup_t one;
+    one.start = raw.timestamp;
+    one.count = 1;
+    one.temp_min = one.temp_mean = one.temp_max = raw.temp;
+    one.humi_min = one.humi_mean = one.humi_max = raw.humi;
+    aht21_history_roll(history, AHT21_HISTORY_MINUTE, &one, raw.temp, raw.humi);
+}
+
+/**
+ * @brief  复制原始样本窗口
+ *
+ * 不阻塞写入者。窗口较大时开头的记录可能在复制期间被覆盖而不返回，
+ * 返回的记录都是完整的。窗口内记录多于max时返回最旧的max条，
+ * 可从最后一条的时间戳+1继续读取。
+ *
+ * @param  history  历史存储
+ * @param  from     起始时刻(含)
+ * @param  to       结束时刻(含)
+ * @param  out      输出
+ * @param  max      out容量
+ * @return 复制数
+ */
+uint16_t aht21_history_read_raw(const aht21_history_t *history, uint32_t from, uint32_t to,
+                                aht21_history_raw_t *out, uint16_t max)
+{
+    if (history == NULL || out == NULL)
+    {
+        return 0;
+    }
+    return aht21_history_copy((const uint8_t *)history->raw, sizeof(aht21_history_raw_t),
+                              AHT21_HISTORY_RAW_LEN, &history->raw_head,
+                              offsetof(aht21_history_raw_t, timestamp),
+                              from, to, (uint8_t *)out, max);
+}
+
+/**
+ * @brief  复制汇总桶窗口
+ *
+ * @param  history  历史存储
+ * @param  level    汇总级别
+ * @param  from     桶起始时刻下限(含)
+ * @param  to       桶起始时刻上限(含)
+ * @param  out      输出
+ * @param  max      out容量
+ * @return 复制数
+ */
+uint16_t aht21_history_read_rollup(const aht21_history_t *history, aht21_history_level_t level,
+                                   uint32_t from, uint32_t to, aht21_history_rollup_t *out, uint16_t max)
+{
+    if (history == NULL || out == NULL || level >= AHT21_HISTORY_LEVEL_NUM)
+    {
+        return 0;
+    }
+    return aht21_history_copy((const uint8_t *)aht21_history_ring(history, level),
+                              sizeof(aht21_history_rollup_t), g_aht21_history_rollup_len[level],
+                              &history->rollup_head[level],
+                              offsetof(aht21_history_rollup_t, start),
+                              from, to, (uint8_t *)out, max);
+}
@@ -0,0 +1,154 @@
+/**
+ * @file ec_bsp_aht21_latest.c
+ * @brief AHT21 最新样本缓存源文件
+ *
+ * @version 1.0
+ * @date 2024-07-16
+ *
+ * @par 依赖项
+ * - ec_bsp_aht21_latest.h
+ *
+ * @par 版本历史
+ * - 1.0 初始版本
+ *
+ * @par 作者
+ * - liyijie
+ */
+
+#include "ec_bsp_aht21_latest.h"
+#ifdef USE_HAL_DRIVER
+#include "stm32f4xx_hal.h"
+#endif
+
+#include <stddef.h>
+#include <string.h>
+
+// 发布者写完缓冲区再发布seq 读者复制完缓冲区再复查seq
+#ifdef USE_HAL_DRIVER
+#define AHT21_LATEST_BARRIER()       __DMB()
+#elif defined(__GNUC__)
+#define AHT21_LATEST_BARRIER()       __sync_synchronize()
+#else
+#define AHT21_LATEST_BARRIER()
+#endif
+
+/**
+ * @brief  初始化最新样本槽
+ *
+ * @param  latest  样本槽
+ */
+void aht21_latest_init(aht21_latest_t *latest)
+{
+    if (latest == NULL)
+    {
+        return;
+    }
+    memset(latest->buf, 0, sizeof(latest->buf));
+    latest->seq = 0;
+}
+
+/**
+ * @brief  发布一个样本
+ *
+ * 写入读者当前不读取的缓冲区,写完后seq加1使其成为当前样本。
+ *
+ * @param  latest  样本槽
+ * @param  sample  样本 发布序号写入sample->seq
+ */
+void aht21_latest_publish(aht21_latest_t *latest, aht21_sample_t *sample)
+{
+    if (latest == NULL || sample == NULL)
+    {
+        return;
+    }
+    uint32_t next = latest->seq + 1U;
+    sample->seq = next;
+    latest->buf[next & 1U] = *sample;
+    AHT21_LATEST_BARRIER();
+    latest->seq = next;
+}
+
+/**
+ * @brief  按值读取最新样本
+ *
+ * @param  latest  样本槽
+ * @param  sample  样本输出
+ * @param  seq     样本序号输出 可为NULL 序号变化表示有新样本
+ * @return 0 success
+ *         RET_CODE_NO_RIGHT_DATA 尚无样本
+ *         RET_CODE_AHT21_BUSY    重试AHT21_LATEST_READ_RETRY次仍被发布打断
+ */
+int8_t aht21_latest_read(const aht21_latest_t *latest, aht21_sample_t *sample, uint32_t *seq)
+{
+    if (latest == NULL || sample == NULL)
+    {
+        return RET_CODE_ERROR_PARAM_NULL;
+    }
+    for (uint8_t i = 0; i <= AHT21_LATEST_READ_RETRY; i++)
+    {
+        uint32_t begin = latest->seq;
+        if (begin == 0)
+        {
+            return RET_CODE_NO_RIGHT_DATA;
+        }
+        AHT21_LATEST_BARRIER();
+        *sample = latest->buf[begin & 1U];
+        AHT21_LATEST_BARRIER();
+        // 复制期间有发布则重试 第二次发布改写buf[begin & 1]时seq已不等于begin
+        if (latest->seq == begin)
+        {
+            if (seq != NULL)
+            {
+                *seq = begin;
+            }
+            return RET_CODE_SUCCESS;
+        }
+    }
+    return RET_CODE_AHT21_BUSY;
+}
+
+/**
+ * @brief  借用最新样本 不复制
+ *
+ * 返回的指针指向槽内缓冲区。读完需要的字段后调用aht21_latest_valid,
+ * 返回false表示借用期间发布者已开始改写该缓冲区,读到的数据无效。
+ *
+ * @param  latest  样本槽
+ * @param  seq     借用的序号输出
+ * @return 样本 尚无样本或参数错误时为NULL
+ */
+const aht21_sample_t *aht21_latest_borrow(const aht21_latest_t *latest, uint32_t *seq)
+{
+    if (latest == NULL || seq == NULL)
+    {
+        return NULL;
+    }
+    uint32_t begin = latest->seq;
+    if (begin == 0)
+    {
+        return NULL;
+    }
+    AHT21_LATEST_BARRIER();
+    *seq = begin;
+    return &latest->buf[begin & 1U];
+}
+
+/**
+ * @brief  借用的样本是否仍然有效
+ *
+ * 序号为seq的缓冲区在发布seq + 2时才被改写,而改写开始时seq已为seq + 1,
+ * 因此序号不变即借用期间未被改写。
+ *
+ * @param  latest  样本槽
+ * @param  seq     aht21_latest_borrow输出的序号
+ * @return true 有效
+ */
+bool aht21_latest_valid(const aht21_latest_t *latest, uint32_t seq)
+{
+    if (latest == NULL)
+    {
+        return false;
+    }
+    AHT21_LATEST_BARRIER();
+    return latest->seq == seq;
+}
@@ -0,0 +1,152 @@
+/**
+ * @file ec_bsp_aht21_metrics.c
+ * @brief AHT21 handler运行指标源文件
+ *
+ * @version 1.0
+ * @date 2024-07-24
+ *
+ * @par 依赖项
+ * - ec_bsp_aht21_metrics.h
+ *
+ * @par 版本历史
+ * - 1.0 初始版本
+ *
+ * @par 作者
+ * - liyijie
+ */
+
+#include "ec_bsp_aht21_metrics.h"
+
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * @brief 写入一个LEB128变长整数
+ *
+ * @param  value  数值
+ * @param  buf    输出
+ * @param  pos    当前位置 成功后前移
+ * @param  size   buf容量
+ * @return 0 空间不足
+ */
+static uint8_t aht21_metrics_put_varint(uint32_t value, uint8_t *buf, uint16_t *pos, uint16_t size)
+{
+    do
+    {
+        if (*pos >= size)
+        {
+            return 0;
+        }
+        uint8_t byte = (uint8_t)(value & 0x7FU);
+        value >>= 7;
+        buf[(*pos)++] = (value != 0) ? (uint8_t)(byte | 0x80U) : byte;
+    } while (value != 0);
+    return 1;
+}
+
+/**
+ * @brief  清零
+ *
+ * @param  metrics  指标
+ */
+void aht21_metrics_reset(aht21_metrics_t *metrics)
+{
+    if (metrics == NULL)
+    {
+        return;
+    }
+    memset(metrics, 0, sizeof(*metrics));
+}
+
+/**
+ * @brief  记录一次交付延迟
+ *
+ * 桶号为延迟的二进制位数：0ms在桶0，[2^(i-1), 2^i)在桶i。
+ *
+ * @param  metrics     指标
+ * @param  latency_ms  请求发送到回调的毫秒数
+ */
+void aht21_metrics_latency(aht21_metrics_t *metrics, uint32_t latency_ms)
+{
+    if (metrics == NULL)
+    {
+        return;
+    }
+    uint8_t bucket = 0;
+    while (latency_ms != 0 && bucket < AHT21_METRICS_LATENCY_BUCKETS - 1)
+    {
+        latency_ms >>= 1;
+        bucket++;
+    }
+    metrics->latency[bucket]++;
+}
+
+/**
+ * @brief  更新最大值
+ *
+ * @param  hwm    最大值
+ * @param  value  当前值
+ */
+void aht21_metrics_hwm(uint32_t *hwm, uint32_t value)
+{
+    if (hwm != NULL && value > *hwm)
+    {
+        *hwm = value;
+    }
+}
+
+/**
+ * @brief  编码快照 格式见ec_bsp_aht21_metrics.h
+ *
+ * @param  metrics   指标
+ * @param  fault     驱动IIC故障统计 NULL时按0编码
+ * @param  crc_fail  驱动CRC错误帧数
+ * @param  buf       输出 AHT21_METRICS_SNAPSHOT_MAX字节总是足够
+ * @param  size      buf容量
+ * @return 写入字节数 buf不足时返回0
+ */
+uint16_t aht21_metrics_encode(const aht21_metrics_t *metrics, const aht21_fault_stats_t *fault,
+                              uint32_t crc_fail, uint8_t *buf, uint16_t size)
+{
+    if (metrics == NULL || buf == NULL || size == 0)
+    {
+        return 0;
+    }
+    const uint32_t fields[AHT21_METRICS_FIELD_NUM] = {
+        metrics->requests,
+        metrics->served,
+        metrics->cache_hits,
+        metrics->conversions,
+        metrics->conv_failures,
+        metrics->rejected_deadline,
+        metrics->rejected_busy,
+        metrics->queue_hwm,
+        metrics->batch_hwm,
+        (fault != NULL) ? fault->nack : 0U,
+        (fault != NULL) ? fault->timeout : 0U,
+        (fault != NULL) ? fault->bus_recover : 0U,
+        crc_fail,
+        AHT21_METRICS_LATENCY_BUCKETS,
+    };
+    uint16_t pos = 0;
+    buf[pos++] = AHT21_METRICS_VERSION;
+    for (uint8_t i = 0; i < AHT21_METRICS_FIELD_NUM; i++)
+    {
+        if (!aht21_metrics_put_varint(fields[i], buf, &pos, size))
+        {
+            return 0;
+        }
+    }
+    for (uint8_t i = 0; i < AHT21_METRICS_LATENCY_BUCKETS; i++)
+    {
+        if (!aht21_metrics_put_varint(metrics->latency[i], buf, &pos, size))
+        {
+            return 0;
+        }
+    }
+    if (!aht21_metrics_put_varint(metrics->failed, buf, &pos, size))
+    {
+        return 0;
+    }
+    return pos;
+}
@@ -0,0 +1,415 @@
+/**
+ * @file ec_bsp_aht21_sim.c
+ * @brief AHT21 软件仿真后端源文件
+ *
+ * 按IIC字节流模拟AHT21的命令解析、转换时序和读出帧，
+ * 事务接口复用同一套字节级状态机。
+ *
+ * @version 1.0
+ * @date 2024-07-02
+ *
+ * @par 依赖项
+ * - ec_bsp_aht21_sim.h
+ *
+ * @par 版本历史
+ * - 1.0 初始版本
+ *
+ * @par 作者
+ * - liyijie
+ */
+
+#include "ec_bsp_aht21_sim.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+// 当前绑定的仿真实例 接口回调不带上下文
+static aht21_sim_t *s_aht21_sim_active = NULL;
+
+/**
+ * @brief  伪随机数 xorshift32
+ */
+static uint32_t aht21_sim_rand(aht21_sim_t *sim)
+{
+    uint32_t x = sim->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    sim->rng = x;
+    return x;
+}
+
+/**
+ * @brief  当前是否仍在转换
+ */
+static bool aht21_sim_busy(const aht21_sim_t *sim)
+{
+    return sim->measuring && !AHT21_TICK_REACHED(sim->now_ms, sim->conv_done_ms);
+}
+
+/**
+ * @brief  温度(0.01摄氏度)转原始码 raw = (T + 50) * 2^20 / 200
+ */
+uint32_t aht21_sim_temp_to_raw(int32_t temp_centi)
+{
+    int32_t t = temp_centi + 5000;
+    if (t <= 0)
+    {
+        return 0;
+    }
+    if (t >= 20000)
+    {
+        return 0xFFFFF;
+    }
+    return ((uint32_t)t * 32768U + 312U) / 625U;
+}
+
+/**
+ * @brief  湿度(0.01%RH)转原始码 raw = RH * 2^20 / 100
+ */
+uint32_t aht21_sim_humi_to_raw(int32_t humi_centi)
+{
+    if (humi_centi <= 0)
+    {
+        return 0;
+    }
+    if (humi_centi >= 10000)
+    {
+        return 0xFFFFF;
+    }
+    return ((uint32_t)humi_centi * 65536U + 312U) / 625U;
+}
+
+/**
+ * @brief  处理测量命令 按当前波形生成转换结果
+ */
+static void aht21_sim_trigger(aht21_sim_t *sim)
+{
+    int32_t temp = (sim->pftemp_wave != NULL) ? sim->pftemp_wave(sim->now_ms, sim->wave_arg) : sim->temp_centi;
+    int32_t humi = (sim->pfhumi_wave != NULL) ? sim->pfhumi_wave(sim->now_ms, sim->wave_arg) : sim->humi_centi;
+    uint32_t t = aht21_sim_temp_to_raw(temp);
+    uint32_t h = aht21_sim_humi_to_raw(humi);
+
+    sim->frame[0] = sim->calibrated ? 0x18 : 0x10;
+    sim->frame[1] = (uint8_t)(h >> 12);
+    sim->frame[2] = (uint8_t)(h >> 4);
+    sim->frame[3] = (uint8_t)(((h & 0x0F) << 4) | (t >> 16));
+    sim->frame[4] = (uint8_t)(t >> 8);
+    sim->frame[5] = (uint8_t)t;
+    sim->frame[6] = aht21_frame_crc8(sim->frame, AHT21_FRAME_LEN);
+
+    uint32_t jitter = (sim->conv_jitter_ms != 0) ? aht21_sim_rand(sim) % (sim->conv_jitter_ms + 1U) : 0;
+    sim->conv_done_ms = sim->now_ms + sim->conv_latency_ms + jitter;
+    sim->measuring = true;
+    sim->stats.triggers++;
+}
+
+/**
+ * @brief  写事务结束 解析命令
+ */
+static void aht21_sim_exec_cmd(aht21_sim_t *sim)
+{
+    if (sim->cmd_len >= 3 && sim->cmd[0] == AHT21_AC && sim->cmd[1] == AHT21_AC_1 && sim->cmd[2] == AHT21_AC_2)
+    {
+        aht21_sim_trigger(sim);
+    }
+    else if (sim->cmd_len >= 1 && sim->cmd[0] == 0xBE)
+    {
+        sim->calibrated = true;
+    }
+    else if (sim->cmd_len >= 1 && sim->cmd[0] == AHT21_SOFT_RESET)
+    {
+        sim->measuring = false;
+        sim->stats.soft_resets++;
+    }
+}
+
+/*
+ * 字节级接口
+ */
+static int8_t aht21_sim_iic_init(void)
+{
+    return 0;
+}
+
+static int8_t aht21_sim_iic_start(void)
+{
+    aht21_sim_t *sim = s_aht21_sim_active;
+    sim->expect_addr = true;
+    sim->addressed = false;
+    sim->reading = false;
+    sim->cmd_len = 0;
+    sim->read_idx = 0;
+    return 0;
+}
+
+static int8_t aht21_sim_iic_stop(void)
+{
+    aht21_sim_t *sim = s_aht21_sim_active;
+    if (sim->addressed)
+    {
+        if (!sim->reading)
+        {
+            aht21_sim_exec_cmd(sim);
+        }
+        else if (sim->read_idx > 0)
+        {
+            sim->stats.frames++;
+        }
+    }
+    sim->addressed = false;
+    sim->expect_addr = false;
+    return 0;
+}
+
+static int8_t aht21_sim_iic_wait_ack(void)
+{
+    return s_aht21_sim_active->last_ack ? 0 : -1;
+}
+
+static int8_t aht21_sim_iic_send_byte(uint8_t byte)
+{
+    aht21_sim_t *sim = s_aht21_sim_active;
+    if (sim->expect_addr)
+    {
+        sim->expect_addr = false;
+        sim->addr_count++;
+        bool inject = (sim->nack_interval != 0) && (sim->addr_count % sim->nack_interval == 0);
+        if (inject)
+        {
+            sim->stats.nacks++;
+        }
+        sim->addressed = ((byte >> 1) == sim->addr) && !inject && !sim->bus_stuck;
+        sim->reading = (byte & 0x01) != 0;
+        sim->last_ack = sim->addressed;
+        if (sim->addressed && sim->reading && aht21_sim_busy(sim))
+        {
+            sim->stats.busy_reads++;
+        }
+        return 0;
+    }
+    if (sim->addressed && !sim->reading)
+    {
+        if (sim->cmd_len < AHT21_SIM_CMD_MAX)
+        {
+            sim->cmd[sim->cmd_len++] = byte;
+        }
+        sim->last_ack = true;
+    }
+    else
+    {
+        sim->last_ack = false;
+    }
+    return 0;
+}
+
+static int8_t aht21_sim_iic_read_byte(uint8_t *byte)
+{
+    aht21_sim_t *sim = s_aht21_sim_active;
+    if (!sim->addressed || !sim->reading)
+    {
+        // 总线无人驱动 上拉为高
+        *byte = 0xFF;
+        return 0;
+    }
+    uint8_t value;
+    if (sim->read_idx == 0)
+    {
+        value = sim->calibrated ? 0x18 : 0x10;
+        if (aht21_sim_busy(sim))
+        {
+            value |= AHT21_STATUS_BUSY_MASK;
+        }
+    }
+    else
+    {
+        value = (sim->read_idx < AHT21_FRAME_CRC_LEN) ? sim->frame[sim->read_idx] : 0xFF;
+        sim->byte_count++;
+        if (sim->flip_interval != 0 && sim->byte_count % sim->flip_interval == 0)
+        {
+            value ^= (uint8_t)(1U << (aht21_sim_rand(sim) & 0x07));
+            sim->stats.bit_flips++;
+        }
+    }
+    sim->read_idx++;
+    *byte = value;
+    return 0;
+}
+
+static int8_t aht21_sim_iic_ack(void)
+{
+    return 0;
+}
+
+/**
+ * @brief  总线解锁 清除注入的SDA卡死
+ */
+static int8_t aht21_sim_iic_recover(void)
+{
+    aht21_sim_t *sim = s_aht21_sim_active;
+    sim->bus_stuck = false;
+    sim->stats.bus_recovers++;
+    return 0;
+}
+
+/*
+ * 事务接口 复用字节级状态机
+ */
+static int8_t aht21_sim_iic_transfer(const iic_transaction_t *xfer)
+{
+    if (xfer == NULL || xfer->segs == NULL || xfer->seg_num == 0)
+    {
+        return -1;
+    }
+    aht21_sim_t *sim = s_aht21_sim_active;
+    for (uint8_t i = 0; i < xfer->seg_num; i++)
+    {
+        const iic_segment_t *seg = &xfer->segs[i];
+        uint8_t dir = seg->flags & IIC_SEG_READ;
+        bool restart = (i == 0) || (seg->flags & IIC_SEG_RESTART) ||
+                       (dir != (xfer->segs[i - 1U].flags & IIC_SEG_READ));
+        if (restart)
+        {
+            if (i > 0)
+            {
+                aht21_sim_iic_stop();
+            }
+            aht21_sim_iic_start();
+            aht21_sim_iic_send_byte((uint8_t)((xfer->addr << 1) | dir));
+            if (!sim->last_ack)
+            {
+                aht21_sim_iic_stop();
+                return -1;
+            }
+        }
+        for (uint16_t j = 0; j < seg->size; j++)
+        {
+            if (dir)
+            {
+                aht21_sim_iic_read_byte(&seg->pdata[j]);
+            }
+            else
+            {
+                aht21_sim_iic_send_byte(seg->pdata[j]);
+            }
+        }
+    }
+    aht21_sim_iic_stop();
+    return 0;
+}
+
+/*
+ * 虚拟时钟
+ */
+static uint32_t aht21_sim_get_tick(void)
+{
+    return (s_aht21_sim_active != NULL) ? s_aht21_sim_active->now_ms : 0;
+}
+
+/**
+ * @brief  初始化仿真实例
+ *
+ * @param  sim   仿真实例
+ * @param  addr  7位地址
+ * @return 0 success
+ */
+int8_t aht21_sim_init(aht21_sim_t *sim, uint8_t addr)
+{
+    if (sim == NULL)
+    {
+        return RET_CODE_ERROR_PARAM_NULL;
+    }
+    memset(sim, 0, sizeof(*sim));
+    sim->addr = addr;
+    sim->conv_latency_ms = AHT21_MEASUREMENT_DELAY_MS;
+    sim->temp_centi = 2500;
+    sim->humi_centi = 5000;
+    sim->calibrated = true;
+    sim->rng = 0x2545F491U;
+    return RET_CODE_SUCCESS;
+}
+
+/**
+ * @brief  绑定仿真实例 并填充IIC与时基接口表
+ *
+ * 时基的pfwait_until填为aht21_sim_wait_until,需要逐毫秒推进时可改为NULL并使用aht21_sim_yield。
+ *
+ * @param  sim           仿真实例
+ * @param  iic_instance  待填充的IIC接口表
+ * @param  timebase      待填充的时基接口表
+ * @param  use_transfer  true只提供事务接口 false只提供字节级接口
+ * @return 0 success
+ */
+int8_t aht21_sim_bind(aht21_sim_t *sim, iic_driver_interface_t *iic_instance,
+                      system_timebase_interface_t *timebase, bool use_transfer)
+{
+    if (sim == NULL || iic_instance == NULL || timebase == NULL)
+    {
+        return RET_CODE_ERROR_PARAM_NULL;
+    }
+    s_aht21_sim_active = sim;
+    memset(iic_instance, 0, sizeof(*iic_instance));
+    iic_instance->pfInit = aht21_sim_iic_init;
+    iic_instance->pfDeInit = aht21_sim_iic_init;
+    if (use_transfer)
+    {
+        iic_instance->pfTransfer = aht21_sim_iic_transfer;
+    }
+    else
+    {
+        iic_instance->pfStart = aht21_sim_iic_start;
+        iic_instance->pfStop = aht21_sim_iic_stop;
+        iic_instance->pfWaitAck = aht21_sim_iic_wait_ack;
+        iic_instance->pfSendByte = aht21_sim_iic_send_byte;
+        iic_instance->pfReadByte = aht21_sim_iic_read_byte;
+        iic_instance->pfSendAck = aht21_sim_iic_ack;
+        iic_instance->pfSendNack = aht21_sim_iic_ack;
+    }
+    iic_instance->pfBusRecover = aht21_sim_iic_recover;
+    timebase->mcu_get_systick_count = aht21_sim_get_tick;
+    timebase->pfwait_until = aht21_sim_wait_until;
+    return RET_CODE_SUCCESS;
+}
+
+/**
+ * @brief  虚拟时钟前进
+ *
+ * @param  sim  仿真实例
+ * @param  ms   前进的毫秒数
+ */
+void aht21_sim_advance(aht21_sim_t *sim, uint32_t ms)
+{
+    if (sim != NULL)
+    {
+        sim->now_ms += ms;
+    }
+}
+
+/**
+ * @brief  作为rtos_yeild传入驱动 每次让出时虚拟时钟前进1ms
+ *
+ * @param  aht21_instance  aht21实例(未使用)
+ * @return 0
+ */
+int8_t aht21_sim_yield(bsp_aht21_t *aht21_instance)
+{
+    (void)aht21_instance;
+    aht21_sim_advance(s_aht21_sim_active, 1);
+    return 0;
+}
+
+/**
+ * @brief  作为pfwait_until 虚拟时钟直接跳到deadline_tick
+ *
+ * @param  deadline_tick  绝对时刻
+ */
+void aht21_sim_wait_until(uint32_t deadline_tick)
+{
+    aht21_sim_t *sim = s_aht21_sim_active;
+    if (sim != NULL && !AHT21_TICK_REACHED(sim->now_ms, deadline_tick))
+    {
+        sim->now_ms = deadline_tick;
+    }
+}
@@ -0,0 +1,274 @@
+/**
+ * @file ec_bsp_aht21_trace.c
+ * @brief AHT21 驱动分阶段耗时追踪源文件
+ *
+ * @version 1.0
+ * @date 2024-07-10
+ *
+ * @par 依赖项
+ * - ec_bsp_aht21_trace.h
+ *
+ * @par 版本历史
+ * - 1.0 初始版本
+ *
+ * @par 作者
+ * - liyijie
+ */
+
+#include "ec_bsp_aht21_trace.h"
+#ifdef USE_HAL_DRIVER
+#include "stm32f4xx_hal.h"
+#endif
+
+#include <stddef.h>
+#include <string.h>
+
+#define AHT21_TRACE_RING_MASK        (AHT21_TRACE_RING_SIZE - 1U)
+#define AHT21_TRACE_SUB_MASK         ((1U << AHT21_TRACE_HIST_SUB_BITS) - 1U)
+
+// 生产者写入事件后再发布head 消费者读完事件后再发布tail
+#ifdef USE_HAL_DRIVER
+#define AHT21_TRACE_BARRIER()        __DMB()
+#elif defined(__GNUC__)
+#define AHT21_TRACE_BARRIER()        __sync_synchronize()
+#else
+#define AHT21_TRACE_BARRIER()
+#endif
+
+#if (AHT21_TRACE_RING_SIZE & (AHT21_TRACE_RING_SIZE - 1)) != 0
+#error "AHT21_TRACE_RING_SIZE must be a power of 2"
+#endif
+
+// 追踪状态 head只由生产者修改 tail只由消费者修改
+static struct
+{
+    aht21_trace_event_t buf[AHT21_TRACE_RING_SIZE];
+    volatile uint32_t   head;
+    volatile uint32_t   tail;
+    volatile uint32_t   dropped;
+    uint16_t            seq;
+    uint32_t          (*pfclock)(void);
+    uint32_t            clock_hz;
+} s_aht21_trace;
+
+#ifdef USE_HAL_DRIVER
+/**
+ * @brief  读取DWT周期计数
+ */
+static uint32_t aht21_trace_dwt_clock(void)
+{
+    return DWT->CYCCNT;
+}
+#endif
+
+/**
+ * @brief  初始化追踪 清空缓冲区
+ *
+ * @param  pfclock   时钟函数 NULL时使用DWT->CYCCNT(仅目标板)
+ * @param  clock_hz  时钟频率 用于换算微秒 为0时目标板取SystemCoreClock
+ */
+void aht21_trace_init(uint32_t (*pfclock)(void), uint32_t clock_hz)
+{
+    memset(&s_aht21_trace, 0, sizeof(s_aht21_trace));
+#ifdef USE_HAL_DRIVER
+    if (pfclock == NULL)
+    {
+        // 使能DWT周期计数器
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CYCCNT = 0;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+        pfclock = aht21_trace_dwt_clock;
+    }
+    if (clock_hz == 0)
+    {
+        clock_hz = SystemCoreClock;
+    }
+#endif
+    s_aht21_trace.pfclock = pfclock;
+    s_aht21_trace.clock_hz = clock_hz;
+}
+
+/**
+ * @brief  当前时钟计数 未初始化时返回0
+ */
+uint32_t aht21_trace_now(void)
+{
+    return (s_aht21_trace.pfclock != NULL) ? s_aht21_trace.pfclock() : 0;
+}
+
+/**
+ * @brief  写入一条事件 缓冲区满时丢弃
+ *
+ * @param  dev_addr  传感器地址
+ * @param  phase     阶段
+ * @param  start     阶段开始时刻
+ * @param  end       阶段结束时刻
+ * @param  code      阶段结果码
+ */
+void aht21_trace_record(uint8_t dev_addr, aht21_trace_phase_t phase, uint32_t start, uint32_t end, int8_t code)
+{
+    uint32_t head = s_aht21_trace.head;
+    uint16_t seq = s_aht21_trace.seq++;
+    if (head - s_aht21_trace.tail >= AHT21_TRACE_RING_SIZE)
+    {
+        s_aht21_trace.dropped++;
+        return;
+    }
+    aht21_trace_event_t *event = &s_aht21_trace.buf[head & AHT21_TRACE_RING_MASK];
+    event->timestamp = start;
+    event->cycles = end - start;
+    event->seq = seq;
+    event->phase = (uint8_t)phase;
+    event->dev_addr = dev_addr;
+    event->code = code;
+    AHT21_TRACE_BARRIER();
+    s_aht21_trace.head = head + 1U;
+}
+
+/**
+ * @brief  耗时对应的直方图桶
+ *
+ * 小于2^SUB的值每个值一个桶 其余按最高位所在的2的幂区间再等分2^SUB份
+ */
+static uint32_t aht21_trace_bucket(uint32_t v)
+{
+    if (v <= AHT21_TRACE_SUB_MASK)
+    {
+        return v;
+    }
+    uint32_t e = 31;
+    while ((v & (1UL << e)) == 0)
+    {
+        e--;
+    }
+    uint32_t sub = (v >> (e - AHT21_TRACE_HIST_SUB_BITS)) & AHT21_TRACE_SUB_MASK;
+    return ((e - AHT21_TRACE_HIST_SUB_BITS + 1U) << AHT21_TRACE_HIST_SUB_BITS) + sub;
+}
+
+/**
+ * @brief  直方图桶的上界
+ */
+static uint32_t aht21_trace_bucket_upper(uint32_t idx)
+{
+    if (idx <= AHT21_TRACE_SUB_MASK)
+    {
+        return idx;
+    }
+    uint32_t e = (idx >> AHT21_TRACE_HIST_SUB_BITS) + AHT21_TRACE_HIST_SUB_BITS - 1U;
+    uint32_t width = 1UL << (e - AHT21_TRACE_HIST_SUB_BITS);
+    uint32_t lower = (1UL << e) + (idx & AHT21_TRACE_SUB_MASK) * width;
+    return lower + (width - 1U);
+}
+
+/**
+ * @brief  取出全部事件 累计统计并逐条输出
+ *
+ * @param  stats   累计统计 可为NULL
+ * @param  pfsink  每条事件的输出回调 可为NULL
+ * @return 本次取出的事件数
+ */
+uint32_t aht21_trace_drain(aht21_trace_stats_t *stats, void (*pfsink)(const aht21_trace_event_t *event))
+{
+    uint32_t tail = s_aht21_trace.tail;
+    uint32_t head = s_aht21_trace.head;
+    uint32_t n = 0;
+    AHT21_TRACE_BARRIER();
+    while (tail != head)
+    {
+        aht21_trace_event_t event = s_aht21_trace.buf[tail & AHT21_TRACE_RING_MASK];
+        if (stats != NULL && event.phase < AHT21_TRACE_PHASE_NUM)
+        {
+            aht21_trace_phase_stats_t *ps = &stats->phase[event.phase];
+            if (ps->count == 0 || event.cycles < ps->min)
+            {
+                ps->min = event.cycles;
+            }
+            if (event.cycles > ps->max)
+            {
+                ps->max = event.cycles;
+            }
+            ps->count++;
+            ps->sum += event.cycles;
+            ps->hist[aht21_trace_bucket(event.cycles)]++;
+        }
+        if (pfsink != NULL)
+        {
+            pfsink(&event);
+        }
+        tail++;
+        n++;
+    }
+    AHT21_TRACE_BARRIER();
+    s_aht21_trace.tail = tail;
+    return n;
+}
+
+/**
+ * @brief  缓冲区满被丢弃的事件数
+ */
+uint32_t aht21_trace_dropped(void)
+{
+    return s_aht21_trace.dropped;
+}
+
+/**
+ * @brief  清空统计
+ */
+void aht21_trace_stats_reset(aht21_trace_stats_t *stats)
+{
+    if (stats != NULL)
+    {
+        memset(stats, 0, sizeof(*stats));
+    }
+}
+
+/**
+ * @brief  计算某阶段的min/avg/max/p99
+ *
+ * @param  stats    累计统计
+ * @param  phase    阶段
+ * @param  summary  摘要输出 单位为时钟计数
+ */
+void aht21_trace_summary(const aht21_trace_stats_t *stats, aht21_trace_phase_t phase,
+                         aht21_trace_summary_t *summary)
+{
+    if (stats == NULL || summary == NULL || phase >= AHT21_TRACE_PHASE_NUM)
+    {
+        return;
+    }
+    const aht21_trace_phase_stats_t *ps = &stats->phase[phase];
+    memset(summary, 0, sizeof(*summary));
+    if (ps->count == 0)
+    {
+        return;
+    }
+    summary->count = ps->count;
+    summary->min = ps->min;
+    summary->max = ps->max;
+    summary->avg = (uint32_t)(ps->sum / ps->count);
+    // 第ceil(count*0.99)个样本所在的桶
+    uint32_t target = (uint32_t)(((uint64_t)ps->count * 99U + 99U) / 100U);
+    uint32_t acc = 0;
+    for (uint32_t i = 0; i < AHT21_TRACE_HIST_BUCKETS; i++)
+    {
+        acc += ps->hist[i];
+        if (acc >= target)
+        {
+            uint32_t upper = aht21_trace_bucket_upper(i);
+            summary->p99 = (upper > ps->max) ? ps->max : upper;
+            break;
+        }
+    }
+}
+
+/**
+ * @brief  时钟计数换算为微秒
+ */
+uint32_t aht21_trace_to_us(uint32_t cycles)
+{
+    if (s_aht21_trace.clock_hz == 0)
+    {
+        return 0;
+    }
+    return (uint32_t)(((uint64_t)cycles * 1000000U) / s_aht21_trace.clock_hz);
+}
@@ -0,0 +1,117 @@
+/**
+ * @file ec_bsp_aht21_wait.c
+ * @brief AHT21 驱动等待接口的目标板实现源文件
+ *
+ * @version 1.0
+ * @date 2024-07-12
+ *
+ * @par 依赖项
+ * - ec_bsp_aht21_wait.h
+ *
+ * @par 版本历史
+ * - 1.0 初始版本
+ *
+ * @par 作者
+ * - liyijie
+ */
+
+#include "ec_bsp_aht21_wait.h"
+#include "stm32f4xx_hal.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <stddef.h>
+
+// 绑定的时基 等待实现不带上下文
+static uint32_t (*s_aht21_wait_get_tick)(void) = NULL;
+
+/**
+ * @brief  到绝对时刻的剩余毫秒数 已到达返回0
+ */
+static uint32_t aht21_wait_remaining(uint32_t deadline_tick)
+{
+    uint32_t now = (s_aht21_wait_get_tick != NULL) ? s_aht21_wait_get_tick() : HAL_GetTick();
+    return AHT21_TICK_REACHED(now, deadline_tick) ? 0 : (deadline_tick - now);
+}
+
+/**
+ * @brief  毫秒换算为RTOS节拍 向上取整
+ */
+static TickType_t aht21_wait_ms_to_ticks(uint32_t ms)
+{
+    return (TickType_t)(((uint64_t)ms * configTICK_RATE_HZ + 999U) / 1000U);
+}
+
+/**
+ * @brief  绑定时基 并将pfwait_until填入时基接口表
+ *
+ * @param  timebase      时基接口表 mcu_get_systick_count需已填写
+ * @param  pfwait_until  本文件中的一种等待实现
+ * @return 0 success
+ */
+int8_t aht21_wait_attach(system_timebase_interface_t *timebase, aht21_wait_until_t pfwait_until)
+{
+    if (timebase == NULL || timebase->mcu_get_systick_count == NULL || pfwait_until == NULL)
+    {
+        return RET_CODE_ERROR_PARAM_NULL;
+    }
+    s_aht21_wait_get_tick = timebase->mcu_get_systick_count;
+    timebase->pfwait_until = pfwait_until;
+    return RET_CODE_SUCCESS;
+}
+
+/**
+ * @brief  裸机 WFI直到绝对时刻 由SysTick等中断唤醒后重新检查
+ *
+ * @param  deadline_tick  绝对时刻
+ */
+void aht21_wait_until_wfi(uint32_t deadline_tick)
+{
+    while (aht21_wait_remaining(deadline_tick) != 0)
+    {
+        __WFI();
+    }
+}
+
+/**
+ * @brief  FreeRTOS 延时到绝对时刻
+ *
+ * 以当前节拍为基准调用vTaskDelayUntil,延时期间任务阻塞,不占用cpu。
+ *
+ * @param  deadline_tick  绝对时刻
+ */
+void aht21_wait_until_rtos(uint32_t deadline_tick)
+{
+    if (xTaskGetSchedulerState() != taskSCHEDULER_RUNNING)
+    {
+        aht21_wait_until_wfi(deadline_tick);
+        return;
+    }
+    uint32_t remaining = aht21_wait_remaining(deadline_tick);
+    if (remaining != 0)
+    {
+        TickType_t last_wake = xTaskGetTickCount();
+        vTaskDelayUntil(&last_wake, aht21_wait_ms_to_ticks(remaining));
+    }
+}
+
+/**
+ * @brief  FreeRTOS 等待任务通知 超时为到绝对时刻的剩余时间
+ *
+ * 被通知提前唤醒时直接返回,驱动重新检查时刻后决定是否继续等待。
+ *
+ * @param  deadline_tick  绝对时刻
+ */
+void aht21_wait_until_rtos_notify(uint32_t deadline_tick)
+{
+    if (xTaskGetSchedulerState() != taskSCHEDULER_RUNNING)
+    {
+        aht21_wait_until_wfi(deadline_tick);
+        return;
+    }
+    uint32_t remaining = aht21_wait_remaining(deadline_tick);
+    if (remaining != 0)
+    {
+        (void)ulTaskNotifyTake(pdTRUE, aht21_wait_ms_to_ticks(remaining));
+    }
+}
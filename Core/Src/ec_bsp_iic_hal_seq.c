@@ -0,0 +1,288 @@
+/**
+ * @file ec_bsp_iic_hal_seq.c
+ * @brief 基于HAL顺序传输+DMA的IIC事务后端源文件
+ *
+ * 事务的每一段映射为一次HAL顺序传输：
+ * - 仅一段          : I2C_FIRST_AND_LAST_FRAME
+ * - 第一段          : I2C_FIRST_FRAME
+ * - 中间段          : I2C_NEXT_FRAME (方向改变时HAL自动产生重复起始)
+ * - 最后一段        : I2C_LAST_FRAME
+ * - 同方向强制重复起始: I2C_FIRST_FRAME / I2C_FIRST_AND_LAST_FRAME
+ *
+ * @version 1.0
+ * @date 2024-06-28
+ *
+ * @par 依赖项
+ * - ec_bsp_iic_hal_seq.h
+ * - FreeRTOS : 等待传输完成时阻塞在二值信号量上。
+ *
+ * @par 版本历史
+ * - 1.0 初始版本
+ * - 1.1 等待传输完成时阻塞 不再忙等
+ *
+ * @par 作者
+ * - liyijie
+ */
+
+#include "ec_bsp_iic_hal_seq.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// 后端状态 pfTransfer不带上下文 绑定的外设保存在此
+static struct
+{
+    I2C_HandleTypeDef *hi2c;
+    volatile uint8_t   done;
+    volatile uint8_t   error;
+    SemaphoreHandle_t  sem;    // 完成/出错回调释放 传输任务在此阻塞
+} s_iic_hal_seq = {NULL, 0, 0, NULL};
+
+/**
+ * @brief  IIC外设初始化 CubeMX已初始化时不重复初始化
+ */
+static int8_t iic_hal_seq_init(void)
+{
+    if (s_iic_hal_seq.hi2c == NULL)
+    {
+        return -1;
+    }
+    if (HAL_I2C_GetState(s_iic_hal_seq.hi2c) == HAL_I2C_STATE_RESET)
+    {
+        return (HAL_I2C_Init(s_iic_hal_seq.hi2c) == HAL_OK) ? 0 : -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief  IIC外设逆初始化
+ */
+static int8_t iic_hal_seq_deinit(void)
+{
+    if (s_iic_hal_seq.hi2c == NULL)
+    {
+        return -1;
+    }
+    return (HAL_I2C_DeInit(s_iic_hal_seq.hi2c) == HAL_OK) ? 0 : -1;
+}
+
+/**
+ * @brief  IIC外设复位 清除卡死的BUSY标志后重新初始化
+ *
+ * 只复位外设本身;从机拉低SDA时需由应用先用iic_bus_unjam解锁引脚。
+ */
+static int8_t iic_hal_seq_recover(void)
+{
+    I2C_HandleTypeDef *hi2c = s_iic_hal_seq.hi2c;
+    if (hi2c == NULL)
+    {
+        return -1;
+    }
+    HAL_I2C_DeInit(hi2c);
+    SET_BIT(hi2c->Instance->CR1, I2C_CR1_SWRST);
+    CLEAR_BIT(hi2c->Instance->CR1, I2C_CR1_SWRST);
+    s_iic_hal_seq.done = 0;
+    s_iic_hal_seq.error = 0;
+    return (HAL_I2C_Init(hi2c) == HAL_OK) ? 0 : -1;
+}
+
+/**
+ * @brief  计算第index段的HAL顺序传输选项
+ *
+ * @param  xfer   事务
+ * @param  index  段序号
+ * @return XferOptions
+ */
+static uint32_t iic_hal_seq_options(const iic_transaction_t *xfer, uint8_t index)
+{
+    bool last = (index + 1U == xfer->seg_num);
+    bool restart = false;
+    if (index > 0)
+    {
+        // 同方向段需要重复起始时只能重新以FIRST开始
+        uint8_t dir = xfer->segs[index].flags & IIC_SEG_READ;
+        uint8_t prev_dir = xfer->segs[index - 1U].flags & IIC_SEG_READ;
+        restart = (xfer->segs[index].flags & IIC_SEG_RESTART) && (dir == prev_dir);
+    }
+    if (index == 0 || restart)
+    {
+        return last ? I2C_FIRST_AND_LAST_FRAME : I2C_FIRST_FRAME;
+    }
+    return last ? I2C_LAST_FRAME : I2C_NEXT_FRAME;
+}
+
+/**
+ * @brief  等待当前段完成或出错
+ *
+ * 调度器运行时阻塞在信号量上,由完成/出错回调唤醒;调度器未运行(或信号量
+ * 创建失败)时WFI等待,由DMA/IIC中断或SysTick唤醒后重新检查。
+ *
+ * @return true 已完成或出错 false 超时
+ */
+static bool iic_hal_seq_wait(void)
+{
+    uint32_t start = HAL_GetTick();
+    while (!s_iic_hal_seq.done && !s_iic_hal_seq.error)
+    {
+        uint32_t elapsed = HAL_GetTick() - start;
+        if (elapsed > IIC_HAL_SEQ_TIMEOUT_MS)
+        {
+            return false;
+        }
+        if (s_iic_hal_seq.sem != NULL && xTaskGetSchedulerState() == taskSCHEDULER_RUNNING)
+        {
+            // 超时按节拍向上取整 醒来后重新检查标志 丢弃上一段遗留的释放
+            uint32_t remaining = IIC_HAL_SEQ_TIMEOUT_MS + 1U - elapsed;
+            (void)xSemaphoreTake(s_iic_hal_seq.sem,
+                                 (TickType_t)(((uint64_t)remaining * configTICK_RATE_HZ + 999U) / 1000U));
+        }
+        else
+        {
+            __WFI();
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief  完成/出错回调中唤醒传输任务
+ */
+static void iic_hal_seq_wake(void)
+{
+    if (s_iic_hal_seq.sem == NULL || xTaskGetSchedulerState() != taskSCHEDULER_RUNNING)
+    {
+        return;
+    }
+    BaseType_t woken = pdFALSE;
+    (void)xSemaphoreGiveFromISR(s_iic_hal_seq.sem, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+/**
+ * @brief  绑定IIC外设 并填充接口表
+ *
+ * 只填充pfInit/pfDeInit/pfTransfer/pfBusRecover,字节级接口保持不变。
+ * 首次绑定时创建等待用的二值信号量,创建失败时传输以WFI方式等待。
+ *
+ * @param  hi2c          CubeMX生成的IIC句柄
+ * @param  iic_instance  待填充的接口表
+ * @return 0 success
+ */
+int8_t iic_hal_seq_attach(I2C_HandleTypeDef *hi2c, iic_driver_interface_t *iic_instance)
+{
+    if (hi2c == NULL || iic_instance == NULL)
+    {
+        return RET_CODE_ERROR_PARAM_NULL;
+    }
+    s_iic_hal_seq.hi2c = hi2c;
+    s_iic_hal_seq.done = 0;
+    s_iic_hal_seq.error = 0;
+    if (s_iic_hal_seq.sem == NULL)
+    {
+        s_iic_hal_seq.sem = xSemaphoreCreateBinary();
+    }
+    iic_instance->pfInit = iic_hal_seq_init;
+    iic_instance->pfDeInit = iic_hal_seq_deinit;
+    iic_instance->pfTransfer = iic_hal_seq_transfer;
+    iic_instance->pfBusRecover = iic_hal_seq_recover;
+    return RET_CODE_SUCCESS;
+}
+
+/**
+ * @brief  执行一个IIC事务 所有段由DMA连续完成
+ *
+ * @param  xfer  事务描述
+ * @return 0 success
+ *         -1 参数错误/启动失败/无应答/超时
+ */
+int8_t iic_hal_seq_transfer(const iic_transaction_t *xfer)
+{
+    I2C_HandleTypeDef *hi2c = s_iic_hal_seq.hi2c;
+    if (hi2c == NULL || xfer == NULL || xfer->segs == NULL || xfer->seg_num == 0)
+    {
+        return -1;
+    }
+    uint16_t dev_addr = (uint16_t)(xfer->addr << 1);
+    for (uint8_t i = 0; i < xfer->seg_num; i++)
+    {
+        const iic_segment_t *seg = &xfer->segs[i];
+        uint32_t options = iic_hal_seq_options(xfer, i);
+        HAL_StatusTypeDef status;
+
+        s_iic_hal_seq.done = 0;
+        s_iic_hal_seq.error = 0;
+        if (s_iic_hal_seq.sem != NULL)
+        {
+            // 清除超时后迟到的释放
+            (void)xSemaphoreTake(s_iic_hal_seq.sem, 0);
+        }
+        if (seg->flags & IIC_SEG_READ)
+        {
+            status = HAL_I2C_Master_Seq_Receive_DMA(hi2c, dev_addr, seg->pdata, seg->size, options);
+        }
+        else
+        {
+            status = HAL_I2C_Master_Seq_Transmit_DMA(hi2c, dev_addr, seg->pdata, seg->size, options);
+        }
+        if (status != HAL_OK)
+        {
+            return -1;
+        }
+        // 等待DMA完成或出错 不占用cpu
+        if (!iic_hal_seq_wait())
+        {
+            // 超时 终止传输并释放总线
+            HAL_I2C_Master_Abort_IT(hi2c, dev_addr);
+            return -1;
+        }
+        if (s_iic_hal_seq.error)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief  传输完成通知
+ */
+void iic_hal_seq_on_complete(I2C_HandleTypeDef *hi2c)
+{
+    if (hi2c == s_iic_hal_seq.hi2c)
+    {
+        s_iic_hal_seq.done = 1;
+        iic_hal_seq_wake();
+    }
+}
+
+/**
+ * @brief  传输错误通知
+ */
+void iic_hal_seq_on_error(I2C_HandleTypeDef *hi2c)
+{
+    if (hi2c == s_iic_hal_seq.hi2c)
+    {
+        s_iic_hal_seq.error = 1;
+        iic_hal_seq_wake();
+    }
+}
+
+#if IIC_HAL_SEQ_DEFINE_CALLBACKS
+void HAL_I2C_MasterTxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+    iic_hal_seq_on_complete(hi2c);
+}
+
+void HAL_I2C_MasterRxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+    iic_hal_seq_on_complete(hi2c);
+}
+
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
+{
+    iic_hal_seq_on_error(hi2c);
+}
+#endif
@@ -0,0 +1,66 @@
+/**
+ * @file ec_bsp_iic_recovery.c
+ * @brief IIC总线解锁(SCL九时钟)源文件
+ *
+ * @version 1.0
+ * @date 2024-07-04
+ *
+ * @par 依赖项
+ * - ec_bsp_iic_recovery.h
+ *
+ * @par 版本历史
+ * - 1.0 初始版本
+ *
+ * @par 作者
+ * - liyijie
+ */
+
+#include "ec_bsp_iic_recovery.h"
+
+#include <stddef.h>
+
+/**
+ * @brief  解锁IIC总线
+ *
+ * 1. 释放SDA 若SDA已为高直接发停止信号
+ * 2. 否则逐个输出SCL时钟 每个时钟后检查SDA 从机移出剩余位后会释放SDA
+ * 3. SCL高时SDA由低到高 产生停止信号
+ *
+ * @param  ops  引脚操作
+ * @return 0 success
+ *         -1 参数错误或SDA一直为低
+ */
+int8_t iic_bus_unjam(const iic_unjam_ops_t *ops)
+{
+    if (ops == NULL || ops->pfScl == NULL || ops->pfSda == NULL ||
+        ops->pfSdaRead == NULL || ops->pfDelayUs == NULL)
+    {
+        return -1;
+    }
+    ops->pfSda(1);
+    ops->pfScl(1);
+    ops->pfDelayUs(IIC_UNJAM_HALF_PERIOD_US);
+
+    for (uint8_t i = 0; i < IIC_UNJAM_CLOCKS && ops->pfSdaRead() == 0; i++)
+    {
+        ops->pfScl(0);
+        ops->pfDelayUs(IIC_UNJAM_HALF_PERIOD_US);
+        ops->pfScl(1);
+        ops->pfDelayUs(IIC_UNJAM_HALF_PERIOD_US);
+    }
+    if (ops->pfSdaRead() == 0)
+    {
+        return -1;
+    }
+
+    // 停止信号
+    ops->pfScl(0);
+    ops->pfDelayUs(IIC_UNJAM_HALF_PERIOD_US);
+    ops->pfSda(0);
+    ops->pfDelayUs(IIC_UNJAM_HALF_PERIOD_US);
+    ops->pfScl(1);
+    ops->pfDelayUs(IIC_UNJAM_HALF_PERIOD_US);
+    ops->pfSda(1);
+    ops->pfDelayUs(IIC_UNJAM_HALF_PERIOD_US);
+    return 0;
+}
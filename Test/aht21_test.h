@@ -0,0 +1,59 @@
+/**
+ * @file aht21_test.h
+ * @brief AHT21 主机测试公共宏
+ *
+ * 检查失败时打印位置并计数，不中断测试；main以AHT21_TEST_RESULT()返回，
+ * 有失败时进程返回非0，供make test判断。
+ *
+ * @version 1.0
+ * @date 2024-07-26
+ *
+ * @par 版本历史
+ * - 1.0 初始版本
+ *
+ * @par 作者
+ * - liyijie
+ */
+
+#ifndef __AHT21_TEST_H__
+#define __AHT21_TEST_H__
+
+#include <stdio.h>
+
+static unsigned long g_aht21_test_checks;
+static unsigned long g_aht21_test_failures;
+
+// 条件不成立时打印表达式和位置
+#define AHT21_CHECK(cond)                                                          \
+	do                                                                             \
+	{                                                                              \
+		g_aht21_test_checks++;                                                     \
+		if (!(cond))                                                               \
+		{                                                                          \
+			g_aht21_test_failures++;                                               \
+			printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);        \
+		}                                                                          \
+	} while (0)
+
+// 整数比较 失败时打印两侧的值
+#define AHT21_CHECK_EQ(actual, expected)                                           \
+	do                                                                             \
+	{                                                                              \
+		long long aht21_a_ = (long long)(actual);                                  \
+		long long aht21_e_ = (long long)(expected);                                \
+		g_aht21_test_checks++;                                                     \
+		if (aht21_a_ != aht21_e_)                                                  \
+		{                                                                          \
+			g_aht21_test_failures++;                                               \
+			printf("%s:%d: %s == %lld, expected %lld\n", __FILE__, __LINE__,       \
+			       #actual, aht21_a_, aht21_e_);                                   \
+		}                                                                          \
+	} while (0)
+
+// 打印统计 返回进程退出码
+#define AHT21_TEST_RESULT(name)                                                    \
+	(printf("%s: %lu checks, %lu failed\n", (name), g_aht21_test_checks,           \
+	        g_aht21_test_failures),                                                \
+	 (g_aht21_test_failures != 0) ? 1 : 0)
+
+#endif //__AHT21_TEST_H__
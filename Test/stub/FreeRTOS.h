@@ -0,0 +1,120 @@
+/**
+ * @file FreeRTOS.h
+ * @brief 主机测试用FreeRTOS替身
+ *
+ * 只提供handler、HAL顺序DMA后端和等待实现用到的类型和接口，单线程实现，
+ * 见freertos_stub.c。阻塞调用(带超时的xQueueReceive/xSemaphoreTake、
+ * vTaskDelay、vTaskDelayUntil、ulTaskNotifyTake)不真正阻塞，而是把等待的
+ * 节拍数交给freertos_stub_set_idle设置的回调，由测试推进虚拟时钟或模拟中断。
+ *
+ * @version 1.0
+ * @date 2024-07-26
+ *
+ * @par 版本历史
+ * - 1.0 初始版本
+ *
+ * @par 作者
+ * - liyijie
+ */
+
+#ifndef __FREERTOS_STUB_H__
+#define __FREERTOS_STUB_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uint32_t      TickType_t;
+typedef long          BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef void         *QueueHandle_t;
+typedef void         *SemaphoreHandle_t;
+typedef void         *TaskHandle_t;
+typedef void         *StreamBufferHandle_t;
+typedef uint32_t      StackType_t;
+typedef void (*TaskFunction_t)(void *);
+
+// 静态创建的控制块 替身直接把它用作队列/信号量本身 见freertos_stub.c
+typedef struct
+{
+    uint8_t    *storage;
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t head;
+    UBaseType_t count;
+    int         owns_storage;   // 控制块和元素存储由替身分配 删除时释放
+} StaticQueue_t;
+typedef StaticQueue_t StaticSemaphore_t;
+typedef struct { void *dummy[24]; } StaticTask_t;
+
+#define pdFALSE                      0
+#define pdTRUE                       1
+#define pdPASS                       pdTRUE
+#define pdFAIL                       pdFALSE
+#define portMAX_DELAY                ((TickType_t)0xFFFFFFFFUL)
+#define configTICK_RATE_HZ           1000
+#define configSUPPORT_STATIC_ALLOCATION 1
+#define pdMS_TO_TICKS(ms)            ((TickType_t)(ms))
+
+#define taskSCHEDULER_NOT_STARTED    ((BaseType_t)1)
+#define taskSCHEDULER_RUNNING        ((BaseType_t)2)
+
+#define portYIELD_FROM_ISR(woken)    ((void)(woken))
+
+#define taskENTER_CRITICAL()         freertos_stub_critical(1)
+#define taskEXIT_CRITICAL()          freertos_stub_critical(-1)
+
+/**
+ * 阻塞等待回调 ticks为请求等待的节拍数 portMAX_DELAY表示无限等待
+ */
+typedef void (*freertos_stub_idle_t)(TickType_t ticks);
+void freertos_stub_set_idle(freertos_stub_idle_t pfidle);
+/**
+ * 临界区嵌套深度 退出后应为0
+ */
+int freertos_stub_critical(int delta);
+/**
+ * 最近一次在空队列上阻塞的xQueueReceive的超时参数 不含超时为0的调用
+ */
+TickType_t freertos_stub_last_block(void);
+/**
+ * 替身累计的堆分配次数 静态创建不计入
+ */
+size_t freertos_stub_heap_allocs(void);
+/**
+ * xTaskGetSchedulerState的返回值 默认taskSCHEDULER_RUNNING
+ */
+void freertos_stub_set_scheduler(BaseType_t state);
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size);
+QueueHandle_t xQueueCreateStatic(UBaseType_t length, UBaseType_t item_size, uint8_t *storage, StaticQueue_t *queue);
+BaseType_t    xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks);
+BaseType_t    xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks);
+UBaseType_t   uxQueueMessagesWaiting(QueueHandle_t queue);
+UBaseType_t   uxQueueSpacesAvailable(QueueHandle_t queue);
+void          vQueueDelete(QueueHandle_t queue);
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *mutex);
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+BaseType_t        xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks);
+BaseType_t        xSemaphoreGive(SemaphoreHandle_t sem);
+BaseType_t        xSemaphoreGiveFromISR(SemaphoreHandle_t sem, BaseType_t *woken);
+void              vSemaphoreDelete(SemaphoreHandle_t sem);
+
+TaskHandle_t xTaskCreateStatic(TaskFunction_t fn, const char *name, uint32_t depth, void *arg,
+                               UBaseType_t prio, StackType_t *stack, StaticTask_t *tcb);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+BaseType_t   xTaskGetSchedulerState(void);
+TickType_t   xTaskGetTickCount(void);
+void         vTaskDelay(TickType_t ticks);
+void         vTaskDelayUntil(TickType_t *prev_wake, TickType_t increment);
+uint32_t     ulTaskNotifyTake(BaseType_t clear, TickType_t ticks);
+void         vTaskDelete(TaskHandle_t task);
+
+StreamBufferHandle_t xStreamBufferCreate(size_t size, size_t trigger);
+size_t               xStreamBufferSpacesAvailable(StreamBufferHandle_t stream);
+size_t               xStreamBufferSend(StreamBufferHandle_t stream, const void *data, size_t size, TickType_t ticks);
+size_t               xStreamBufferReceive(StreamBufferHandle_t stream, void *data, size_t size, TickType_t ticks);
+void                 vStreamBufferDelete(StreamBufferHandle_t stream);
+
+#endif //__FREERTOS_STUB_H__
@@ -0,0 +1,363 @@
+/**
+ * @file freertos_stub.c
+ * @brief 主机测试用FreeRTOS替身实现
+ *
+ * 单线程：队列和流缓冲区是普通环形缓冲区，互斥量和二值信号量是元素长度为0、
+ * 长度为1的队列。静态创建时队列直接使用调用方的控制块和存储，不分配堆；
+ * 替身统计自己的堆分配次数供测试检查。队列为空时带超时的接收、vTaskDelay等调用空闲回调，回调推进
+ * 虚拟时钟，也可以在其中模拟其他任务投递请求或中断释放信号量；回调返回后
+ * 再检查一次队列。节拍计数只由阻塞调用按请求的节拍数推进。
+ *
+ * @version 1.0
+ * @date 2024-07-26
+ *
+ * @par 版本历史
+ * - 1.0 初始版本
+ *
+ * @par 作者
+ * - liyijie
+ */
+
+#include "FreeRTOS.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// 队列 静态与动态创建共用StaticQueue_t布局
+typedef StaticQueue_t freertos_stub_queue_t;
+
+// 流缓冲区
+typedef struct
+{
+    uint8_t *data;
+    size_t   size;
+    size_t   head;
+    size_t   count;
+} freertos_stub_stream_t;
+
+static freertos_stub_idle_t s_freertos_stub_idle = NULL;
+static TickType_t s_freertos_stub_last_block = 0;
+static TickType_t s_freertos_stub_tick = 0;
+static BaseType_t s_freertos_stub_scheduler = taskSCHEDULER_RUNNING;
+static int s_freertos_stub_critical = 0;
+static size_t s_freertos_stub_heap = 0;
+static int s_freertos_stub_task;
+
+void freertos_stub_set_idle(freertos_stub_idle_t pfidle)
+{
+    s_freertos_stub_idle = pfidle;
+}
+
+int freertos_stub_critical(int delta)
+{
+    s_freertos_stub_critical += delta;
+    return s_freertos_stub_critical;
+}
+
+TickType_t freertos_stub_last_block(void)
+{
+    return s_freertos_stub_last_block;
+}
+
+size_t freertos_stub_heap_allocs(void)
+{
+    return s_freertos_stub_heap;
+}
+
+/**
+ * @brief 计数的堆分配
+ */
+static void *freertos_stub_calloc(size_t num, size_t size)
+{
+    s_freertos_stub_heap++;
+    return calloc(num, size);
+}
+
+void freertos_stub_set_scheduler(BaseType_t state)
+{
+    s_freertos_stub_scheduler = state;
+}
+
+/**
+ * @brief 等待ticks个节拍
+ */
+static void freertos_stub_block(TickType_t ticks)
+{
+    if (ticks != 0 && ticks != portMAX_DELAY)
+    {
+        s_freertos_stub_tick += ticks;
+    }
+    if (ticks != 0 && s_freertos_stub_idle != NULL)
+    {
+        s_freertos_stub_idle(ticks);
+    }
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+    freertos_stub_queue_t *queue = freertos_stub_calloc(1, sizeof(*queue));
+    if (queue == NULL)
+    {
+        return NULL;
+    }
+    // 信号量的元素长度为0 不需要存储
+    if (item_size != 0)
+    {
+        queue->storage = freertos_stub_calloc(length, item_size);
+        if (queue->storage == NULL)
+        {
+            free(queue);
+            return NULL;
+        }
+    }
+    queue->length = length;
+    queue->item_size = item_size;
+    queue->owns_storage = 1;
+    return queue;
+}
+
+QueueHandle_t xQueueCreateStatic(UBaseType_t length, UBaseType_t item_size, uint8_t *storage, StaticQueue_t *queue)
+{
+    if (queue == NULL || (item_size != 0 && storage == NULL))
+    {
+        return NULL;
+    }
+    memset(queue, 0, sizeof(*queue));
+    queue->storage = storage;
+    queue->length = length;
+    queue->item_size = item_size;
+    return queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks)
+{
+    freertos_stub_queue_t *q = queue;
+    (void)ticks;
+    if (q->count == q->length)
+    {
+        return pdFAIL;
+    }
+    if (q->item_size != 0)
+    {
+        memcpy(q->storage + ((q->head + q->count) % q->length) * q->item_size, item, q->item_size);
+    }
+    q->count++;
+    return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks)
+{
+    freertos_stub_queue_t *q = queue;
+    if (q->count == 0 && ticks != 0)
+    {
+        s_freertos_stub_last_block = ticks;
+        freertos_stub_block(ticks);
+    }
+    if (q->count == 0)
+    {
+        return pdFAIL;
+    }
+    if (q->item_size != 0)
+    {
+        memcpy(item, q->storage + q->head * q->item_size, q->item_size);
+    }
+    q->head = (q->head + 1U) % q->length;
+    q->count--;
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+    freertos_stub_queue_t *q = queue;
+    return q->count;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue)
+{
+    freertos_stub_queue_t *q = queue;
+    return q->length - q->count;
+}
+
+void vQueueDelete(QueueHandle_t queue)
+{
+    freertos_stub_queue_t *q = queue;
+    if (q == NULL || !q->owns_storage)
+    {
+        return;
+    }
+    free(q->storage);
+    free(q);
+}
+
+// 互斥量创建时持有一个令牌
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    freertos_stub_queue_t *q = xQueueCreate(1, 0);
+    if (q != NULL)
+    {
+        q->count = 1;
+    }
+    return q;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *mutex)
+{
+    freertos_stub_queue_t *q = xQueueCreateStatic(1, 0, NULL, mutex);
+    if (q != NULL)
+    {
+        q->count = 1;
+    }
+    return q;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return xQueueCreate(1, 0);
+}
+
+// 信号量的元素长度为0 令牌不被读写
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks)
+{
+    uint8_t token;
+    return xQueueReceive(sem, &token, ticks);
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    uint8_t token = 0;
+    return xQueueSend(sem, &token, 0);
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t sem, BaseType_t *woken)
+{
+    if (woken != NULL)
+    {
+        *woken = pdTRUE;
+    }
+    return xSemaphoreGive(sem);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem)
+{
+    vQueueDelete(sem);
+}
+
+TaskHandle_t xTaskCreateStatic(TaskFunction_t fn, const char *name, uint32_t depth, void *arg,
+                               UBaseType_t prio, StackType_t *stack, StaticTask_t *tcb)
+{
+    // 不运行任务函数 测试直接驱动handler的各个步骤
+    (void)fn;
+    (void)name;
+    (void)depth;
+    (void)arg;
+    (void)prio;
+    (void)stack;
+    return tcb;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return &s_freertos_stub_task;
+}
+
+BaseType_t xTaskGetSchedulerState(void)
+{
+    return s_freertos_stub_scheduler;
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return s_freertos_stub_tick;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    freertos_stub_block(ticks);
+}
+
+void vTaskDelayUntil(TickType_t *prev_wake, TickType_t increment)
+{
+    TickType_t wake = *prev_wake + increment;
+    TickType_t ticks = wake - s_freertos_stub_tick;
+    *prev_wake = wake;
+    // 唤醒时刻已过时不阻塞
+    if ((int32_t)ticks > 0)
+    {
+        freertos_stub_block(ticks);
+    }
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks)
+{
+    (void)clear;
+    freertos_stub_block(ticks);
+    return 0;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    (void)task;
+}
+
+StreamBufferHandle_t xStreamBufferCreate(size_t size, size_t trigger)
+{
+    (void)trigger;
+    freertos_stub_stream_t *stream = freertos_stub_calloc(1, sizeof(*stream));
+    if (stream == NULL)
+    {
+        return NULL;
+    }
+    stream->data = freertos_stub_calloc(1, size);
+    if (stream->data == NULL)
+    {
+        free(stream);
+        return NULL;
+    }
+    stream->size = size;
+    return stream;
+}
+
+size_t xStreamBufferSpacesAvailable(StreamBufferHandle_t stream)
+{
+    freertos_stub_stream_t *s = stream;
+    return s->size - s->count;
+}
+
+size_t xStreamBufferSend(StreamBufferHandle_t stream, const void *data, size_t size, TickType_t ticks)
+{
+    freertos_stub_stream_t *s = stream;
+    const uint8_t *in = data;
+    size_t n = 0;
+    (void)ticks;
+    while (n < size && s->count < s->size)
+    {
+        s->data[(s->head + s->count) % s->size] = in[n++];
+        s->count++;
+    }
+    return n;
+}
+
+size_t xStreamBufferReceive(StreamBufferHandle_t stream, void *data, size_t size, TickType_t ticks)
+{
+    freertos_stub_stream_t *s = stream;
+    uint8_t *out = data;
+    size_t n = 0;
+    (void)ticks;
+    while (n < size && s->count > 0)
+    {
+        out[n++] = s->data[s->head];
+        s->head = (s->head + 1U) % s->size;
+        s->count--;
+    }
+    return n;
+}
+
+void vStreamBufferDelete(StreamBufferHandle_t stream)
+{
+    freertos_stub_stream_t *s = stream;
+    if (s != NULL)
+    {
+        free(s->data);
+        free(s);
+    }
+}
@@ -0,0 +1,75 @@
+/**
+ * @file stm32f4xx_hal.h
+ * @brief 主机测试用HAL替身
+ *
+ * handler只通过驱动时基取时间，不使用HAL接口；HAL顺序DMA后端
+ * (ec_bsp_iic_hal_seq.c)和等待实现(ec_bsp_aht21_wait.c)用到的类型、常量和
+ * 接口在此声明，由测试文件实现，见test_aht21_hal.c。
+ *
+ * @version 1.0
+ * @date 2024-07-26
+ *
+ * @par 版本历史
+ * - 1.0 初始版本
+ *
+ * @par 作者
+ * - liyijie
+ */
+
+#ifndef __STM32F4XX_HAL_STUB_H__
+#define __STM32F4XX_HAL_STUB_H__
+
+#include <stdint.h>
+
+typedef enum
+{
+    HAL_OK      = 0x00U,
+    HAL_ERROR   = 0x01U,
+    HAL_BUSY    = 0x02U,
+    HAL_TIMEOUT = 0x03U
+} HAL_StatusTypeDef;
+
+typedef enum
+{
+    HAL_I2C_STATE_RESET = 0x00U,
+    HAL_I2C_STATE_READY = 0x20U
+} HAL_I2C_StateTypeDef;
+
+typedef struct
+{
+    volatile uint32_t CR1;
+} I2C_TypeDef;
+
+typedef struct
+{
+    I2C_TypeDef          *Instance;
+    HAL_I2C_StateTypeDef  State;
+} I2C_HandleTypeDef;
+
+#define I2C_CR1_SWRST                (1UL << 15)
+
+#define I2C_FIRST_FRAME              0x00000001U
+#define I2C_NEXT_FRAME               0x00000004U
+#define I2C_FIRST_AND_LAST_FRAME     0x00000008U
+#define I2C_LAST_FRAME               0x00000020U
+
+#define SET_BIT(REG, BIT)            ((REG) |= (BIT))
+#define CLEAR_BIT(REG, BIT)          ((REG) &= ~(BIT))
+
+#define __WFI()                      hal_stub_wfi()
+
+void              hal_stub_wfi(void);
+uint32_t          HAL_GetTick(void);
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef *hi2c);
+HAL_StatusTypeDef HAL_I2C_DeInit(I2C_HandleTypeDef *hi2c);
+HAL_I2C_StateTypeDef HAL_I2C_GetState(I2C_HandleTypeDef *hi2c);
+HAL_StatusTypeDef HAL_I2C_Master_Seq_Transmit_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress,
+                                                  uint8_t *pData, uint16_t Size, uint32_t XferOptions);
+HAL_StatusTypeDef HAL_I2C_Master_Seq_Receive_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress,
+                                                 uint8_t *pData, uint16_t Size, uint32_t XferOptions);
+HAL_StatusTypeDef HAL_I2C_Master_Abort_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress);
+void              HAL_I2C_MasterTxCpltCallback(I2C_HandleTypeDef *hi2c);
+void              HAL_I2C_MasterRxCpltCallback(I2C_HandleTypeDef *hi2c);
+void              HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c);
+
+#endif //__STM32F4XX_HAL_STUB_H__
@@ -0,0 +1,293 @@
+/**
+ * @file test_aht21_bus.c
+ * @brief 多AHT21总线管理器在软件仿真后端上的主机测试
+ *
+ * 测试提供的IIC事务接口模拟两个TCA9548类mux：写mux地址更新通道掩码，
+ * 访问0x38时转发到打开的通道上的仿真实例，多个通道同时打开视为地址冲突。
+ * 全部仿真实例共用一个虚拟时钟。覆盖：跨mux切换时关闭上一个mux、多个节点
+ * 触发后在一次转换时间内收集、mux无应答时经驱动流程重试以及失败时的结果码。
+ *
+ * @version 1.0
+ * @date 2024-07-26
+ *
+ * @par 依赖项
+ * - ec_bsp_aht21_bus.c
+ * - ec_bsp_aht21_driver.c 及其依赖的frame/comp/health
+ * - ec_bsp_aht21_sim.c
+ *
+ * @par 版本历史
+ * - 1.0 初始版本
+ *
+ * @par 作者
+ * - liyijie
+ */
+
+#include "aht21_test.h"
+#include "ec_bsp_aht21_bus.h"
+#include "ec_bsp_aht21_sim.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#define TEST_MUX_NUM                 2
+#define TEST_NODE_NUM                4
+
+// 仿真的mux
+typedef struct
+{
+    uint8_t  addr;
+    uint8_t  mask;               // 当前打开的通道
+    uint32_t writes;             // 成功写入次数
+    uint32_t nack;               // 之后的n次写入无应答
+} test_mux_t;
+
+// 节点布局 mux序号与通道号
+static const struct
+{
+    uint8_t mux;
+    uint8_t channel;
+} s_layout[TEST_NODE_NUM] = {{0, 0}, {0, 3}, {1, 2}, {0, 7}};
+
+static uint32_t s_now;
+static test_mux_t s_mux_sim[TEST_MUX_NUM];
+static aht21_sim_t s_sim[TEST_NODE_NUM];
+static uint32_t s_conflicts;
+
+static iic_driver_interface_t s_iic;
+static system_timebase_interface_t s_timebase;
+static bsp_aht21_t s_aht21[TEST_NODE_NUM];
+static aht21_iic_mux_t s_mux[TEST_MUX_NUM];
+static aht21_bus_node_t s_nodes[TEST_NODE_NUM];
+static bsp_aht21_t s_unused;
+static bsp_aht21_bus_t s_bus;
+
+/**
+ * @brief 访问0x38 转发到唯一打开的通道上的仿真实例
+ */
+static int8_t test_sensor_transfer(const iic_transaction_t *xfer)
+{
+    aht21_sim_t *target = NULL;
+    for (uint8_t i = 0; i < TEST_NODE_NUM; i++)
+    {
+        if (s_mux_sim[s_layout[i].mux].mask & (1U << s_layout[i].channel))
+        {
+            if (target != NULL)
+            {
+                s_conflicts++;
+                return -1;
+            }
+            target = &s_sim[i];
+        }
+    }
+    if (target == NULL)
+    {
+        return -1;
+    }
+    // 仿真的事务接口作用于最近绑定的实例 绑定前同步虚拟时钟
+    iic_driver_interface_t sim_iic;
+    system_timebase_interface_t sim_timebase;
+    target->now_ms = s_now;
+    aht21_sim_bind(target, &sim_iic, &sim_timebase, true);
+    return sim_iic.pfTransfer(xfer);
+}
+
+static int8_t test_transfer(const iic_transaction_t *xfer)
+{
+    for (uint8_t m = 0; m < TEST_MUX_NUM; m++)
+    {
+        if (xfer->addr != s_mux_sim[m].addr)
+        {
+            continue;
+        }
+        if (s_mux_sim[m].nack > 0)
+        {
+            s_mux_sim[m].nack--;
+            return -1;
+        }
+        if (xfer->seg_num != 1 || (xfer->segs[0].flags & IIC_SEG_READ) || xfer->segs[0].size != 1)
+        {
+            return -1;
+        }
+        s_mux_sim[m].mask = xfer->segs[0].pdata[0];
+        s_mux_sim[m].writes++;
+        return 0;
+    }
+    return test_sensor_transfer(xfer);
+}
+
+static int8_t test_iic_init(void)
+{
+    return 0;
+}
+
+static uint32_t test_get_tick(void)
+{
+    return s_now;
+}
+
+static void test_wait_until(uint32_t deadline_tick)
+{
+    if (!AHT21_TICK_REACHED(s_now, deadline_tick))
+    {
+        s_now = deadline_tick;
+    }
+}
+
+/**
+ * @brief 两个mux四个节点 各节点不同温度 逐个打开通道完成传感器初始化
+ */
+static void setup(void)
+{
+    s_now = 0;
+    s_conflicts = 0;
+    memset(&s_iic, 0, sizeof(s_iic));
+    s_iic.pfInit = test_iic_init;
+    s_iic.pfDeInit = test_iic_init;
+    s_iic.pfTransfer = test_transfer;
+    s_timebase.mcu_get_systick_count = test_get_tick;
+    s_timebase.pfwait_until = test_wait_until;
+
+    memset(s_mux_sim, 0, sizeof(s_mux_sim));
+    AHT21_CHECK_EQ(aht21_bus_inst(&s_bus, s_nodes, TEST_NODE_NUM), RET_CODE_SUCCESS);
+    for (uint8_t m = 0; m < TEST_MUX_NUM; m++)
+    {
+        s_mux_sim[m].addr = (uint8_t)(AHT21_BUS_MUX_ADDR_DEFAULT + m);
+        AHT21_CHECK_EQ(aht21_bus_mux_inst(&s_mux[m], &s_iic, s_mux_sim[m].addr), RET_CODE_SUCCESS);
+    }
+    for (uint8_t i = 0; i < TEST_NODE_NUM; i++)
+    {
+        aht21_sim_init(&s_sim[i], AHT21_ADDR);
+        s_sim[i].temp_centi = 2000 + 100 * i;
+        s_sim[i].humi_centi = 4000 + 500 * i;
+        memset(&s_aht21[i], 0, sizeof(s_aht21[i]));
+        AHT21_CHECK_EQ(aht21_inst(&s_aht21[i], &s_iic, &s_timebase, NULL), RET_CODE_SUCCESS);
+        s_mux_sim[s_layout[i].mux].mask = (uint8_t)(1U << s_layout[i].channel);
+        AHT21_CHECK_EQ(aht21_init(&s_aht21[i]), RET_CODE_SUCCESS);
+        s_mux_sim[s_layout[i].mux].mask = AHT21_BUS_MUX_CHANNEL_NONE;
+        AHT21_CHECK_EQ(aht21_bus_add(&s_bus, &s_aht21[i], &s_mux[s_layout[i].mux], s_layout[i].channel), i);
+    }
+}
+
+/**
+ * @brief 参数检查 节点与mux须在同一总线
+ */
+static void test_add(void)
+{
+    setup();
+    aht21_bus_node_t node;
+    bsp_aht21_bus_t bus;
+    iic_driver_interface_t other;
+    memset(&other, 0, sizeof(other));
+    other.pfInit = test_iic_init;
+    other.pfDeInit = test_iic_init;
+    other.pfTransfer = test_transfer;
+    AHT21_CHECK_EQ(aht21_bus_inst(&bus, &node, 1), RET_CODE_SUCCESS);
+    AHT21_CHECK_EQ(aht21_bus_add(&bus, &s_aht21[0], &s_mux[0], AHT21_BUS_MUX_CHANNEL_NUM),
+                   RET_CODE_ERROR_PARAM_NULL);
+    memset(&s_unused, 0, sizeof(s_unused));
+    AHT21_CHECK_EQ(aht21_inst(&s_unused, &other, &s_timebase, NULL), RET_CODE_SUCCESS);
+    AHT21_CHECK_EQ(aht21_bus_add(&bus, &s_unused, &s_mux[0], 0), RET_CODE_ERROR_PARAM_NULL);
+    AHT21_CHECK_EQ(aht21_bus_add(&s_bus, &s_aht21[0], &s_mux[0], 1), RET_CODE_ERROR_PARAM_NULL);
+    AHT21_CHECK(s_mux[0].aht21_instance == &s_aht21[0]);
+    AHT21_CHECK(s_mux[1].aht21_instance == &s_aht21[2]);
+}
+
+/**
+ * @brief 触发并收集全部节点 总耗时约为一次转换 跨mux时先关闭上一个mux
+ */
+static void test_sample_all(void)
+{
+    setup();
+    uint32_t start = s_now;
+    AHT21_CHECK_EQ(aht21_bus_sample_all(&s_bus), RET_CODE_SUCCESS);
+    AHT21_CHECK(s_now - start >= AHT21_MEASUREMENT_DELAY_MS);
+    AHT21_CHECK(s_now - start < 2U * AHT21_MEASUREMENT_DELAY_MS);
+    AHT21_CHECK_EQ(s_conflicts, 0);
+    for (uint8_t i = 0; i < TEST_NODE_NUM; i++)
+    {
+        AHT21_CHECK_EQ(s_nodes[i].code, RET_CODE_SUCCESS);
+        AHT21_CHECK(fabsf(s_nodes[i].temp - (20.0f + (float)i)) < 0.001f);
+        AHT21_CHECK(fabsf(s_nodes[i].humi - (40.0f + 5.0f * (float)i)) < 0.001f);
+        AHT21_CHECK_EQ(s_sim[i].stats.triggers, 1);
+        AHT21_CHECK_EQ(s_sim[i].stats.busy_reads, 0);
+    }
+    // 触发: mux0通道0 3  关mux0 mux1通道2  关mux1 mux0通道7
+    // 收集: mux0通道0 3  关mux0 mux1通道2  关mux1 mux0通道7
+    AHT21_CHECK_EQ(s_mux_sim[0].writes, 8);
+    AHT21_CHECK_EQ(s_mux_sim[1].writes, 4);
+    AHT21_CHECK_EQ(s_mux[0].channel_mask, 1U << 7);
+    AHT21_CHECK_EQ(s_mux[1].channel_mask, AHT21_BUS_MUX_CHANNEL_NONE);
+    AHT21_CHECK(s_bus.active_mux == &s_mux[0]);
+
+    // 第二轮 切换序列相同 缓存的掩码与mux一致
+    AHT21_CHECK_EQ(aht21_bus_sample_all(&s_bus), RET_CODE_SUCCESS);
+    AHT21_CHECK_EQ(s_mux_sim[0].writes, 16);
+    AHT21_CHECK_EQ(s_mux_sim[1].writes, 8);
+    AHT21_CHECK_EQ(s_mux[0].channel_mask, s_mux_sim[0].mask);
+    AHT21_CHECK_EQ(s_mux[1].channel_mask, s_mux_sim[1].mask);
+    AHT21_CHECK_EQ(s_conflicts, 0);
+
+    // 只有一个节点时通道保持打开 不重复写mux
+    aht21_bus_node_t node;
+    bsp_aht21_bus_t bus;
+    AHT21_CHECK_EQ(aht21_bus_inst(&bus, &node, 1), RET_CODE_SUCCESS);
+    AHT21_CHECK_EQ(aht21_bus_add(&bus, &s_aht21[3], &s_mux[0], 7), 0);
+    AHT21_CHECK_EQ(aht21_bus_sample_all(&bus), RET_CODE_SUCCESS);
+    AHT21_CHECK_EQ(aht21_bus_sample_all(&bus), RET_CODE_SUCCESS);
+    AHT21_CHECK_EQ(s_mux_sim[0].writes, 16);
+    AHT21_CHECK(fabsf(node.temp - 23.0f) < 0.001f);
+}
+
+/**
+ * @brief mux偶发无应答时退避重试成功 故障计入该mux借用的实例
+ */
+static void test_mux_retry(void)
+{
+    setup();
+    s_mux_sim[1].nack = 2;
+    AHT21_CHECK_EQ(aht21_bus_sample_all(&s_bus), RET_CODE_SUCCESS);
+    aht21_fault_stats_t fault;
+    AHT21_CHECK_EQ(aht21_get_fault_stats(&s_aht21[2], &fault), RET_CODE_SUCCESS);
+    AHT21_CHECK_EQ(fault.retry, 2);
+    AHT21_CHECK_EQ(fault.recovered, 1);
+    AHT21_CHECK_EQ(fault.nack, 2);
+    AHT21_CHECK_EQ(fault.soft_reset, 0);
+    AHT21_CHECK(fabsf(s_nodes[2].temp - 22.0f) < 0.001f);
+    AHT21_CHECK_EQ(s_conflicts, 0);
+}
+
+/**
+ * @brief mux持续无应答 其下节点失败 缓存的通道掩码不变 其余节点照常收集
+ */
+static void test_mux_fail(void)
+{
+    setup();
+    s_mux_sim[1].nack = 1000;
+    AHT21_CHECK_EQ(aht21_bus_sample_all(&s_bus), RET_CODE_AHT21_IIC_FAIL);
+    AHT21_CHECK_EQ(s_nodes[2].code, RET_CODE_AHT21_IIC_FAIL);
+    AHT21_CHECK_EQ(s_mux[1].channel_mask, 0xFF);
+    AHT21_CHECK_EQ(s_sim[2].stats.triggers, 0);
+    aht21_fault_stats_t fault;
+    AHT21_CHECK_EQ(aht21_get_fault_stats(&s_aht21[2], &fault), RET_CODE_SUCCESS);
+    AHT21_CHECK_EQ(fault.retry, AHT21_IIC_RETRY_MAX);
+    AHT21_CHECK_EQ(fault.soft_reset, 0);
+    for (uint8_t i = 0; i < TEST_NODE_NUM; i++)
+    {
+        if (i != 2)
+        {
+            AHT21_CHECK_EQ(s_nodes[i].code, RET_CODE_SUCCESS);
+            AHT21_CHECK(fabsf(s_nodes[i].temp - (20.0f + (float)i)) < 0.001f);
+        }
+    }
+    AHT21_CHECK_EQ(s_conflicts, 0);
+}
+
+int main(void)
+{
+    test_add();
+    test_sample_all();
+    test_mux_retry();
+    test_mux_fail();
+    return AHT21_TEST_RESULT("test_aht21_bus");
+}
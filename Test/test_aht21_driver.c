@@ -0,0 +1,450 @@
+/**
+ * @file test_aht21_driver.c
+ * @brief 驱动在软件仿真后端上的主机测试
+ *
+ * 覆盖：原始码换算、字节级与事务两种IIC接口、非阻塞接口返回码、总线故障恢复、
+ * 等待接口、周期采样、校准与补偿、健康监测、分阶段追踪。
+ *
+ * 以AHT21_CFG_TRACE=1编译驱动，见Makefile。
+ *
+ * @version 1.0
+ * @date 2024-07-26
+ *
+ * @par 依赖项
+ * - ec_bsp_aht21_driver.c 及其依赖的frame/comp/trace/health
+ * - ec_bsp_aht21_sim.c
+ *
+ * @par 版本历史
+ * - 1.0 初始版本
+ *
+ * @par 作者
+ * - liyijie
+ */
+
+#include "aht21_test.h"
+#include "ec_bsp_aht21_sim.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+static aht21_sim_t s_sim;
+static iic_driver_interface_t s_iic;
+static system_timebase_interface_t s_timebase;
+static bsp_aht21_t s_aht21;
+
+/**
+ * @brief 仿真实例+驱动实例 use_yield为true时不提供pfwait_until 驱动循环pfyield
+ */
+static void setup(bool use_transfer, bool use_yield)
+{
+    memset(&s_aht21, 0, sizeof(s_aht21));
+    aht21_sim_init(&s_sim, AHT21_ADDR);
+    aht21_sim_bind(&s_sim, &s_iic, &s_timebase, use_transfer);
+    if (use_yield)
+    {
+        s_timebase.pfwait_until = NULL;
+    }
+    AHT21_CHECK_EQ(aht21_inst(&s_aht21, &s_iic, &s_timebase, use_yield ? (void *)aht21_sim_yield : NULL),
+                   RET_CODE_SUCCESS);
+    AHT21_CHECK_EQ(aht21_init(&s_aht21), RET_CODE_SUCCESS);
+}
+
+// 波形 温度在25摄氏度附近小幅抖动 湿度在50%RH附近小幅抖动
+static int32_t wave_temp_noise(uint32_t now_ms, void *arg)
+{
+    (void)arg;
+    return 2500 + (int32_t)((now_ms * 7919U) % 13U);
+}
+
+static int32_t wave_humi_noise(uint32_t now_ms, void *arg)
+{
+    (void)arg;
+    return 5000 + (int32_t)((now_ms * 104729U) % 17U);
+}
+
+static int32_t wave_temp_ramp(uint32_t now_ms, void *arg)
+{
+    (void)arg;
+    return 2000 + (int32_t)(now_ms % 1000U);
+}
+
+/**
+ * @brief 原始码定点换算 全部2^20个码与双精度公式比较 仿真的逆换算往返一致
+ */
+static void test_convert(void)
+{
+    unsigned long bad = 0;
+    for (uint32_t raw = 0; raw < (1UL << 20); raw++)
+    {
+        double temp = raw * 200.0 / 1048576.0 - 50.0;
+        double humi = raw * 100.0 / 1048576.0;
+        if (fabs(aht21_raw_to_temp_centi(raw) - temp * 100.0) > 0.5001 ||
+            fabs(aht21_raw_to_humi_centi(raw) - humi * 100.0) > 0.5001)
+        {
+            bad++;
+        }
+    }
+    AHT21_CHECK_EQ(bad, 0);
+
+    bad = 0;
+    for (int32_t centi = -5000; centi <= 15000; centi++)
+    {
+        bad += (aht21_raw_to_temp_centi(aht21_sim_temp_to_raw(centi)) != centi);
+    }
+    for (int32_t centi = 0; centi <= 10000; centi++)
+    {
+        bad += (aht21_raw_to_humi_centi(aht21_sim_humi_to_raw(centi)) != centi);
+    }
+    AHT21_CHECK_EQ(bad, 0);
+}
+
+/**
+ * @brief 两种IIC接口读到仿真设定的温湿度
+ */
+static void test_sim_read(void)
+{
+    for (int mode = 0; mode < 2; mode++)
+    {
+        setup(mode != 0, false);
+        s_sim.temp_centi = -1234;
+        s_sim.humi_centi = 6789;
+        float temp = 0.0f;
+        float humi = 0.0f;
+        AHT21_CHECK_EQ(aht21_read_data(&s_aht21, &temp, &humi), RET_CODE_SUCCESS);
+        AHT21_CHECK(fabsf(temp - (-12.34f)) < 0.001f);
+        AHT21_CHECK(fabsf(humi - 67.89f) < 0.001f);
+
+        // 波形按触发时刻取值
+        s_sim.pftemp_wave = wave_temp_ramp;
+        int16_t temp_centi;
+        uint16_t humi_centi;
+        AHT21_CHECK_EQ(aht21_start(&s_aht21), RET_CODE_SUCCESS);
+        uint32_t trigger = s_sim.now_ms;
+        aht21_sim_advance(&s_sim, 100);
+        AHT21_CHECK_EQ(aht21_fetch_centi(&s_aht21, &temp_centi, &humi_centi), RET_CODE_SUCCESS);
+        AHT21_CHECK_EQ(temp_centi, wave_temp_ramp(trigger, NULL));
+        AHT21_CHECK_EQ(humi_centi, 6789);
+    }
+}
+
+/**
+ * @brief 未触发测量与转换未完成的返回码
+ */
+static void test_fetch_codes(void)
+{
+    setup(true, false);
+    aht21_raw_data_t raw;
+    AHT21_CHECK_EQ(aht21_fetch_raw(&s_aht21, &raw), RET_CODE_AHT21_STATE_ERROR);
+    AHT21_CHECK_EQ(aht21_start(&s_aht21), RET_CODE_SUCCESS);
+    AHT21_CHECK_EQ(aht21_fetch_raw(&s_aht21, &raw), RET_CODE_AHT21_BUSY);
+    aht21_wait_until(&s_aht21, s_aht21.meas_deadline);
+    AHT21_CHECK_EQ(aht21_fetch_raw(&s_aht21, &raw), RET_CODE_SUCCESS);
+    AHT21_CHECK_EQ(raw.temp_raw, aht21_sim_temp_to_raw(2500));
+}
+
+/**
+ * @brief wait_until与yield两种等待方式 都不提前读取
+ */
+static void test_wait(void)
+{
+    for (int mode = 0; mode < 2; mode++)
+    {
+        setup(true, mode != 0);
+        uint32_t start = s_sim.now_ms;
+        float temp;
+        float humi;
+        for (int i = 0; i < 100; i++)
+        {
+            AHT21_CHECK_EQ(aht21_read_data(&s_aht21, &temp, &humi), RET_CODE_SUCCESS);
+        }
+        AHT21_CHECK_EQ((s_sim.now_ms - start) / 100U, AHT21_MEASUREMENT_DELAY_MS);
+        AHT21_CHECK_EQ(s_sim.stats.busy_reads, 0);
+    }
+}
+
+/**
+ * @brief 周期采样 按绝对时刻推进 恰好到期不算错过
+ */
+static void test_periodic(void)
+{
+    setup(true, false);
+    aht21_periodic_t periodic;
+    aht21_sample_t sample;
+    AHT21_CHECK_EQ(aht21_periodic_start(&s_aht21, &periodic, 1000, NULL), RET_CODE_SUCCESS);
+    uint32_t first = 0;
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        AHT21_CHECK_EQ(aht21_periodic_step(&s_aht21, &periodic, &sample), RET_CODE_SUCCESS);
+        if (i == 0)
+        {
+            first = sample.timestamp;
+        }
+        AHT21_CHECK_EQ(sample.timestamp, first + i * 1000U);
+    }
+    AHT21_CHECK_EQ(periodic.missed, 0);
+
+    // 周期等于一次采样耗时 每个周期都恰好到期
+    uint32_t took = s_sim.now_ms - sample.timestamp;
+    periodic.period_ms = took;
+    periodic.next_deadline = s_sim.now_ms;
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        uint32_t due = periodic.next_deadline;
+        AHT21_CHECK_EQ(aht21_periodic_step(&s_aht21, &periodic, &sample), RET_CODE_SUCCESS);
+        AHT21_CHECK_EQ(sample.timestamp, due);
+    }
+    AHT21_CHECK_EQ(periodic.missed, 0);
+
+    // 周期短于采样耗时 跳过已错过的周期
+    periodic.period_ms = 50;
+    periodic.next_deadline = s_sim.now_ms;
+    AHT21_CHECK_EQ(aht21_periodic_step(&s_aht21, &periodic, &sample), RET_CODE_SUCCESS);
+    AHT21_CHECK_EQ(periodic.missed, (took - 50U + 49U) / 50U);
+    AHT21_CHECK(AHT21_TICK_REACHED(periodic.next_deadline, s_sim.now_ms));
+}
+
+/**
+ * @brief NACK重试与SDA卡死恢复
+ */
+static void test_recovery(void)
+{
+    for (int mode = 0; mode < 2; mode++)
+    {
+        setup(mode != 0, true);
+        s_sim.nack_interval = 3;
+        float temp;
+        float humi;
+        int ok = 0;
+        for (int i = 0; i < 200; i++)
+        {
+            if (i == 100)
+            {
+                s_sim.bus_stuck = true;
+            }
+            ok += (aht21_read_data(&s_aht21, &temp, &humi) == RET_CODE_SUCCESS);
+        }
+        aht21_fault_stats_t fault;
+        AHT21_CHECK_EQ(aht21_get_fault_stats(&s_aht21, &fault), RET_CODE_SUCCESS);
+        // 卡死后的第一次读取失败 解锁和软复位后恢复
+        AHT21_CHECK_EQ(ok, 199);
+        AHT21_CHECK(fault.nack > 0);
+        AHT21_CHECK(fault.retry > 0);
+        AHT21_CHECK_EQ(fault.bus_recover, 1);
+        AHT21_CHECK_EQ(fault.soft_reset, 1);
+        AHT21_CHECK_EQ(s_sim.stats.bus_recovers, 1);
+        AHT21_CHECK(fabsf(temp - 25.0f) < 0.001f);
+
+        // 传感器一直忙 转换超时
+        s_sim.nack_interval = 0;
+        s_sim.bus_stuck = false;
+        s_sim.conv_latency_ms = 1000;
+        AHT21_CHECK_EQ(aht21_read_data(&s_aht21, &temp, &humi), RET_CODE_AHT21_TIMEOUT);
+    }
+}
+
+/**
+ * @brief 参考体感温度(NWS) 摄氏度
+ */
+static double ref_heat_index(double temp, double humi)
+{
+    double f = temp * 1.8 + 32.0;
+    double hi = -42.379 + 2.04901523 * f + 10.14333127 * humi - 0.22475541 * f * humi -
+                0.00683783 * f * f - 0.05481717 * humi * humi + 0.00122874 * f * f * humi +
+                0.00085282 * f * humi * humi - 0.00000199 * f * f * humi * humi;
+    return (hi - 32.0) / 1.8;
+}
+
+/**
+ * @brief 定点补偿与libm参考比较 驱动输出按校准参数换算 浮点输出与定点输出一致
+ */
+static void test_comp(void)
+{
+    double max_dp = 0.0;
+    double max_ah = 0.0;
+    for (int32_t t = -4000; t <= 8500; t += 7)
+    {
+        for (int32_t h = 10; h <= 10000; h += 13)
+        {
+            double temp = t / 100.0;
+            double humi = h / 100.0;
+            double gamma = log(humi / 100.0) + 17.62 * temp / (243.12 + temp);
+            double dp = 243.12 * gamma / (17.62 - gamma);
+            double ah = 6.112 * exp(17.62 * temp / (243.12 + temp)) * humi * 2.1674 / (273.15 + temp);
+            double err_dp = fabs(aht21_comp_dew_point((int16_t)t, (uint16_t)h) / 100.0 - dp);
+            double err_ah = fabs(aht21_comp_abs_humi((int16_t)t, (uint16_t)h) / 100.0 - ah);
+            max_dp = (err_dp > max_dp) ? err_dp : max_dp;
+            max_ah = (err_ah > max_ah && ah < 650.0) ? err_ah : max_ah;
+        }
+    }
+    printf("comp: max error dew point %.3f C, abs humidity %.3f g/m3\n", max_dp, max_ah);
+    AHT21_CHECK(max_dp < 0.05);
+    AHT21_CHECK(max_ah < 0.05);
+    AHT21_CHECK(fabs(aht21_comp_heat_index(3200, 7000) / 100.0 - ref_heat_index(32.0, 70.0)) < 0.2);
+    AHT21_CHECK(fabs(aht21_comp_heat_index(3500, 4000) / 100.0 - ref_heat_index(35.0, 40.0)) < 0.2);
+
+    // 驱动定点输出等于未校准输出经aht21_comp_calibrate换算 浮点输出等于定点输出乘0.01
+    setup(true, false);
+    aht21_calib_t calib = {-50, 120, AHT21_COMP_GAIN_ONE + 164, AHT21_COMP_GAIN_ONE - 82};
+    unsigned long bad = 0;
+    for (int32_t t = -3000; t <= 8000; t += 37)
+    {
+        s_sim.temp_centi = t;
+        s_sim.humi_centi = (t + 3000) % 10001;
+        int16_t temp_centi[2];
+        uint16_t humi_centi[2];
+        for (int i = 0; i < 2; i++)
+        {
+            AHT21_CHECK_EQ(aht21_set_calib(&s_aht21, (i == 0) ? NULL : &calib), RET_CODE_SUCCESS);
+            AHT21_CHECK_EQ(aht21_start(&s_aht21), RET_CODE_SUCCESS);
+            aht21_wait_until(&s_aht21, s_aht21.meas_deadline);
+            AHT21_CHECK_EQ(aht21_fetch_centi(&s_aht21, &temp_centi[i], &humi_centi[i]), RET_CODE_SUCCESS);
+        }
+        int16_t temp_ref;
+        uint16_t humi_ref;
+        aht21_comp_calibrate(&calib, temp_centi[0], humi_centi[0], &temp_ref, &humi_ref);
+        float temp;
+        float humi;
+        AHT21_CHECK_EQ(aht21_read_data(&s_aht21, &temp, &humi), RET_CODE_SUCCESS);
+        bad += (temp_centi[1] != temp_ref || humi_centi[1] != humi_ref);
+        bad += (temp != temp_centi[1] * 0.01f || humi != humi_centi[1] * 0.01f);
+    }
+    AHT21_CHECK_EQ(bad, 0);
+}
+
+/**
+ * @brief 采集n个样本后的健康标志
+ */
+static uint8_t health_run(void (*scenario)(aht21_sim_t *sim), uint16_t n, aht21_health_t *health)
+{
+    aht21_sample_t samples[40];
+    setup(true, false);
+    aht21_set_crc(&s_aht21, true, 2);
+    scenario(&s_sim);
+    AHT21_CHECK(n <= sizeof(samples) / sizeof(samples[0]));
+    aht21_read_burst(&s_aht21, samples, n, 100);
+    AHT21_CHECK_EQ(aht21_get_health(&s_aht21, health), RET_CODE_SUCCESS);
+    return health->flags;
+}
+
+static void scenario_noise(aht21_sim_t *sim)
+{
+    sim->pftemp_wave = wave_temp_noise;
+    sim->pfhumi_wave = wave_humi_noise;
+}
+
+static void scenario_fixed(aht21_sim_t *sim)
+{
+    (void)sim;
+}
+
+static void scenario_nack(aht21_sim_t *sim)
+{
+    scenario_noise(sim);
+    sim->nack_interval = 4;
+}
+
+static void scenario_flip(aht21_sim_t *sim)
+{
+    scenario_noise(sim);
+    sim->flip_interval = 20;
+}
+
+static void scenario_hot(aht21_sim_t *sim)
+{
+    sim->pfhumi_wave = wave_humi_noise;
+    sim->temp_centi = 13000;
+}
+
+/**
+ * @brief 健康监测 各类故障场景
+ */
+static void test_health(void)
+{
+    aht21_health_t health;
+    AHT21_CHECK_EQ(health_run(scenario_noise, 40, &health), 0);
+    AHT21_CHECK_EQ(health.state, AHT21_HEALTH_OK);
+    AHT21_CHECK_EQ(health.stats.samples, 40);
+
+    AHT21_CHECK_EQ(health_run(scenario_fixed, 40, &health), AHT21_HEALTH_F_STUCK);
+    AHT21_CHECK_EQ(health.stats.stuck_events, 1);
+
+    AHT21_CHECK(health_run(scenario_nack, 40, &health) & AHT21_HEALTH_F_COMM);
+    AHT21_CHECK(health_run(scenario_flip, 40, &health) & AHT21_HEALTH_F_CRC);
+
+    AHT21_CHECK_EQ(health_run(scenario_hot, 20, &health), AHT21_HEALTH_F_RANGE);
+    AHT21_CHECK_EQ(health.stats.range_violations, 20);
+
+    // 默认阈值下单次NACK不告警 连续两次告警
+    aht21_health_reset(&health, NULL);
+    aht21_health_input_t in;
+    memset(&in, 0, sizeof(in));
+    in.temp = 2500;
+    in.humi = 5000;
+    // 第1次孤立错误 之后足够多的正常测量让错误率衰减 最后连续两次错误
+    const uint8_t n = 48;
+    for (uint8_t i = 0; i < n; i++)
+    {
+        in.tick += 1000U;
+        in.temp_raw = 0x60000U + i;
+        in.humi_raw = 0x80000U + i;
+        in.comm_errors += (i == 1 || i >= n - 2U) ? 1U : 0U;
+        aht21_health_update(&health, &in);
+        AHT21_CHECK_EQ((health.flags & AHT21_HEALTH_F_COMM) != 0, i == n - 1U);
+    }
+}
+
+// 追踪时钟 仿真时间的微秒
+static uint32_t trace_clock(void)
+{
+    return s_sim.now_ms * 1000U;
+}
+
+/**
+ * @brief 分阶段追踪 自适应等待下每次读取各阶段一条事件
+ */
+static void test_trace(void)
+{
+    setup(true, false);
+    s_sim.conv_jitter_ms = 20;
+    AHT21_CHECK_EQ(aht21_set_wait_mode(&s_aht21, AHT21_WAIT_MODE_ADAPTIVE, 0, 0), RET_CODE_SUCCESS);
+    aht21_trace_stats_t stats;
+    aht21_trace_init(trace_clock, 1000000U);
+    aht21_trace_stats_reset(&stats);
+    float temp;
+    float humi;
+    for (int i = 0; i < 1000; i++)
+    {
+        AHT21_CHECK_EQ(aht21_read_data(&s_aht21, &temp, &humi), RET_CODE_SUCCESS);
+        if (i % 10 == 0)
+        {
+            aht21_trace_drain(&stats, NULL);
+        }
+    }
+    aht21_trace_drain(&stats, NULL);
+    AHT21_CHECK_EQ(aht21_trace_dropped(), 0);
+    aht21_trace_summary_t summary;
+    for (int phase = AHT21_TRACE_PHASE_TRIGGER; phase <= AHT21_TRACE_PHASE_DECODE; phase++)
+    {
+        aht21_trace_summary(&stats, (aht21_trace_phase_t)phase, &summary);
+        AHT21_CHECK_EQ(summary.count, 1000);
+    }
+    aht21_trace_summary(&stats, AHT21_TRACE_PHASE_WAIT, &summary);
+    AHT21_CHECK(summary.min >= AHT21_MEASUREMENT_DELAY_MS * 1000U);
+    AHT21_CHECK(summary.max <= (AHT21_MEASUREMENT_DELAY_MS + 30U) * 1000U);
+    AHT21_CHECK(summary.min <= summary.avg && summary.avg <= summary.max);
+}
+
+int main(void)
+{
+    test_convert();
+    test_sim_read();
+    test_fetch_codes();
+    test_recovery();
+    test_wait();
+    test_periodic();
+    test_comp();
+    test_health();
+    test_trace();
+    return AHT21_TEST_RESULT("test_aht21_driver");
+}
@@ -0,0 +1,220 @@
+/**
+ * @file test_aht21_frame.c
+ * @brief 测量帧解码与CRC-8的穷举测试
+ *
+ * 每个通道遍历全部2^20个原始码，另一通道与状态字节随之变化，逐帧与按位
+ * 拼接的参考解码比较；批量解码按6字节和7字节两种间隔各跑一遍。CRC-8查表
+ * 与逐位计算的参考实现比较全部单字节输入及上述全部帧。
+ *
+ * @version 1.0
+ * @date 2024-07-26
+ *
+ * @par 依赖项
+ * - ec_bsp_aht21_frame.c
+ *
+ * @par 版本历史
+ * - 1.0 初始版本
+ *
+ * @par 作者
+ * - liyijie
+ */
+
+#include "aht21_test.h"
+#include "ec_bsp_aht21_frame.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#define TEST_CODE_NUM                (1UL << 20)
+#define TEST_BATCH_LEN               4096U
+
+// 通道 被遍历的一侧取全部原始码 另一侧取其置换
+typedef enum
+{
+	TEST_SWEEP_HUMI = 0,
+	TEST_SWEEP_TEMP,
+	TEST_SWEEP_NUM,
+}test_sweep_t;
+
+static uint8_t s_frames[TEST_BATCH_LEN * AHT21_FRAME_CRC_LEN];
+static aht21_raw_data_t s_expect[TEST_BATCH_LEN];
+static aht21_raw_data_t s_batch[TEST_BATCH_LEN];
+
+/**
+ * @brief 参考CRC-8 逐位计算
+ */
+static uint8_t ref_crc8(const uint8_t *pdata, uint8_t size)
+{
+    uint8_t crc = AHT21_CRC8_INIT;
+    for (uint8_t i = 0; i < size; i++)
+    {
+        crc ^= pdata[i];
+        for (uint8_t bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ AHT21_CRC8_POLY) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+/**
+ * @brief 参考解码 把前6字节按大端拼成48位后取字段
+ */
+static void ref_decode(const uint8_t *frame, aht21_raw_data_t *raw)
+{
+    uint64_t bits = 0;
+    for (uint8_t i = 0; i < AHT21_FRAME_LEN; i++)
+    {
+        bits = (bits << 8) | frame[i];
+    }
+    raw->status = (uint8_t)(bits >> 40);
+    raw->humi_raw = (uint32_t)(bits >> 20) & 0xFFFFFU;
+    raw->temp_raw = (uint32_t)bits & 0xFFFFFU;
+}
+
+/**
+ * @brief 按字段拼帧 第7字节为CRC
+ */
+static void make_frame(uint8_t status, uint32_t humi, uint32_t temp, uint8_t *frame)
+{
+    uint64_t bits = ((uint64_t)status << 40) | ((uint64_t)humi << 20) | temp;
+    for (uint8_t i = 0; i < AHT21_FRAME_LEN; i++)
+    {
+        frame[i] = (uint8_t)(bits >> (8 * (AHT21_FRAME_LEN - 1 - i)));
+    }
+    frame[AHT21_FRAME_LEN] = ref_crc8(frame, AHT21_FRAME_LEN);
+}
+
+/**
+ * @brief 原始码的置换 使另一通道也覆盖各个位
+ */
+static uint32_t scramble(uint32_t code)
+{
+    return (code * 0x9E3B5U + 0x5A5A5U) & 0xFFFFFU;
+}
+
+/**
+ * @brief 比较解码结果 只打印第一处不一致
+ */
+static unsigned long compare(const aht21_raw_data_t *actual, const aht21_raw_data_t *expect,
+                             const char *what, uint32_t code, unsigned long *reported)
+{
+    if (actual->humi_raw == expect->humi_raw && actual->temp_raw == expect->temp_raw &&
+        actual->status == expect->status)
+    {
+        return 0;
+    }
+    if ((*reported)++ == 0)
+    {
+        printf("%s code 0x%05lX: humi 0x%05lX/0x%05lX temp 0x%05lX/0x%05lX status 0x%02X/0x%02X\n",
+               what, (unsigned long)code,
+               (unsigned long)actual->humi_raw, (unsigned long)expect->humi_raw,
+               (unsigned long)actual->temp_raw, (unsigned long)expect->temp_raw,
+               actual->status, expect->status);
+    }
+    return 1;
+}
+
+/**
+ * @brief 遍历一个通道的全部原始码
+ */
+static void test_sweep(test_sweep_t sweep)
+{
+    unsigned long bad_decode = 0;
+    unsigned long bad_batch = 0;
+    unsigned long bad_crc = 0;
+    unsigned long bad_ready = 0;
+    unsigned long reported = 0;
+    for (uint32_t base = 0; base < TEST_CODE_NUM; base += TEST_BATCH_LEN)
+    {
+        uint32_t ready = 0;
+        for (uint32_t i = 0; i < TEST_BATCH_LEN; i++)
+        {
+            uint32_t code = base + i;
+            uint8_t status = (uint8_t)(code ^ (code >> 8));
+            uint32_t humi = (sweep == TEST_SWEEP_HUMI) ? code : scramble(code);
+            uint32_t temp = (sweep == TEST_SWEEP_TEMP) ? code : scramble(code);
+            uint8_t *frame = &s_frames[i * AHT21_FRAME_CRC_LEN];
+            make_frame(status, humi, temp, frame);
+
+            aht21_raw_data_t raw;
+            ref_decode(frame, &s_expect[i]);
+            aht21_frame_decode(frame, &raw);
+            bad_decode += compare(&raw, &s_expect[i], "decode", code, &reported);
+            if (aht21_frame_crc8(frame, AHT21_FRAME_LEN) != frame[AHT21_FRAME_LEN])
+            {
+                bad_crc++;
+            }
+            ready += (s_expect[i].status & AHT21_STATUS_BUSY_MASK) ? 0U : 1U;
+        }
+        // 7字节间隔 即原样连续存放的CRC帧
+        if (aht21_frame_decode_batch(s_frames, AHT21_FRAME_CRC_LEN, TEST_BATCH_LEN, s_batch) != ready)
+        {
+            bad_ready++;
+        }
+        for (uint32_t i = 0; i < TEST_BATCH_LEN; i++)
+        {
+            bad_batch += compare(&s_batch[i], &s_expect[i], "batch7", base + i, &reported);
+        }
+        // 6字节间隔 就地去掉CRC字节
+        for (uint32_t i = 0; i < TEST_BATCH_LEN; i++)
+        {
+            memmove(&s_frames[i * AHT21_FRAME_LEN], &s_frames[i * AHT21_FRAME_CRC_LEN], AHT21_FRAME_LEN);
+        }
+        memset(s_batch, 0, sizeof(s_batch));
+        if (aht21_frame_decode_batch(s_frames, AHT21_FRAME_LEN, TEST_BATCH_LEN, s_batch) != ready)
+        {
+            bad_ready++;
+        }
+        for (uint32_t i = 0; i < TEST_BATCH_LEN; i++)
+        {
+            bad_batch += compare(&s_batch[i], &s_expect[i], "batch6", base + i, &reported);
+        }
+    }
+    printf("%s sweep: %lu codes\n", (sweep == TEST_SWEEP_HUMI) ? "humi" : "temp", TEST_CODE_NUM);
+    AHT21_CHECK_EQ(bad_decode, 0);
+    AHT21_CHECK_EQ(bad_batch, 0);
+    AHT21_CHECK_EQ(bad_crc, 0);
+    AHT21_CHECK_EQ(bad_ready, 0);
+}
+
+/**
+ * @brief CRC表 全部单字节输入及边界长度
+ */
+static void test_crc_table(void)
+{
+    unsigned long bad = 0;
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        uint8_t byte = (uint8_t)i;
+        if (aht21_frame_crc8(&byte, 1) != ref_crc8(&byte, 1))
+        {
+            bad++;
+        }
+    }
+    AHT21_CHECK_EQ(bad, 0);
+    // 空输入为初值
+    AHT21_CHECK_EQ(aht21_frame_crc8(NULL, 0), AHT21_CRC8_INIT);
+}
+
+/**
+ * @brief busy位
+ */
+static void test_busy(void)
+{
+    AHT21_CHECK_EQ(aht21_frame_is_busy(0x80), 1);
+    AHT21_CHECK_EQ(aht21_frame_is_busy(0x7F), 0);
+    AHT21_CHECK_EQ(aht21_frame_is_busy(0x98), 1);
+    AHT21_CHECK_EQ(aht21_frame_is_busy(0x18), 0);
+}
+
+int main(void)
+{
+    test_crc_table();
+    test_busy();
+    for (int sweep = 0; sweep < TEST_SWEEP_NUM; sweep++)
+    {
+        test_sweep((test_sweep_t)sweep);
+    }
+    return AHT21_TEST_RESULT("test_aht21_frame");
+}
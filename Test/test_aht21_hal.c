@@ -0,0 +1,292 @@
+/**
+ * @file test_aht21_hal.c
+ * @brief 静态分派模式下工程提供的HAL后端(ec_bsp_aht21_backend.h)的主机测试
+ *
+ * 以AHT21_CFG_BACKEND_HEADER="ec_bsp_aht21_backend.h"编译驱动，并编译
+ * ec_bsp_iic_hal_seq.c和ec_bsp_aht21_wait.c。HAL替身把顺序DMA的各段拼成事务
+ * 交给软件仿真，完成/出错回调在传输任务阻塞(信号量或WFI)时模拟中断调用。
+ * 覆盖：读数与等待、调度器启动前的WFI路径、无应答、DMA不完成时每段超时有界。
+ *
+ * @version 1.0
+ * @date 2024-07-26
+ *
+ * @par 依赖项
+ * - ec_bsp_aht21_driver.c 及其依赖的frame/comp/health
+ * - ec_bsp_iic_hal_seq.c ec_bsp_aht21_wait.c
+ * - ec_bsp_aht21_sim.c
+ * - stub目录下的HAL与FreeRTOS替身
+ *
+ * @par 版本历史
+ * - 1.0 初始版本
+ *
+ * @par 作者
+ * - liyijie
+ */
+
+#include "aht21_test.h"
+#include "ec_bsp_aht21_sim.h"
+#include "FreeRTOS.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#if !AHT21_CFG_STATIC_DISPATCH
+#error "test_aht21_hal.c requires AHT21_CFG_STATIC_DISPATCH=1"
+#endif
+
+#define TEST_HAL_SEG_MAX             4
+
+static aht21_sim_t s_sim;
+static iic_driver_interface_t s_sim_iic;
+static system_timebase_interface_t s_timebase;
+static bsp_aht21_t s_aht21;
+
+static I2C_TypeDef s_i2c_regs;
+static I2C_HandleTypeDef s_hi2c = {&s_i2c_regs, HAL_I2C_STATE_RESET};
+
+// HAL替身状态 已启动的段在下一次阻塞时完成
+static struct
+{
+    iic_segment_t segs[TEST_HAL_SEG_MAX];
+    uint8_t       seg_num;
+    uint8_t       addr;
+    bool          pending;       // 有已启动未完成的段
+    bool          last;          // 该段结束事务
+    bool          hang;          // DMA永不完成
+    uint32_t      completes;     // 完成/出错回调次数
+    uint32_t      aborts;
+    uint32_t      wfis;
+} s_hal;
+
+uint32_t HAL_GetTick(void)
+{
+    return s_sim.now_ms;
+}
+
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef *hi2c)
+{
+    hi2c->State = HAL_I2C_STATE_READY;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_DeInit(I2C_HandleTypeDef *hi2c)
+{
+    hi2c->State = HAL_I2C_STATE_RESET;
+    return HAL_OK;
+}
+
+HAL_I2C_StateTypeDef HAL_I2C_GetState(I2C_HandleTypeDef *hi2c)
+{
+    return hi2c->State;
+}
+
+/**
+ * @brief 记录一段 FIRST帧在事务中间出现时表示重复起始
+ */
+static HAL_StatusTypeDef test_hal_seq_start(uint16_t dev_addr, uint8_t *pdata, uint16_t size,
+                                            uint32_t options, uint8_t flags)
+{
+    if (s_hal.pending || s_hal.seg_num == TEST_HAL_SEG_MAX)
+    {
+        return HAL_BUSY;
+    }
+    bool first = (options == I2C_FIRST_FRAME || options == I2C_FIRST_AND_LAST_FRAME);
+    if (first && s_hal.seg_num > 0)
+    {
+        flags |= IIC_SEG_RESTART;
+    }
+    s_hal.addr = (uint8_t)(dev_addr >> 1);
+    s_hal.segs[s_hal.seg_num].pdata = pdata;
+    s_hal.segs[s_hal.seg_num].size = size;
+    s_hal.segs[s_hal.seg_num].flags = flags;
+    s_hal.seg_num++;
+    s_hal.last = (options == I2C_LAST_FRAME || options == I2C_FIRST_AND_LAST_FRAME);
+    s_hal.pending = true;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Seq_Transmit_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress,
+                                                  uint8_t *pData, uint16_t Size, uint32_t XferOptions)
+{
+    (void)hi2c;
+    return test_hal_seq_start(DevAddress, pData, Size, XferOptions, IIC_SEG_WRITE);
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Seq_Receive_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress,
+                                                 uint8_t *pData, uint16_t Size, uint32_t XferOptions)
+{
+    (void)hi2c;
+    return test_hal_seq_start(DevAddress, pData, Size, XferOptions, IIC_SEG_READ);
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Abort_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress)
+{
+    (void)hi2c;
+    (void)DevAddress;
+    s_hal.aborts++;
+    s_hal.pending = false;
+    s_hal.seg_num = 0;
+    return HAL_OK;
+}
+
+/**
+ * @brief 模拟DMA/IIC中断 完成当前段 事务结束时整体交给仿真执行
+ *
+ * @return true 调用了回调
+ */
+static bool test_hal_irq(void)
+{
+    if (!s_hal.pending || s_hal.hang)
+    {
+        return false;
+    }
+    bool read = (s_hal.segs[s_hal.seg_num - 1U].flags & IIC_SEG_READ) != 0;
+    bool ok = true;
+    s_hal.pending = false;
+    if (s_hal.last)
+    {
+        iic_transaction_t xfer = {s_hal.addr, s_hal.seg_num, s_hal.segs};
+        ok = (s_sim_iic.pfTransfer(&xfer) == 0);
+        s_hal.seg_num = 0;
+    }
+    s_hal.completes++;
+    if (!ok)
+    {
+        HAL_I2C_ErrorCallback(&s_hi2c);
+    }
+    else if (read)
+    {
+        HAL_I2C_MasterRxCpltCallback(&s_hi2c);
+    }
+    else
+    {
+        HAL_I2C_MasterTxCpltCallback(&s_hi2c);
+    }
+    return true;
+}
+
+// 调度器启动前的等待 有中断时处理中断 否则等到下一个SysTick
+void hal_stub_wfi(void)
+{
+    s_hal.wfis++;
+    if (!test_hal_irq())
+    {
+        aht21_sim_advance(&s_sim, 1);
+    }
+}
+
+// 任务阻塞 有中断时立即唤醒 否则睡满超时
+static void test_idle(TickType_t ticks)
+{
+    if (!test_hal_irq() && ticks != portMAX_DELAY)
+    {
+        aht21_sim_advance(&s_sim, ticks);
+    }
+}
+
+/**
+ * @brief 驱动不使用接口表 HAL后端绑定到IIC句柄
+ */
+static void setup(void)
+{
+    iic_driver_interface_t hal_iic;
+    memset(&s_aht21, 0, sizeof(s_aht21));
+    memset(&s_hal, 0, sizeof(s_hal));
+    aht21_sim_init(&s_sim, AHT21_ADDR);
+    aht21_sim_bind(&s_sim, &s_sim_iic, &s_timebase, true);
+    freertos_stub_set_idle(test_idle);
+    freertos_stub_set_scheduler(taskSCHEDULER_RUNNING);
+    AHT21_CHECK_EQ(iic_hal_seq_attach(&s_hi2c, &hal_iic), RET_CODE_SUCCESS);
+    AHT21_CHECK(hal_iic.pfTransfer == iic_hal_seq_transfer);
+    AHT21_CHECK_EQ(hal_iic.pfInit(), 0);
+    AHT21_CHECK_EQ(aht21_inst(&s_aht21, NULL, NULL, NULL), RET_CODE_SUCCESS);
+    AHT21_CHECK_EQ(aht21_init(&s_aht21), RET_CODE_SUCCESS);
+}
+
+/**
+ * @brief 读数与等待 传输阻塞在信号量上 不提前读取
+ */
+static void test_read(void)
+{
+    setup();
+    s_sim.temp_centi = -1234;
+    s_sim.humi_centi = 6789;
+    uint32_t start = s_sim.now_ms;
+    float temp = 0.0f;
+    float humi = 0.0f;
+    for (int i = 0; i < 10; i++)
+    {
+        AHT21_CHECK_EQ(aht21_read_data(&s_aht21, &temp, &humi), RET_CODE_SUCCESS);
+    }
+    AHT21_CHECK(fabsf(temp - (-12.34f)) < 0.001f);
+    AHT21_CHECK(fabsf(humi - 67.89f) < 0.001f);
+    AHT21_CHECK_EQ((s_sim.now_ms - start) / 10U, AHT21_MEASUREMENT_DELAY_MS);
+    AHT21_CHECK_EQ(s_sim.stats.busy_reads, 0);
+    AHT21_CHECK(s_hal.completes > 0);
+    AHT21_CHECK_EQ(s_hal.wfis, 0);
+}
+
+/**
+ * @brief 调度器启动前 传输和等待都以WFI完成
+ */
+static void test_wfi(void)
+{
+    setup();
+    freertos_stub_set_scheduler(taskSCHEDULER_NOT_STARTED);
+    float temp = 0.0f;
+    float humi = 0.0f;
+    AHT21_CHECK_EQ(aht21_read_data(&s_aht21, &temp, &humi), RET_CODE_SUCCESS);
+    AHT21_CHECK(fabsf(temp - 25.0f) < 0.001f);
+    AHT21_CHECK(s_hal.wfis >= AHT21_MEASUREMENT_DELAY_MS);
+    AHT21_CHECK_EQ(s_sim.stats.busy_reads, 0);
+}
+
+/**
+ * @brief 地址无应答 出错回调 事务失败
+ */
+static void test_nack(void)
+{
+    setup();
+    uint8_t cmd = 0x71;
+    iic_segment_t seg = {&cmd, 1, IIC_SEG_WRITE};
+    iic_transaction_t xfer = {AHT21_ADDR + 1, 1, &seg};
+    AHT21_CHECK_EQ(iic_hal_seq_transfer(&xfer), -1);
+    AHT21_CHECK_EQ(s_hal.aborts, 0);
+}
+
+/**
+ * @brief DMA不完成 每段最多等待IIC_HAL_SEQ_TIMEOUT_MS后终止传输
+ */
+static void test_timeout(void)
+{
+    setup();
+    s_hal.hang = true;
+    uint8_t cmd = 0x71;
+    uint8_t status = 0;
+    iic_segment_t segs[2] = {{&cmd, 1, IIC_SEG_WRITE}, {&status, 1, IIC_SEG_READ}};
+    iic_transaction_t xfer = {AHT21_ADDR, 2, segs};
+    uint32_t start = s_sim.now_ms;
+    AHT21_CHECK_EQ(iic_hal_seq_transfer(&xfer), -1);
+    uint32_t elapsed = s_sim.now_ms - start;
+    AHT21_CHECK(elapsed > IIC_HAL_SEQ_TIMEOUT_MS);
+    AHT21_CHECK(elapsed <= IIC_HAL_SEQ_TIMEOUT_MS + 1U);
+    AHT21_CHECK_EQ(s_hal.aborts, 1);
+
+    // 经驱动读取 重试耗尽后失败
+    float temp;
+    float humi;
+    AHT21_CHECK(aht21_read_data(&s_aht21, &temp, &humi) != RET_CODE_SUCCESS);
+    s_hal.hang = false;
+    AHT21_CHECK_EQ(aht21_read_data(&s_aht21, &temp, &humi), RET_CODE_SUCCESS);
+}
+
+int main(void)
+{
+    test_read();
+    test_wfi();
+    test_nack();
+    test_timeout();
+    return AHT21_TEST_RESULT("test_aht21_hal");
+}
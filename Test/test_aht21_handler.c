@@ -0,0 +1,675 @@
+/**
+ * @file test_aht21_handler.c
+ * @brief handler在仿真后端和FreeRTOS替身上的主机测试
+ *
+ * 直接包含ec_bsp_aht21_handler.c以访问批次、订阅表等静态变量，不启动任务，
+ * 由handler_step()按handler线程循环体逐轮推进。队列接收和vTaskDelay的等待
+ * 由空闲回调换算为仿真虚拟时钟前进，见stub/freertos_stub.c。
+ *
+ * 覆盖：空闲阻塞、最新样本槽与借用、请求合并与缓存命中、转换期间到达的请求、
+ * 连续转换失败、最早时限优先与时限拒绝、队列保留位置、周期订阅的共用采样计划
+ * 和三种投递方式、取消后由handler线程回收槽位、严格晚到才跳过周期、历史样本、
+ * 指标快照编码。
+ *
+ * 同一文件以AHT21_HANDLER_STATIC_ALLOC=1再编译一次：由temp_humi_handler_start
+ * 登记存储，检查队列和互斥量建在登记的存储中且不使用替身的堆。
+ *
+ * @version 1.0
+ * @date 2024-07-26
+ *
+ * @par 依赖项
+ * - ec_bsp_aht21_handler.c 及驱动、latest/history/metrics
+ * - stub/freertos_stub.c
+ *
+ * @par 版本历史
+ * - 1.0 初始版本
+ *
+ * @par 作者
+ * - liyijie
+ */
+
+#include "aht21_test.h"
+#include "ec_bsp_aht21_sim.h"
+
+// handler沿用ARMCC下的写法 把整数写入void *成员
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wint-conversion"
+#include "../Core/Src/ec_bsp_aht21_handler.c"
+#pragma GCC diagnostic pop
+// handler头文件中有未实现的static声明 GCC在编译单元末尾才告警 无法用push/pop限定
+#pragma GCC diagnostic ignored "-Wunused-function"
+
+#include <stdint.h>
+#include <string.h>
+
+#define TEST_EVENT_NUM               12U
+#define TEST_RECORD_MAX              64U
+
+static aht21_sim_t s_sim;
+static iic_driver_interface_t s_iic;
+static system_timebase_interface_t s_timebase;
+static bsp_aht21_t s_aht21;
+static bsp_aht21_handler_t s_handler;
+static bsp_AHT21_handler_arg_struct s_arg;
+#if AHT21_HANDLER_STATIC_ALLOC
+static temp_humi_handler_storage_t s_storage;
+#endif
+
+// 请求事件及其记录 回调按arg记录事件号
+static temp_humi_event_t s_event[TEST_EVENT_NUM];
+static aht21_sample_t s_record[TEST_EVENT_NUM];
+static int s_order[TEST_RECORD_MAX];
+static aht21_sample_t s_delivered[TEST_RECORD_MAX];
+static uint32_t s_delivered_at[TEST_RECORD_MAX];
+static uint32_t s_delivered_num;
+
+// 空闲回调中投递的请求 模拟转换期间其他任务发送
+static temp_humi_event_t *s_inject[TEST_EVENT_NUM];
+static uint32_t s_inject_num;
+
+/**
+ * @brief 空闲回调 虚拟时钟前进ticks毫秒 无限等待时不前进
+ */
+static void test_idle(TickType_t ticks)
+{
+    if (ticks != portMAX_DELAY)
+    {
+        aht21_sim_advance(&s_sim, ticks);
+    }
+    for (uint32_t i = 0; i < s_inject_num; i++)
+    {
+        AHT21_CHECK_EQ(temp_humi_event_handler_send(s_inject[i]), RET_CODE_AHT21_PENDING);
+    }
+    s_inject_num = 0;
+}
+
+static void test_record(const aht21_sample_t *sample, void *arg)
+{
+    if (s_delivered_num < TEST_RECORD_MAX)
+    {
+        s_order[s_delivered_num] = (int)(intptr_t)arg;
+        s_delivered[s_delivered_num] = *sample;
+        s_delivered_at[s_delivered_num] = s_sim.now_ms;
+        s_delivered_num++;
+    }
+}
+
+/**
+ * @brief handler线程循环体的一轮
+ */
+static void handler_step(void)
+{
+    temp_humi_request_t request;
+    if (g_temp_humi_batch.count == 0 &&
+        xQueueReceive(s_handler.queue_event, &request, temp_humi_sub_wait_ticks(&s_handler)) == pdPASS &&
+        request.event != NULL)
+    {
+        temp_humi_batch_insert(&request);
+    }
+    temp_humi_sub_serve(&s_handler);
+    temp_humi_batch_serve(&s_handler);
+}
+
+/**
+ * @brief 仿真实例+驱动+handler 模块静态状态复位
+ */
+static void setup(void)
+{
+    if (NULL != s_handler.queue_event)
+    {
+        aht21_handler_deInit(&s_handler);
+    }
+    memset(&s_aht21, 0, sizeof(s_aht21));
+    memset(&s_handler, 0, sizeof(s_handler));
+    memset(&g_temp_humi_batch, 0, sizeof(g_temp_humi_batch));
+    memset(g_temp_humi_subs, 0, sizeof(g_temp_humi_subs));
+    g_aht21_handler = NULL;
+    g_temp_humi_conv_ms = AHT21_MEASUREMENT_DELAY_MS;
+    aht21_latest_init(&g_aht21_latest);
+    aht21_history_init(&g_aht21_history);
+
+    aht21_sim_init(&s_sim, AHT21_ADDR);
+    aht21_sim_bind(&s_sim, &s_iic, &s_timebase, true);
+    freertos_stub_set_idle(test_idle);
+    s_arg.iic_driver_interface_table = &s_iic;
+    s_arg.timebase = &s_timebase;
+    s_arg.rtos_yeild = (void *)aht21_sim_yield;
+    s_handler.aht21_instance = &s_aht21;
+    size_t heap = freertos_stub_heap_allocs();
+#if AHT21_HANDLER_STATIC_ALLOC
+    // 第一次由temp_humi_handler_start登记存储 替身不运行任务函数
+    if (NULL == g_temp_humi_storage)
+    {
+        AHT21_CHECK_EQ(temp_humi_handler_start(&s_arg, &s_storage, 1), RET_CODE_SUCCESS);
+        AHT21_CHECK_EQ(temp_humi_handler_start(&s_arg, &s_storage, 1), RET_CODE_HAS_BEEN_INITED);
+    }
+#endif
+    AHT21_CHECK_EQ(aht21_handler_inst(&s_arg, &s_handler, &s_aht21), RET_CODE_SUCCESS);
+#if AHT21_HANDLER_STATIC_ALLOC
+    // 队列和互斥量由登记的存储创建 不使用堆
+    AHT21_CHECK_EQ(freertos_stub_heap_allocs(), heap);
+    AHT21_CHECK(s_handler.queue_event == (QueueHandle_t)&s_storage.queue);
+    AHT21_CHECK(s_handler.init_lock == (SemaphoreHandle_t)&s_storage.init_lock);
+#else
+    AHT21_CHECK(freertos_stub_heap_allocs() > heap);
+#endif
+    g_aht21_handler = &s_handler;
+
+    for (uint32_t i = 0; i < TEST_EVENT_NUM; i++)
+    {
+        memset(&s_event[i], 0, sizeof(s_event[i]));
+        s_event[i].sample = &s_record[i];
+        s_event[i].type_of_data = TEMP_HUMI_EVENT_TYPE_BOTH;
+        s_event[i].callback = test_record;
+        s_event[i].arg = (void *)(intptr_t)i;
+    }
+    memset(s_record, 0, sizeof(s_record));
+    s_delivered_num = 0;
+    s_inject_num = 0;
+}
+
+/**
+ * @brief 没有请求和订阅时无限期阻塞在请求队列上 不触发转换
+ */
+static void test_idle_block(void)
+{
+    setup();
+    handler_step();
+    AHT21_CHECK_EQ(freertos_stub_last_block(), portMAX_DELAY);
+    AHT21_CHECK_EQ(s_sim.stats.triggers, 0);
+    AHT21_CHECK_EQ(s_handler.metrics.conversions, 0);
+}
+
+/**
+ * @brief 时基提供pfwait_until时可不提供rtos_yeild 二者都没有时拒绝
+ */
+static void test_inst_args(void)
+{
+    setup();
+    aht21_handler_deInit(&s_handler);
+    memset(&s_aht21, 0, sizeof(s_aht21));
+    memset(&s_handler, 0, sizeof(s_handler));
+    s_handler.aht21_instance = &s_aht21;
+    bsp_AHT21_handler_arg_struct arg = {&s_iic, &s_timebase, NULL};
+    AHT21_CHECK_EQ(aht21_handler_inst(&arg, &s_handler, &s_aht21), RET_CODE_SUCCESS);
+    AHT21_CHECK(s_handler.inited);
+
+    aht21_handler_deInit(&s_handler);
+    memset(&s_handler, 0, sizeof(s_handler));
+    s_handler.aht21_instance = &s_aht21;
+    s_timebase.pfwait_until = NULL;
+    AHT21_CHECK_EQ(aht21_handler_inst(&arg, &s_handler, &s_aht21), RET_CODE_ERROR_PARAM_NULL);
+    AHT21_CHECK(s_handler.queue_event == NULL);
+}
+
+/**
+ * @brief 最新样本按值读取与借用 新样本发布后旧借用失效
+ */
+static void test_latest(void)
+{
+    setup();
+    aht21_sample_t sample;
+    uint32_t seq;
+    AHT21_CHECK(temp_humi_handler_read_latest(&sample, &seq) != RET_CODE_SUCCESS);
+    AHT21_CHECK(temp_humi_handler_borrow_latest(&seq) == NULL);
+
+    AHT21_CHECK_EQ(temp_humi_event_handler_send(&s_event[0]), RET_CODE_AHT21_PENDING);
+    handler_step();
+    AHT21_CHECK_EQ(temp_humi_handler_read_latest(&sample, &seq), RET_CODE_SUCCESS);
+    AHT21_CHECK_EQ(sample.code, RET_CODE_SUCCESS);
+    AHT21_CHECK(sample.temp == 25.0f && sample.humi == 50.0f);
+    AHT21_CHECK_EQ(sample.timestamp, s_record[0].timestamp);
+    AHT21_CHECK_EQ(sample.seq, seq);
+
+    uint32_t borrowed;
+    const aht21_sample_t *view = temp_humi_handler_borrow_latest(&borrowed);
+    AHT21_CHECK(view != NULL && view->timestamp == sample.timestamp);
+    AHT21_CHECK(temp_humi_handler_borrow_valid(borrowed));
+
+    aht21_sim_advance(&s_sim, 10);
+    AHT21_CHECK_EQ(temp_humi_event_handler_send(&s_event[1]), RET_CODE_AHT21_PENDING);
+    handler_step();
+    AHT21_CHECK(!temp_humi_handler_borrow_valid(borrowed));
+    AHT21_CHECK_EQ(temp_humi_handler_read_latest(&sample, &seq), RET_CODE_SUCCESS);
+    AHT21_CHECK(seq != borrowed);
+}
+
+/**
+ * @brief 时效重叠的请求合并为一次转换 缓存满足的请求直接返回
+ */
+static void test_coalesce(void)
+{
+    setup();
+    for (uint32_t i = 0; i < 5; i++)
+    {
+        s_event[i].lifetime = 500;
+        AHT21_CHECK_EQ(temp_humi_event_handler_send(&s_event[i]), RET_CODE_AHT21_PENDING);
+    }
+    handler_step();
+    AHT21_CHECK_EQ(s_sim.stats.triggers, 1);
+    AHT21_CHECK_EQ(s_delivered_num, 5);
+    for (uint32_t i = 0; i < s_delivered_num; i++)
+    {
+        AHT21_CHECK_EQ(s_order[i], i);
+        AHT21_CHECK_EQ(s_delivered[i].code, RET_CODE_SUCCESS);
+        AHT21_CHECK(s_record[i].temp == 25.0f && s_record[i].humi == 50.0f);
+        AHT21_CHECK_EQ(s_record[i].timestamp, s_record[0].timestamp);
+    }
+    AHT21_CHECK_EQ(g_temp_humi_batch.count, 0);
+
+    // 200ms后重复 缓存样本仍在时效内 不触发转换
+    aht21_sim_advance(&s_sim, 200);
+    for (uint32_t i = 0; i < 5; i++)
+    {
+        AHT21_CHECK_EQ(temp_humi_event_handler_send(&s_event[i]), RET_CODE_SUCCESS);
+    }
+    AHT21_CHECK_EQ(s_delivered_num, 10);
+    AHT21_CHECK_EQ(s_sim.stats.triggers, 1);
+
+    // 只请求温度时湿度为0 记录按值写入
+    s_event[5].lifetime = TEMP_HUMI_LIFETIME_ANY;
+    s_event[5].type_of_data = TEMP_HUMI_EVENT_TYPE_TEMP;
+    AHT21_CHECK_EQ(temp_humi_event_handler_send(&s_event[5]), RET_CODE_SUCCESS);
+    AHT21_CHECK(s_record[5].temp == 25.0f && s_record[5].humi == 0.0f);
+
+    // 没有记录时回调借用handler的样本
+    s_event[8].sample = NULL;
+    s_event[8].lifetime = TEMP_HUMI_LIFETIME_ANY;
+    AHT21_CHECK_EQ(temp_humi_event_handler_send(&s_event[8]), RET_CODE_SUCCESS);
+    AHT21_CHECK_EQ(s_order[s_delivered_num - 1], 8);
+    AHT21_CHECK(s_delivered[s_delivered_num - 1].temp == 25.0f);
+
+    // 长短时效的请求一起排队 共用一次转换
+    aht21_sim_advance(&s_sim, 400);
+    s_event[6].lifetime = 10;
+    s_event[7].lifetime = 500;
+    AHT21_CHECK_EQ(temp_humi_event_handler_send(&s_event[6]), RET_CODE_AHT21_PENDING);
+    AHT21_CHECK_EQ(temp_humi_event_handler_send(&s_event[7]), RET_CODE_AHT21_PENDING);
+    uint32_t delivered = s_delivered_num;
+    handler_step();
+    AHT21_CHECK_EQ(s_sim.stats.triggers, 2);
+    AHT21_CHECK_EQ(s_delivered_num, delivered + 2);
+    AHT21_CHECK_EQ(s_order[delivered], 6);
+    AHT21_CHECK_EQ(s_order[delivered + 1], 7);
+    AHT21_CHECK_EQ(s_handler.metrics.requests, 14);
+    AHT21_CHECK_EQ(s_handler.metrics.served, 14);
+    AHT21_CHECK_EQ(s_handler.metrics.cache_hits, 7);
+    AHT21_CHECK_EQ(s_handler.metrics.conversions, 2);
+    AHT21_CHECK_EQ(s_handler.metrics.batch_hwm, 5);
+
+    // 没有缓存时 TEMP_HUMI_LIFETIME_ANY和超过INT32_MAX的时效排队后由同一次转换满足
+    setup();
+    s_event[0].lifetime = TEMP_HUMI_LIFETIME_ANY;
+    s_event[1].lifetime = 0xC0000000U;
+    AHT21_CHECK_EQ(temp_humi_event_handler_send(&s_event[0]), RET_CODE_AHT21_PENDING);
+    AHT21_CHECK_EQ(temp_humi_event_handler_send(&s_event[1]), RET_CODE_AHT21_PENDING);
+    handler_step();
+    AHT21_CHECK_EQ(s_sim.stats.triggers, 1);
+    AHT21_CHECK_EQ(s_delivered_num, 2);
+    AHT21_CHECK_EQ(g_temp_humi_batch.count, 0);
+    aht21_sim_advance(&s_sim, 100000);
+    AHT21_CHECK_EQ(temp_humi_event_handler_send(&s_event[1]), RET_CODE_SUCCESS);
+    AHT21_CHECK_EQ(s_sim.stats.triggers, 1);
+}
+
+/**
+ * @brief 转换期间到达的请求 时效窗口覆盖转换触发时刻的并入本次转换
+ */
+static void test_follower(void)
+{
+    setup();
+    AHT21_CHECK_EQ(temp_humi_event_handler_send(&s_event[0]), RET_CODE_AHT21_PENDING);
+    s_event[1].lifetime = 500;
+    s_event[2].lifetime = 10;
+    s_inject[0] = &s_event[1];
+    s_inject[1] = &s_event[2];
+    s_inject_num = 2;
+    handler_step();
+    AHT21_CHECK_EQ(s_inject_num, 0);
+    AHT21_CHECK_EQ(s_sim.stats.triggers, 1);
+    AHT21_CHECK_EQ(s_delivered_num, 2);
+    AHT21_CHECK_EQ(s_order[0], 0);
+    AHT21_CHECK_EQ(s_order[1], 1);
+    // 10ms时效在转换触发之后开始 等待下一次转换
+    AHT21_CHECK_EQ(g_temp_humi_batch.count, 1);
+    handler_step();
+    AHT21_CHECK_EQ(s_sim.stats.triggers, 2);
+    AHT21_CHECK_EQ(s_delivered_num, 3);
+    AHT21_CHECK_EQ(s_order[2], 2);
+    AHT21_CHECK_EQ(s_handler.metrics.batch_hwm, 3);
+}
+
+/**
+ * @brief 连续转换失败后本批请求收到失败码并计入指标
+ */
+static void test_convert_fail(void)
+{
+    setup();
+    s_sim.nack_interval = 1;
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        AHT21_CHECK_EQ(temp_humi_event_handler_send(&s_event[i]), RET_CODE_AHT21_PENDING);
+    }
+    for (uint32_t k = 0; k + 1 < AHT21_HANDLER_CONVERT_RETRY; k++)
+    {
+        handler_step();
+        AHT21_CHECK_EQ(s_delivered_num, 0);
+    }
+    handler_step();
+    AHT21_CHECK_EQ(s_delivered_num, 3);
+    for (uint32_t i = 0; i < s_delivered_num; i++)
+    {
+        AHT21_CHECK_EQ(s_order[i], i);
+        AHT21_CHECK_EQ(s_delivered[i].code, RET_CODE_AHT21_IIC_FAIL);
+        AHT21_CHECK(s_delivered[i].temp == 0.0f && s_delivered[i].humi == 0.0f);
+    }
+    AHT21_CHECK_EQ(g_temp_humi_batch.count, 0);
+    AHT21_CHECK_EQ(s_handler.metrics.failed, 3);
+    AHT21_CHECK_EQ(s_handler.metrics.conv_failures, AHT21_HANDLER_CONVERT_RETRY);
+    AHT21_CHECK_EQ(s_handler.metrics.served, 0);
+
+    // 恢复后正常交付
+    s_sim.nack_interval = 0;
+    AHT21_CHECK_EQ(temp_humi_event_handler_send(&s_event[3]), RET_CODE_AHT21_PENDING);
+    handler_step();
+    AHT21_CHECK_EQ(s_delivered_num, 4);
+    AHT21_CHECK_EQ(s_delivered[3].code, RET_CODE_SUCCESS);
+}
+
+/**
+ * @brief 最早时限优先 时限相同按priority 赶不上时限的请求被拒绝
+ */
+static void test_deadline(void)
+{
+    setup();
+    s_event[0].deadline = 0;      // 软时限 排在最后
+    s_event[1].deadline = 500;
+    s_event[2].deadline = 200;
+    s_event[3].deadline = 200;
+    s_event[3].priority = 5;
+    s_event[4].deadline = 200;    // 与2相同 按到达顺序
+    // 转换期间到达 时限早于1 按时限插入批次而不是排在末尾
+    s_event[5].deadline = 150;
+    s_event[5].lifetime = 1000;
+    for (uint32_t i = 0; i < 5; i++)
+    {
+        AHT21_CHECK_EQ(temp_humi_event_handler_send(&s_event[i]), RET_CODE_AHT21_PENDING);
+    }
+    s_inject[0] = &s_event[5];
+    s_inject_num = 1;
+    handler_step();
+    static const int expect[] = {3, 2, 4, 5, 1, 0};
+    AHT21_CHECK_EQ(s_sim.stats.triggers, 1);
+    AHT21_CHECK_EQ(s_delivered_num, 6);
+    for (uint32_t i = 0; i < 6; i++)
+    {
+        AHT21_CHECK_EQ(s_order[i], expect[i]);
+    }
+
+    // 时限短于一次转换 不排队
+    s_event[7].deadline = AHT21_MEASUREMENT_DELAY_MS / 2U;
+    AHT21_CHECK_EQ(temp_humi_event_handler_send(&s_event[7]), RET_CODE_AHT21_DEADLINE);
+    AHT21_CHECK_EQ(s_delivered_num, 6);
+
+    // 排队期间时限已过 以RET_CODE_AHT21_DEADLINE结束 不触发转换
+    uint32_t triggers = s_sim.stats.triggers;
+    s_event[8].deadline = 100;
+    AHT21_CHECK_EQ(temp_humi_event_handler_send(&s_event[8]), RET_CODE_AHT21_PENDING);
+    aht21_sim_advance(&s_sim, 50);
+    handler_step();
+    AHT21_CHECK_EQ(s_delivered_num, 7);
+    AHT21_CHECK_EQ(s_order[6], 8);
+    AHT21_CHECK_EQ(s_delivered[6].code, RET_CODE_AHT21_DEADLINE);
+    AHT21_CHECK_EQ(s_sim.stats.triggers, triggers);
+    AHT21_CHECK_EQ(s_handler.metrics.rejected_deadline, 2);
+}
+
+/**
+ * @brief 队列最后AHT21_HANDLER_QUEUE_RESERVE个位置只接受priority非0的请求
+ */
+static void test_reserve(void)
+{
+    setup();
+    uint32_t i = 0;
+    for (; i < AHT21_HANDLER_QUEUE_LEN - AHT21_HANDLER_QUEUE_RESERVE; i++)
+    {
+        AHT21_CHECK_EQ(temp_humi_event_handler_send(&s_event[i]), RET_CODE_AHT21_PENDING);
+    }
+    AHT21_CHECK_EQ(temp_humi_event_handler_send(&s_event[i]), RET_CODE_AHT21_BUSY);
+    for (; i < AHT21_HANDLER_QUEUE_LEN; i++)
+    {
+        s_event[i].priority = 1;
+        AHT21_CHECK_EQ(temp_humi_event_handler_send(&s_event[i]), RET_CODE_AHT21_PENDING);
+    }
+    s_event[i].priority = 1;
+    AHT21_CHECK_EQ(temp_humi_event_handler_send(&s_event[i]), RET_CODE_AHT21_BUSY);
+    AHT21_CHECK_EQ(s_handler.metrics.rejected_busy, 2);
+    AHT21_CHECK_EQ(s_handler.metrics.queue_hwm, AHT21_HANDLER_QUEUE_LEN);
+
+    handler_step();
+    AHT21_CHECK_EQ(s_delivered_num, AHT21_HANDLER_QUEUE_LEN);
+    AHT21_CHECK_EQ(s_sim.stats.triggers, 1);
+}
+
+/**
+ * @brief 按虚拟时钟运行handler直到now_ms前进ms毫秒
+ */
+static void run_for(uint32_t ms)
+{
+    uint32_t start = s_sim.now_ms;
+    while (s_sim.now_ms - start < ms)
+    {
+        handler_step();
+    }
+}
+
+/**
+ * @brief 订阅共用一个采样计划 三种投递方式 取消订阅后槽位由handler线程回收
+ */
+static void test_subscribe(void)
+{
+    setup();
+    QueueHandle_t queue = xQueueCreate(4, sizeof(aht21_sample_t));
+    StreamBufferHandle_t stream = xStreamBufferCreate(16 * sizeof(aht21_sample_t), 1);
+    temp_humi_subscribe_t by_cb = {1000, TEMP_HUMI_EVENT_TYPE_BOTH, TEMP_HUMI_SINK_CALLBACK,
+                                   NULL, test_record, (void *)(intptr_t)100};
+    temp_humi_subscribe_t by_queue = {2000, TEMP_HUMI_EVENT_TYPE_BOTH, TEMP_HUMI_SINK_QUEUE, queue, NULL, NULL};
+    temp_humi_subscribe_t by_stream = {1000, TEMP_HUMI_EVENT_TYPE_TEMP, TEMP_HUMI_SINK_STREAM, stream, NULL, NULL};
+    temp_humi_subscribe_t bad = {0, TEMP_HUMI_EVENT_TYPE_BOTH, TEMP_HUMI_SINK_CALLBACK, NULL, test_record, NULL};
+    AHT21_CHECK_EQ(temp_humi_handler_subscribe(&bad), RET_CODE_ERROR_PARAM_NULL);
+    int8_t id_cb = temp_humi_handler_subscribe(&by_cb);
+    int8_t id_queue = temp_humi_handler_subscribe(&by_queue);
+    int8_t id_stream = temp_humi_handler_subscribe(&by_stream);
+    AHT21_CHECK(id_cb >= 0 && id_queue >= 0 && id_stream >= 0);
+
+    run_for(9500);
+    // 最后一轮等待醒来时已是10000ms 仍执行该次转换 0~10000ms共11次
+    // 2000ms周期的订阅共用其中6次 队列容量4 丢弃2个
+    AHT21_CHECK_EQ(s_sim.stats.triggers, 11);
+    AHT21_CHECK_EQ(s_delivered_num, 11);
+    for (uint32_t i = 1; i < s_delivered_num; i++)
+    {
+        AHT21_CHECK_EQ(s_delivered[i].timestamp - s_delivered[i - 1].timestamp, 1000);
+    }
+    AHT21_CHECK_EQ(uxQueueMessagesWaiting(queue), 4);
+    AHT21_CHECK_EQ(g_temp_humi_subs[id_queue].dropped, 2);
+    aht21_sample_t out;
+    uint32_t stream_num = 0;
+    while (xStreamBufferReceive(stream, &out, sizeof(out), 0) == sizeof(out))
+    {
+        AHT21_CHECK(out.temp == 25.0f && out.humi == 0.0f);
+        stream_num++;
+    }
+    AHT21_CHECK_EQ(stream_num, 11);
+    AHT21_CHECK_EQ(g_temp_humi_subs[id_cb].missed, 0);
+
+    // 历史样本与订阅采样一致
+    aht21_history_raw_t raw[16];
+    AHT21_CHECK_EQ(temp_humi_handler_history_raw(0, UINT32_MAX, raw, 16), 11);
+    AHT21_CHECK_EQ(raw[10].timestamp, s_delivered[10].timestamp);
+
+    // 取消后不再投递 槽位在handler线程回收前不被新订阅占用
+    AHT21_CHECK_EQ(temp_humi_handler_unsubscribe(id_cb), RET_CODE_SUCCESS);
+    AHT21_CHECK_EQ(temp_humi_handler_unsubscribe(id_cb), RET_CODE_ERROR_PARAM_NULL);
+    AHT21_CHECK_EQ(g_temp_humi_subs[id_cb].state, TEMP_HUMI_SUB_CLOSING);
+    int8_t id_new = temp_humi_handler_subscribe(&by_stream);
+    AHT21_CHECK(id_new >= 0 && id_new != id_cb);
+    AHT21_CHECK_EQ(temp_humi_handler_unsubscribe(id_new), RET_CODE_SUCCESS);
+    handler_step();
+    AHT21_CHECK_EQ(g_temp_humi_subs[id_cb].state, TEMP_HUMI_SUB_FREE);
+    AHT21_CHECK_EQ(g_temp_humi_subs[id_new].state, TEMP_HUMI_SUB_FREE);
+    uint32_t delivered = s_delivered_num;
+    run_for(3000);
+    AHT21_CHECK_EQ(s_delivered_num, delivered);
+
+    AHT21_CHECK_EQ(temp_humi_handler_unsubscribe(id_queue), RET_CODE_SUCCESS);
+    AHT21_CHECK_EQ(temp_humi_handler_unsubscribe(id_stream), RET_CODE_SUCCESS);
+    // 两条唤醒消息各占一轮 之后没有订阅 无限期阻塞
+    while (uxQueueMessagesWaiting(s_handler.queue_event) != 0)
+    {
+        handler_step();
+    }
+    handler_step();
+    AHT21_CHECK_EQ(freertos_stub_last_block(), portMAX_DELAY);
+    vQueueDelete(queue);
+    vStreamBufferDelete(stream);
+}
+
+/**
+ * @brief 订阅周期等于转换耗时时每个周期都恰好到期 不算错过 短于转换耗时才跳过
+ */
+static void test_subscribe_late(void)
+{
+    setup();
+    temp_humi_subscribe_t sub = {1000, TEMP_HUMI_EVENT_TYPE_BOTH, TEMP_HUMI_SINK_CALLBACK,
+                                 NULL, test_record, NULL};
+    int8_t id = temp_humi_handler_subscribe(&sub);
+    handler_step();
+    AHT21_CHECK_EQ(s_delivered_num, 1);
+    uint32_t took = s_delivered_at[0] - s_delivered[0].timestamp;
+    AHT21_CHECK(took >= AHT21_MEASUREMENT_DELAY_MS);
+    AHT21_CHECK_EQ(temp_humi_handler_unsubscribe(id), RET_CODE_SUCCESS);
+    handler_step();
+
+    s_delivered_num = 0;
+    sub.period_ms = took;
+    id = temp_humi_handler_subscribe(&sub);
+    for (uint32_t i = 0; i < 5; i++)
+    {
+        handler_step();
+    }
+    AHT21_CHECK_EQ(s_delivered_num, 5);
+    for (uint32_t i = 1; i < s_delivered_num; i++)
+    {
+        AHT21_CHECK_EQ(s_delivered[i].timestamp - s_delivered[i - 1].timestamp, took);
+    }
+    AHT21_CHECK_EQ(g_temp_humi_subs[id].missed, 0);
+    AHT21_CHECK_EQ(temp_humi_handler_unsubscribe(id), RET_CODE_SUCCESS);
+    handler_step();
+
+    s_delivered_num = 0;
+    sub.period_ms = 50;
+    id = temp_humi_handler_subscribe(&sub);
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        handler_step();
+    }
+    AHT21_CHECK_EQ(s_delivered_num, 3);
+    AHT21_CHECK_EQ(g_temp_humi_subs[id].missed, 3 * ((took - 50U + 49U) / 50U));
+    for (uint32_t i = 0; i < s_delivered_num; i++)
+    {
+        AHT21_CHECK_EQ((s_delivered[i].timestamp - s_delivered[0].timestamp) % 50U, 0);
+    }
+}
+
+/**
+ * @brief 读取一个LEB128变长整数
+ */
+static uint32_t get_varint(const uint8_t *buf, uint16_t *pos)
+{
+    uint32_t value = 0;
+    uint8_t shift = 0;
+    uint8_t byte;
+    do
+    {
+        byte = buf[(*pos)++];
+        value |= (uint32_t)(byte & 0x7FU) << shift;
+        shift += 7;
+    } while (byte & 0x80U);
+    return value;
+}
+
+/**
+ * @brief 快照逐字段解码 与handler指标和驱动IIC统计一致
+ */
+static void test_metrics(void)
+{
+    setup();
+    uint8_t buf[AHT21_METRICS_SNAPSHOT_MAX];
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        AHT21_CHECK_EQ(temp_humi_event_handler_send(&s_event[i]), RET_CODE_AHT21_PENDING);
+    }
+    handler_step();
+    s_event[3].lifetime = TEMP_HUMI_LIFETIME_ANY;
+    AHT21_CHECK_EQ(temp_humi_event_handler_send(&s_event[3]), RET_CODE_SUCCESS);
+    s_sim.nack_interval = 1;
+    AHT21_CHECK_EQ(temp_humi_event_handler_send(&s_event[4]), RET_CODE_AHT21_PENDING);
+    for (uint32_t k = 0; k < AHT21_HANDLER_CONVERT_RETRY; k++)
+    {
+        handler_step();
+    }
+    s_sim.nack_interval = 0;
+
+    uint16_t size = temp_humi_handler_metrics_snapshot(buf, sizeof(buf));
+    AHT21_CHECK(size > 0);
+    AHT21_CHECK_EQ(temp_humi_handler_metrics_snapshot(buf, 4), 0);
+    size = temp_humi_handler_metrics_snapshot(buf, sizeof(buf));
+    aht21_fault_stats_t fault;
+    AHT21_CHECK_EQ(aht21_get_fault_stats(&s_aht21, &fault), RET_CODE_SUCCESS);
+    const aht21_metrics_t *metrics = &s_handler.metrics;
+    const uint32_t expect[AHT21_METRICS_FIELD_NUM] = {
+        5, 4, 1, 1 + AHT21_HANDLER_CONVERT_RETRY, AHT21_HANDLER_CONVERT_RETRY, 0, 0,
+        metrics->queue_hwm, metrics->batch_hwm, fault.nack, fault.timeout, fault.bus_recover,
+        s_aht21.crc_fail_count, AHT21_METRICS_LATENCY_BUCKETS,
+    };
+    uint16_t pos = 0;
+    AHT21_CHECK_EQ(buf[pos++], AHT21_METRICS_VERSION);
+    for (uint32_t i = 0; i < AHT21_METRICS_FIELD_NUM; i++)
+    {
+        AHT21_CHECK_EQ(get_varint(buf, &pos), expect[i]);
+    }
+    uint32_t latency_sum = 0;
+    for (uint32_t i = 0; i < AHT21_METRICS_LATENCY_BUCKETS; i++)
+    {
+        uint32_t count = get_varint(buf, &pos);
+        AHT21_CHECK_EQ(count, metrics->latency[i]);
+        latency_sum += count;
+    }
+    AHT21_CHECK_EQ(latency_sum, 4);
+    AHT21_CHECK_EQ(metrics->latency[0], 1);
+    AHT21_CHECK_EQ(get_varint(buf, &pos), 1);
+    AHT21_CHECK_EQ(pos, size);
+    AHT21_CHECK(fault.nack > 0);
+}
+
+int main(void)
+{
+    test_idle_block();
+    test_inst_args();
+    test_latest();
+    test_coalesce();
+    test_follower();
+    test_convert_fail();
+    test_deadline();
+    test_reserve();
+    test_subscribe();
+    test_subscribe_late();
+    test_metrics();
+    AHT21_CHECK_EQ(freertos_stub_critical(0), 0);
+#if AHT21_HANDLER_STATIC_ALLOC
+    return AHT21_TEST_RESULT("test_aht21_handler_static");
+#else
+    return AHT21_TEST_RESULT("test_aht21_handler");
+#endif
+}
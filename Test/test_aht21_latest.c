@@ -0,0 +1,174 @@
+/**
+ * @file test_aht21_latest.c
+ * @brief 最新样本槽的主机测试
+ *
+ * 覆盖：空槽与参数检查、按值读取和序号、借用与失效、一个发布线程与多个读线程
+ * 并发时读出的(温度, 湿度, 时间戳)不撕裂。
+ *
+ * @version 1.0
+ * @date 2024-07-26
+ *
+ * @par 依赖项
+ * - ec_bsp_aht21_latest.c
+ * - pthread
+ *
+ * @par 版本历史
+ * - 1.0 初始版本
+ *
+ * @par 作者
+ * - liyijie
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "aht21_test.h"
+#include "ec_bsp_aht21_latest.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+
+#define TEST_PUBLISH_NUM             1000000U
+#define TEST_READER_NUM              3
+
+static aht21_latest_t s_latest;
+static volatile int s_done;
+
+// 读线程统计 读线程只写自己的一项 汇合后由主线程检查
+typedef struct
+{
+    unsigned long reads;
+    unsigned long torn;
+    unsigned long backwards;
+} reader_stats_t;
+
+static reader_stats_t s_reader[TEST_READER_NUM];
+
+// 第i个样本的三个字段都由i决定 撕裂的读取会出现不一致
+static void make_sample(uint32_t i, aht21_sample_t *sample)
+{
+    sample->timestamp = i;
+    sample->temp = (float)i;
+    sample->humi = (float)(TEST_PUBLISH_NUM - i);
+    sample->code = 0;
+    sample->health = 0;
+    sample->health_flags = 0;
+    sample->seq = 0;
+}
+
+/**
+ * @brief 空槽、参数检查、发布后按值读取和借用
+ */
+static void test_single(void)
+{
+    aht21_sample_t sample;
+    uint32_t seq = 0;
+    aht21_latest_init(&s_latest);
+    AHT21_CHECK_EQ(aht21_latest_read(&s_latest, &sample, &seq), RET_CODE_NO_RIGHT_DATA);
+    AHT21_CHECK(aht21_latest_borrow(&s_latest, &seq) == NULL);
+    AHT21_CHECK_EQ(aht21_latest_read(NULL, &sample, &seq), RET_CODE_ERROR_PARAM_NULL);
+    AHT21_CHECK_EQ(aht21_latest_read(&s_latest, NULL, &seq), RET_CODE_ERROR_PARAM_NULL);
+
+    for (uint32_t i = 1; i <= 3; i++)
+    {
+        aht21_sample_t in;
+        make_sample(i, &in);
+        aht21_latest_publish(&s_latest, &in);
+        AHT21_CHECK_EQ(aht21_latest_read(&s_latest, &sample, &seq), RET_CODE_SUCCESS);
+        AHT21_CHECK_EQ(seq, i);
+        AHT21_CHECK_EQ(sample.seq, i);
+        AHT21_CHECK_EQ(sample.timestamp, i);
+        AHT21_CHECK(sample.temp == in.temp && sample.humi == in.humi);
+    }
+    AHT21_CHECK_EQ(aht21_latest_read(&s_latest, &sample, NULL), RET_CODE_SUCCESS);
+
+    // 借用的缓冲区在下一次发布后失效
+    uint32_t borrowed;
+    const aht21_sample_t *view = aht21_latest_borrow(&s_latest, &borrowed);
+    AHT21_CHECK(view != NULL && view->timestamp == 3);
+    AHT21_CHECK(aht21_latest_valid(&s_latest, borrowed));
+    aht21_sample_t in;
+    make_sample(4, &in);
+    aht21_latest_publish(&s_latest, &in);
+    AHT21_CHECK(!aht21_latest_valid(&s_latest, borrowed));
+}
+
+static void *writer_main(void *arg)
+{
+    (void)arg;
+    for (uint32_t i = 1; i <= TEST_PUBLISH_NUM; i++)
+    {
+        aht21_sample_t sample;
+        make_sample(i, &sample);
+        aht21_latest_publish(&s_latest, &sample);
+        // 单核主机上也让读线程在发布之间运行
+        if ((i & 0xFFFU) == 0)
+        {
+            sched_yield();
+        }
+    }
+    s_done = 1;
+    return NULL;
+}
+
+static void *reader_main(void *arg)
+{
+    reader_stats_t *stats = arg;
+    uint32_t last = 0;
+    while (!s_done)
+    {
+        aht21_sample_t sample;
+        uint32_t seq;
+        // 尚无样本或被连续发布打断时重读
+        if (aht21_latest_read(&s_latest, &sample, &seq) != RET_CODE_SUCCESS)
+        {
+            continue;
+        }
+        stats->reads++;
+        // 第seq个发布的样本时间戳为seq
+        if (sample.timestamp != seq || sample.temp != (float)seq ||
+            sample.humi != (float)(TEST_PUBLISH_NUM - seq))
+        {
+            stats->torn++;
+        }
+        if (seq < last)
+        {
+            stats->backwards++;
+        }
+        last = seq;
+    }
+    return NULL;
+}
+
+/**
+ * @brief 一个发布线程 多个读线程 读出的样本不撕裂 序号不回退
+ */
+static void test_concurrent(void)
+{
+    pthread_t writer;
+    pthread_t reader[TEST_READER_NUM];
+    aht21_latest_init(&s_latest);
+    s_done = 0;
+    for (int i = 0; i < TEST_READER_NUM; i++)
+    {
+        AHT21_CHECK_EQ(pthread_create(&reader[i], NULL, reader_main, &s_reader[i]), 0);
+    }
+    AHT21_CHECK_EQ(pthread_create(&writer, NULL, writer_main, NULL), 0);
+    pthread_join(writer, NULL);
+    unsigned long reads = 0;
+    for (int i = 0; i < TEST_READER_NUM; i++)
+    {
+        pthread_join(reader[i], NULL);
+        reads += s_reader[i].reads;
+        AHT21_CHECK_EQ(s_reader[i].torn, 0);
+        AHT21_CHECK_EQ(s_reader[i].backwards, 0);
+    }
+    AHT21_CHECK(reads > 0);
+}
+
+int main(void)
+{
+    test_single();
+    test_concurrent();
+    return AHT21_TEST_RESULT("test_aht21_latest");
+}
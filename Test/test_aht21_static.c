@@ -0,0 +1,150 @@
+/**
+ * @file test_aht21_static.c
+ * @brief 静态分派模式下驱动在软件仿真后端上的主机测试
+ *
+ * 以AHT21_CFG_STATIC_DISPATCH=1编译驱动，后端宏(test_aht21_static_backend.h)
+ * 转发到仿真实例的事务接口，验证不经接口表时读数、等待、周期采样和总线恢复
+ * 与运行时分派模式一致。同一文件以TEST_STATIC_YIELD=1再编译一次，覆盖只提供
+ * AHT21_CFG_YIELD的后端。
+ *
+ * @version 1.0
+ * @date 2024-07-26
+ *
+ * @par 依赖项
+ * - ec_bsp_aht21_driver.c 及其依赖的frame/comp/health
+ * - ec_bsp_aht21_sim.c
+ *
+ * @par 版本历史
+ * - 1.0 初始版本
+ *
+ * @par 作者
+ * - liyijie
+ */
+
+#include "aht21_test.h"
+#include "ec_bsp_aht21_sim.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#if !AHT21_CFG_STATIC_DISPATCH || AHT21_CFG_METHOD_TABLE
+#error "test_aht21_static.c requires AHT21_CFG_STATIC_DISPATCH=1 without method table"
+#endif
+
+static aht21_sim_t s_sim;
+static iic_driver_interface_t s_iic;
+static system_timebase_interface_t s_timebase;
+static bsp_aht21_t s_aht21;
+
+int8_t test_static_transfer(const iic_transaction_t *xfer)
+{
+    return s_iic.pfTransfer(xfer);
+}
+
+uint32_t test_static_get_tick(void)
+{
+    return s_timebase.mcu_get_systick_count();
+}
+
+void test_static_wait_until(uint32_t deadline_tick)
+{
+    s_timebase.pfwait_until(deadline_tick);
+}
+
+// 每次让出虚拟时钟前进1ms
+int8_t test_static_yield(void)
+{
+    aht21_sim_advance(&s_sim, 1);
+    return 0;
+}
+
+int8_t test_static_bus_recover(void)
+{
+    return s_iic.pfBusRecover();
+}
+
+/**
+ * @brief 接口参数全部为NULL 只初始化实例状态
+ */
+static void setup(void)
+{
+    memset(&s_aht21, 0, sizeof(s_aht21));
+    aht21_sim_init(&s_sim, AHT21_ADDR);
+    aht21_sim_bind(&s_sim, &s_iic, &s_timebase, true);
+    AHT21_CHECK_EQ(aht21_inst(&s_aht21, NULL, NULL, NULL), RET_CODE_SUCCESS);
+    AHT21_CHECK_EQ(aht21_init(&s_aht21), RET_CODE_SUCCESS);
+}
+
+/**
+ * @brief 读数与等待 不提前读取
+ */
+static void test_read(void)
+{
+    setup();
+    s_sim.temp_centi = -1234;
+    s_sim.humi_centi = 6789;
+    uint32_t start = s_sim.now_ms;
+    float temp = 0.0f;
+    float humi = 0.0f;
+    for (int i = 0; i < 10; i++)
+    {
+        AHT21_CHECK_EQ(aht21_read_data(&s_aht21, &temp, &humi), RET_CODE_SUCCESS);
+    }
+    AHT21_CHECK(fabsf(temp - (-12.34f)) < 0.001f);
+    AHT21_CHECK(fabsf(humi - 67.89f) < 0.001f);
+    AHT21_CHECK_EQ((s_sim.now_ms - start) / 10U, AHT21_MEASUREMENT_DELAY_MS);
+    AHT21_CHECK_EQ(s_sim.stats.busy_reads, 0);
+}
+
+/**
+ * @brief 周期采样按绝对时刻推进
+ */
+static void test_periodic(void)
+{
+    setup();
+    aht21_periodic_t periodic;
+    aht21_sample_t sample;
+    AHT21_CHECK_EQ(aht21_periodic_start(&s_aht21, &periodic, 500, NULL), RET_CODE_SUCCESS);
+    uint32_t first = 0;
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        AHT21_CHECK_EQ(aht21_periodic_step(&s_aht21, &periodic, &sample), RET_CODE_SUCCESS);
+        if (i == 0)
+        {
+            first = sample.timestamp;
+        }
+        AHT21_CHECK_EQ(sample.timestamp, first + i * 500U);
+    }
+    AHT21_CHECK_EQ(periodic.missed, 0);
+}
+
+/**
+ * @brief SDA卡死经AHT21_CFG_IIC_BUS_RECOVER解锁 同一次读取内恢复
+ */
+static void test_recovery(void)
+{
+    setup();
+    float temp;
+    float humi;
+    s_sim.bus_stuck = true;
+    AHT21_CHECK_EQ(aht21_read_data(&s_aht21, &temp, &humi), RET_CODE_SUCCESS);
+    aht21_fault_stats_t fault;
+    AHT21_CHECK_EQ(aht21_get_fault_stats(&s_aht21, &fault), RET_CODE_SUCCESS);
+    AHT21_CHECK_EQ(fault.bus_recover, 1);
+    AHT21_CHECK(fault.retry > 0);
+    AHT21_CHECK_EQ(s_sim.stats.bus_recovers, 1);
+    AHT21_CHECK(fabsf(temp - 25.0f) < 0.001f);
+}
+
+int main(void)
+{
+    test_read();
+    test_periodic();
+    test_recovery();
+    #if TEST_STATIC_YIELD
+    return AHT21_TEST_RESULT("test_aht21_static_yield");
+#else
+    return AHT21_TEST_RESULT("test_aht21_static");
+#endif
+}
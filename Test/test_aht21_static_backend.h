@@ -0,0 +1,42 @@
+/**
+ * @file test_aht21_static_backend.h
+ * @brief 静态分派模式主机测试的后端宏
+ *
+ * 由Makefile以AHT21_CFG_BACKEND_HEADER引入。事务、时基、等待和总线解锁
+ * 转发到仿真实例绑定的接口表，见test_aht21_static.c。TEST_STATIC_YIELD=1时
+ * 以AHT21_CFG_YIELD代替AHT21_CFG_WAIT_UNTIL。
+ *
+ * @version 1.0
+ * @date 2024-07-26
+ *
+ * @par 版本历史
+ * - 1.0 初始版本
+ *
+ * @par 作者
+ * - liyijie
+ */
+
+#ifndef __TEST_AHT21_STATIC_BACKEND_H__
+#define __TEST_AHT21_STATIC_BACKEND_H__
+
+#include "ec_bsp_aht21_driver.h"
+
+#include <stdint.h>
+
+int8_t   test_static_transfer(const iic_transaction_t *xfer);
+uint32_t test_static_get_tick(void);
+void     test_static_wait_until(uint32_t deadline_tick);
+int8_t   test_static_yield(void);
+int8_t   test_static_bus_recover(void);
+
+#define AHT21_CFG_IIC_TRANSFER(xfer)   test_static_transfer(xfer)
+#define AHT21_CFG_GET_TICK()           test_static_get_tick()
+// TEST_STATIC_YIELD=1时只提供让出接口 驱动循环调用AHT21_CFG_YIELD等待
+#if TEST_STATIC_YIELD
+#define AHT21_CFG_YIELD()              test_static_yield()
+#else
+#define AHT21_CFG_WAIT_UNTIL(deadline) test_static_wait_until(deadline)
+#endif
+#define AHT21_CFG_IIC_BUS_RECOVER()    test_static_bus_recover()
+
+#endif //__TEST_AHT21_STATIC_BACKEND_H__